@@ -0,0 +1,35 @@
+// Point light shading shared by the forward model shaders (model.frag and
+// model_indirect.frag). Include after uniforms.glsl and the precision statement.
+
+vec3 ShadeModel(vec3 textureColor, vec3 fragPos, vec3 normal)
+{
+    vec3 result = vec3(0.0); // Accumulate the light contributions
+
+    for (int i = 0; i < lightCount; i++) {
+        vec3 lightDir = normalize(lightPositions[i].xyz - fragPos);
+
+        // Diffuse lighting
+        float diff = max(dot(normal, lightDir), 0.0);
+
+        // View direction
+        vec3 viewDir = normalize(cameraPosition.xyz - fragPos);
+        vec3 reflectDir = reflect(-lightDir, normal);
+
+        // Specular lighting
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), 16.0);
+
+        // Light Attenuation (distance-based falloff)
+        float distance = length(lightPositions[i].xyz - fragPos);
+        float attenuation = 1.0 / (1.0 + 0.09 * distance + 0.032 * (distance * distance));
+
+        // Lighting components
+        vec3 ambient = 1.0 * textureColor;
+        vec3 diffuse = diff * textureColor * lightColors[i].rgb;
+        vec3 specular = spec * lightColors[i].rgb;
+
+        // Accumulate lighting from all lights
+        result += (ambient + diffuse + specular) * attenuation;
+    }
+
+    return result;
+}
@@ -0,0 +1,21 @@
+// Per-frame data shared by every program, filled once per frame by
+// FrameUniforms (include/frame_uniforms.h). Keep the members in sync with the
+// FrameData and LightData structs there.
+// Precisions are explicit so the blocks can be included before the default
+// precision statement and still match between the vertex and fragment stages.
+
+layout(std140) uniform FrameData {
+    highp mat4 view;
+    highp mat4 projection;
+    highp mat4 viewProjection;
+    highp vec4 cameraPosition; // w unused
+    highp float time;
+};
+
+#define MAX_LIGHTS 4
+
+layout(std140) uniform LightData {
+    highp vec4 lightPositions[MAX_LIGHTS]; // w unused
+    highp vec4 lightColors[MAX_LIGHTS];
+    highp int lightCount;
+};
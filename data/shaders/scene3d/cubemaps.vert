@@ -1,16 +1,16 @@
 #version 300 es
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
 precision highp float;
 
 layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-
 void main()
 {
     TexCoords = aPos;
-    vec4 pos = (projection * view) * vec4(aPos, 1.0);
+    // the skybox follows the camera: rotation only
+    vec4 pos = (projection * mat4(mat3(view))) * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }
\ No newline at end of file
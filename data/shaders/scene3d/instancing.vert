@@ -1,4 +1,6 @@
 #version 300 es
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
 precision highp float;
 
 layout (location = 0) in vec3 aPos;
@@ -7,11 +9,8 @@ layout (location = 3) in mat4 aInstanceMatrix;
 
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * aInstanceMatrix * vec4(aPos, 1.0);
+    gl_Position = viewProjection * aInstanceMatrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
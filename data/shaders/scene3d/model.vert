@@ -1,4 +1,6 @@
 #version 300 es
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
 precision highp float;
 
 layout(location = 0) in vec3 aPos;
@@ -10,8 +12,6 @@ out vec3 FragPos;
 out vec3 Normal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
@@ -19,5 +19,5 @@ void main()
     Normal = normalize(mat3(transpose(inverse(model))) * aNormal);
     TexCoords = aTexCoords;
 
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 450 core
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
+precision highp float;
+#include "../common/model_lighting.glsl"
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 FragPos;
+in vec3 Normal;
+
+uniform sampler2D texture_diffuse1;
+
+void main()
+{
+    vec3 textureColor = texture(texture_diffuse1, TexCoords).rgb;
+    FragColor = vec4(ShadeModel(textureColor, FragPos, normalize(Normal)), 1.0);
+}
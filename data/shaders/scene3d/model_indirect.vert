@@ -0,0 +1,33 @@
+#version 450 core
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+// Index of the indirect command, fed through baseInstance (see GeometryArena::CreateDrawIdVao)
+layout(location = 7) in uint aDrawId;
+
+// Must match DrawRecord in include/indirect_renderer.h
+struct DrawRecord {
+    mat4 model;
+    uint material;
+};
+
+layout(std430, binding = 0) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+
+void main()
+{
+    mat4 model = draws[aDrawId].model;
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = normalize(mat3(transpose(inverse(model))) * aNormal);
+    TexCoords = aTexCoords;
+
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
@@ -15,15 +15,12 @@ in VS_OUT {
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
 void main()
 {
-    // obtain normal from normal map in range [0,1]
-    vec3 normal = texture(normalMap, fs_in.TexCoords).rgb;
-    // transform normal vector to range [-1,1]
-    normal = normalize(normal * 2.0 - 1.0);  // this normal is in tangent space
+    // obtain normal from normal map in range [0,1], only X and Y are stored when the map is baked as BC5
+    vec2 normal_xy = texture(normalMap, fs_in.TexCoords).rg * 2.0 - 1.0;
+    // rebuild Z from the unit length, this normal is in tangent space
+    vec3 normal = vec3(normal_xy, sqrt(max(1.0 - dot(normal_xy, normal_xy), 0.0)));
 
     // get diffuse color
     vec3 color = texture(diffuseMap, fs_in.TexCoords).rgb;
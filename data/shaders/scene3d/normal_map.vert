@@ -1,4 +1,6 @@
 #version 330
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
 //TODO check why 300 es doesn't work
 precision highp float;
 
@@ -16,13 +18,8 @@ out VS_OUT {
     vec3 TangentFragPos;
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
 uniform mat4 model;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
 void main()
 {
     vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
@@ -35,9 +32,9 @@ void main()
     vec3 B = cross(N, T);
 
     mat3 TBN = transpose(mat3(T, B, N));
-    vs_out.TangentLightPos = TBN * lightPos;
-    vs_out.TangentViewPos  = TBN * viewPos;
+    vs_out.TangentLightPos = TBN * lightPositions[0].xyz;
+    vs_out.TangentViewPos  = TBN * cameraPosition.xyz;
     vs_out.TangentFragPos  = TBN * vs_out.FragPos;
 
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #version 300 es
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
 precision highp float;
 
 layout (location = 0) in vec3 aPos;
@@ -12,8 +14,6 @@ out vec3 Normal;
 uniform bool invertedNormals;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
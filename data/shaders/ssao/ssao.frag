@@ -1,4 +1,6 @@
 #version 300 es
+#extension GL_GOOGLE_include_directive : require
+#include "../common/uniforms.glsl"
 precision highp float;
 
 out float FragColor;
@@ -19,8 +21,6 @@ float bias = 0.025;
 // tile noise texture over screen based on screen dimensions divided by noise size
 const vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0);
 
-uniform mat4 projection;
-
 void main()
 {
     // get input for SSAO algorithm
@@ -0,0 +1,54 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <cstddef>
+
+namespace gpr5300
+{
+
+struct AllocationCounters
+{
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+};
+
+// Heap allocation instrumentation.
+//
+// allocation_tracker.cc replaces the global operator new and delete of every
+// program linking Common: each operator new is counted per thread and for the
+// whole process, reported to Tracy when profiling is enabled, then passed to
+// the optional hook. C allocations (malloc from SDL, ImGui, the GL driver) are
+// not seen.
+//
+// EndFrame() closes a frame: last_frame() then holds what the calling thread
+// (the render thread) allocated since the previous EndFrame, and
+// last_frame_all_threads() what the whole process did.
+class AllocationTracker
+{
+ public:
+  // Called after counting, on the allocating thread, for every operator new.
+  // It must not allocate itself.
+  using Hook = void (*)(std::size_t size);
+
+  static AllocationTracker& Default();
+
+  void SetHook(Hook hook);
+
+  // Totals since the start of the program
+  [[nodiscard]] static AllocationCounters thread_total();
+  [[nodiscard]] static AllocationCounters process_total();
+
+  void EndFrame();
+  [[nodiscard]] const AllocationCounters& last_frame() const { return last_frame_; }
+  [[nodiscard]] const AllocationCounters& last_frame_all_threads() const { return last_frame_all_threads_; }
+
+ private:
+  AllocationCounters frame_start_;
+  AllocationCounters frame_start_all_threads_;
+  AllocationCounters last_frame_;
+  AllocationCounters last_frame_all_threads_;
+};
+
+} // namespace gpr5300
+
+#endif // ALLOCATION_TRACKER_H
@@ -0,0 +1,36 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cfloat>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+// Bounding volumes computed once at import and moved to world space per use.
+
+// Empty by default: min above max, so any point grows it
+struct BoundingBox
+{
+  glm::vec3 min{FLT_MAX};
+  glm::vec3 max{-FLT_MAX};
+};
+
+struct BoundingSphere
+{
+  glm::vec3 center{0.0f};
+  float radius = 0.0f;
+};
+
+// Largest scale factor of transform's upper 3x3: world radius per local unit
+[[nodiscard]] float MaxScale(const glm::mat4& transform);
+
+// World-space box enclosing the local box [min, max] under transform (Arvo,
+// "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990): each output
+// axis adds, per input axis, the smaller and the larger of the matrix term
+// times min and max, instead of transforming the 8 corners.
+void TransformAabb(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max, glm::vec3& out_min,
+                   glm::vec3& out_max);
+
+// World-space sphere enclosing the local sphere under transform
+[[nodiscard]] BoundingSphere TransformSphere(const glm::mat4& transform, const BoundingSphere& sphere);
+
+#endif // BOUNDS_H
@@ -0,0 +1,252 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+#include <glm/vec3.hpp>
+
+#include "bounds.h"
+
+struct Frustum;
+
+// Bounding volume hierarchy over axis-aligned boxes: the meshes of a scene
+// under their model matrices, instances, or the triangles of one mesh.
+//
+// Build splits each node on the plane with the lowest surface area heuristic
+// cost, among kSahBins - 1 planes per axis between bins of box centroids,
+// down to leaves of at most kMaxLeafSize items. Both children of a node sit
+// side by side after their parent, and items are reordered so that every
+// subtree covers a contiguous range of item_order(): a query that finds a
+// node entirely inside its volume takes the whole range without visiting the
+// nodes below.
+//
+// When items move, Update records their new box and Refit widens or narrows
+// the boxes on the way up to the root, keeping the shape of the tree. The
+// tree gets worse as items drift from where they were built: Build again once
+// SahCost() grows well past build_cost().
+//
+// Queries only read the tree and may run on several threads at once. They
+// test item boxes; Raycast takes an item test for the exact geometry.
+class Bvh
+{
+ public:
+  static constexpr std::size_t kMaxLeafSize = 4;
+  static constexpr std::size_t kSahBins = 16;
+  // Longest path from the root, the size of the traversal stacks
+  static constexpr std::size_t kMaxDepth = 64;
+  static constexpr std::uint32_t kNoItem = 0xFFFFFFFFu;
+
+  struct Node
+  {
+    glm::vec3 min;
+    std::uint32_t first; // Leaf: first item in item_order(); interior: left child, followed by the right one
+    glm::vec3 max;
+    std::uint32_t count; // Leaf: item count; interior: 0
+
+    [[nodiscard]] bool is_leaf() const { return count != 0; }
+  };
+
+  struct RayHit
+  {
+    std::uint32_t item = kNoItem;
+    float distance = std::numeric_limits<float>::infinity(); // Along the direction, in its units
+
+    [[nodiscard]] explicit operator bool() const { return item != kNoItem; }
+  };
+
+  // Work done by one query, for benchmarks
+  struct QueryStats
+  {
+    std::size_t nodes_visited = 0;
+    std::size_t items_tested = 0;   // Against the volume, in partially covered leaves
+    std::size_t items_accepted = 0; // Without a test, in subtrees entirely inside
+  };
+
+  // Builds the tree over items; item i keeps index i in every query
+  void Build(std::span<const BoundingBox> items);
+  void Clear();
+
+  // New box of item, applied to the tree by the next Refit
+  void Update(std::uint32_t item, const BoundingBox& box);
+  // Refits the boxes above the items updated since the last Refit. Returns
+  // how many node boxes were rewritten, 0 if nothing moved.
+  std::size_t Refit();
+
+  // Items whose box touches the frustum (world space), written to out in
+  // tree order. out holds at least item_count() indices. Returns how many.
+  [[nodiscard]] std::size_t QueryFrustum(const Frustum& frustum, std::span<std::uint32_t> out,
+                                         QueryStats* stats = nullptr) const;
+  // Items whose box overlaps the sphere, same output as QueryFrustum
+  [[nodiscard]] std::size_t QuerySphere(const glm::vec3& center, float radius, std::span<std::uint32_t> out,
+                                        QueryStats* stats = nullptr) const;
+  // Nearest item box along the ray, from origin up to max_distance
+  [[nodiscard]] RayHit Raycast(const glm::vec3& origin, const glm::vec3& direction,
+                               float max_distance = std::numeric_limits<float>::infinity()) const;
+  // Nearest item hit by item_test(item, max_distance), which returns the
+  // distance of its hit or anything not below max_distance for a miss.
+  // Nodes are visited near child first and skipped once farther than the
+  // best hit.
+  template <typename ItemTest>
+  [[nodiscard]] RayHit Raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance,
+                               ItemTest&& item_test) const;
+
+  // Expected cost of a query reaching every node, relative to the root's
+  // area: one per interior node, one per item in leaves
+  [[nodiscard]] float SahCost() const;
+  // SahCost() right after Build
+  [[nodiscard]] float build_cost() const { return build_cost_; }
+
+  [[nodiscard]] bool empty() const { return nodes_.empty(); }
+  [[nodiscard]] std::size_t item_count() const { return boxes_.size(); }
+  [[nodiscard]] std::span<const Node> nodes() const { return nodes_; }
+  [[nodiscard]] std::span<const std::uint32_t> item_order() const { return item_order_; }
+  [[nodiscard]] const BoundingBox& item_box(const std::uint32_t item) const { return boxes_[item]; }
+
+ private:
+  struct RayEntry
+  {
+    std::uint32_t node;
+    float distance;
+  };
+
+  // Copy of an item's box moved around by Build, so that every pass over a
+  // node's items reads memory in order
+  struct BuildItem
+  {
+    glm::vec3 min;
+    std::uint32_t item;
+    glm::vec3 max;
+    glm::vec3 centroid;
+  };
+
+  struct BuildTask
+  {
+    std::uint32_t node;
+    std::uint32_t first; // In item_order_ and build_items_
+    std::uint32_t count;
+    std::uint32_t depth;
+  };
+
+  // Direction inverse, away from zero so the slab test never sees 0 * inf
+  [[nodiscard]] static glm::vec3 InverseDirection(const glm::vec3& direction)
+  {
+    constexpr float kTiny = 1e-30f;
+    glm::vec3 inverse;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      inverse[axis] = 1.0f / (std::abs(direction[axis]) < kTiny ? std::copysign(kTiny, direction[axis])
+                                                                : direction[axis]);
+    }
+    return inverse;
+  }
+  // Slab test: entry distance of the ray into [min, max] if below max_distance
+  [[nodiscard]] static bool IntersectRay(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin,
+                                         const glm::vec3& inverse, const float max_distance, float& entry)
+  {
+    float t_near = 0.0f;
+    float t_far = max_distance;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      const float t0 = (min[axis] - origin[axis]) * inverse[axis];
+      const float t1 = (max[axis] - origin[axis]) * inverse[axis];
+      t_near = std::fmax(t_near, t0 < t1 ? t0 : t1);
+      t_far = std::fmin(t_far, t0 < t1 ? t1 : t0);
+    }
+    entry = t_near;
+    return t_near <= t_far;
+  }
+
+  // Items of node's subtree: from its leftmost leaf to its rightmost one
+  [[nodiscard]] std::span<const std::uint32_t> SubtreeItems(std::uint32_t node) const;
+  void FitLeaf(Node& node) const;
+
+  std::vector<Node> nodes_;
+  std::vector<BoundingBox> boxes_;       // By item
+  std::vector<std::uint32_t> item_order_; // Items in leaf order
+  std::vector<std::uint32_t> item_leaf_;  // Leaf of each item
+  std::vector<std::uint32_t> parents_;    // By node, the root's is kNoItem
+  std::vector<std::uint32_t> dirty_;      // Items updated since the last Refit
+  std::vector<std::uint8_t> item_dirty_;
+  // Build scratch, kept so that rebuilding the same items allocates nothing
+  std::vector<BuildItem> build_items_;
+  std::vector<BuildTask> build_tasks_;
+  float build_cost_ = 0.0f;
+};
+
+template <typename ItemTest>
+Bvh::RayHit Bvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, const float max_distance,
+                         ItemTest&& item_test) const
+{
+  RayHit hit;
+  hit.distance = max_distance;
+  const glm::vec3 inverse = InverseDirection(direction);
+  float entry = 0.0f;
+  if (nodes_.empty() || !IntersectRay(nodes_[0].min, nodes_[0].max, origin, inverse, hit.distance, entry))
+  {
+    return {};
+  }
+  // Each visit pops one entry and pushes at most two, one level deeper
+  RayEntry stack[kMaxDepth + 1];
+  std::size_t size = 0;
+  stack[size++] = {0, entry};
+  while (size > 0)
+  {
+    const RayEntry current = stack[--size];
+    if (current.distance > hit.distance)
+    {
+      continue;
+    }
+    const Node& node = nodes_[current.node];
+    if (node.is_leaf())
+    {
+      for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+      {
+        const float distance = item_test(item_order_[i], hit.distance);
+        if (distance < hit.distance)
+        {
+          hit = {item_order_[i], distance};
+        }
+      }
+      continue;
+    }
+    const Node& left = nodes_[node.first];
+    const Node& right = nodes_[node.first + 1];
+    float left_entry = 0.0f;
+    float right_entry = 0.0f;
+    const bool hit_left = IntersectRay(left.min, left.max, origin, inverse, hit.distance, left_entry);
+    const bool hit_right = IntersectRay(right.min, right.max, origin, inverse, hit.distance, right_entry);
+    // Farther child pushed first, so the nearer one is visited first
+    if (hit_left && hit_right && left_entry < right_entry)
+    {
+      stack[size++] = {node.first + 1, right_entry};
+      stack[size++] = {node.first, left_entry};
+    }
+    else
+    {
+      if (hit_left)
+      {
+        stack[size++] = {node.first, left_entry};
+      }
+      if (hit_right)
+      {
+        stack[size++] = {node.first + 1, right_entry};
+      }
+    }
+  }
+  if (hit.item == kNoItem)
+  {
+    return {};
+  }
+  return hit;
+}
+
+// Distance along direction from origin to triangle abc (either side), or
+// infinity if the ray misses it (Möller and Trumbore)
+[[nodiscard]] float IntersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a,
+                                         const glm::vec3& b, const glm::vec3& c);
+
+#endif // BVH_H
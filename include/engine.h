@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+
 #include "scene3d.h"
 
 namespace gpr5300
@@ -12,7 +14,10 @@ public:
 private:
     void Begin();
     void End();
+    // Frame statistics of AllocationTracker, and the zero-allocation check
+    void EndFrameAllocations();
     Scene* scene_ = nullptr;
+    std::size_t steady_frames_ = 0;
     SDL_Window* window_ = nullptr;
     SDL_GLContext glRenderContext_{};
 };
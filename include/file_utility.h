@@ -1,8 +1,48 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+#include <string>
 #include <string_view>
 
 namespace gpr5300
 {
     std::string LoadFile(std::string_view path);
+
+    // Read-only memory mapping of a whole file. The bytes are paged in by the OS
+    // on first access instead of being copied through a stream buffer, and stay
+    // valid until the object is closed or destroyed. Safe to use from any thread.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& path) { Open(path); }
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        // Returns false if the file cannot be opened or mapped. An empty file
+        // opens successfully with no bytes.
+        bool Open(const std::string& path);
+        void Close();
+
+        [[nodiscard]] bool is_open() const { return open_; }
+        [[nodiscard]] std::size_t size() const { return size_; }
+        [[nodiscard]] std::span<const std::byte> bytes() const { return {data_, size_}; }
+        [[nodiscard]] std::string_view text() const
+        {
+            return {reinterpret_cast<const char*>(data_), size_};
+        }
+
+    private:
+        const std::byte* data_ = nullptr;
+        std::size_t size_ = 0;
+        bool open_ = false;
+#ifdef _WIN32
+        void* file_handle_ = nullptr;
+        void* mapping_handle_ = nullptr;
+#endif
+    };
 } // namespace gpr5300
@@ -0,0 +1,98 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gpr5300
+{
+
+// Linear allocator for data that lives for one frame only (transient vectors,
+// formatted text for ImGui...).
+//
+// Allocate bumps an offset in one block allocated up front; Reset, called by
+// Engine::Run at the start of every frame, releases everything at once.
+// Nothing is destroyed: only trivially destructible data belongs here. A frame
+// that runs out of room falls back to the general heap, and the next Reset
+// grows the block to the size that frame needed, so steady-state frames never
+// touch the heap. Render thread only.
+class FrameArena
+{
+ public:
+  static constexpr std::size_t kDefaultCapacity = 1u << 20;
+
+  explicit FrameArena(std::size_t capacity = kDefaultCapacity);
+  ~FrameArena();
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  static FrameArena& Default();
+
+  [[nodiscard]] void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+  template <typename T>
+  [[nodiscard]] std::span<T> AllocateArray(const std::size_t count)
+  {
+    static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+    T* data = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    std::uninitialized_value_construct_n(data, count);
+    return {data, count};
+  }
+  // printf-style formatting into the arena, NUL-terminated, valid until the next Reset
+  [[nodiscard]] std::string_view Format(const char* format, ...);
+
+  void Reset();
+
+  [[nodiscard]] std::size_t used() const { return offset_; }
+  [[nodiscard]] std::size_t capacity() const { return capacity_; }
+  // Bytes that did not fit during the last frame
+  [[nodiscard]] std::size_t overflow_bytes() const { return last_overflow_bytes_; }
+
+ private:
+  std::unique_ptr<std::byte[]> block_;
+  std::size_t capacity_ = 0;
+  std::size_t offset_ = 0;
+  std::vector<std::pair<void*, std::align_val_t>> overflow_blocks_;
+  std::size_t overflow_bytes_ = 0;
+  std::size_t last_overflow_bytes_ = 0;
+};
+
+// Standard allocator over FrameArena, for containers dropped before the next
+// Reset: std::vector<T, FrameArenaAllocator<T>> items(arena);
+template <typename T>
+class FrameArenaAllocator
+{
+ public:
+  using value_type = T;
+
+  explicit FrameArenaAllocator(FrameArena& arena = FrameArena::Default()) noexcept : arena_(&arena) {}
+  template <typename U>
+  FrameArenaAllocator(const FrameArenaAllocator<U>& other) noexcept : arena_(other.arena())
+  {
+  }
+
+  [[nodiscard]] T* allocate(const std::size_t count)
+  {
+    return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, std::size_t) noexcept {}
+
+  [[nodiscard]] FrameArena* arena() const noexcept { return arena_; }
+  template <typename U>
+  bool operator==(const FrameArenaAllocator<U>& other) const noexcept
+  {
+    return arena_ == other.arena();
+  }
+
+ private:
+  FrameArena* arena_;
+};
+
+} // namespace gpr5300
+
+#endif // FRAME_ARENA_H
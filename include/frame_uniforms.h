@@ -0,0 +1,61 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <span>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Per-frame data shared by every program through std140 uniform buffers.
+//
+// The GLSL side lives in data/shaders/common/uniforms.glsl; the structs below
+// must match it member for member. Each block has a fixed binding point that
+// Shader assigns after linking (BindFrameUniformBlocks), so a program only
+// has to include the file to see the data. The blocks are written once per
+// frame into the StreamBuffer instead of re-sending the same matrices to each
+// program.
+
+inline constexpr unsigned int kFrameDataBinding = 0;
+inline constexpr unsigned int kLightDataBinding = 1;
+inline constexpr int kMaxLights = 4;
+
+struct FrameData
+{
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 view_projection;
+  glm::vec4 camera_position; // w unused
+  float time;
+  float padding[3];
+};
+static_assert(sizeof(FrameData) == 224, "FrameData must match the std140 FrameData block");
+
+struct LightData
+{
+  glm::vec4 positions[kMaxLights]; // w unused, vec3 arrays are padded to vec4 in std140
+  glm::vec4 colors[kMaxLights];
+  int count;
+  int padding[3];
+};
+static_assert(sizeof(LightData) == 144, "LightData must match the std140 LightData block");
+
+// Points the FrameData and LightData blocks of program, if it uses them, at
+// their binding points. GL thread only.
+void BindFrameUniformBlocks(unsigned int program);
+
+// Streams the two blocks. GL thread only.
+class FrameUniforms
+{
+ public:
+  // Writes both blocks into the current StreamBuffer frame and binds those
+  // ranges to their binding points
+  void Update(const FrameData& frame, const LightData& lights);
+
+  [[nodiscard]] static FrameData MakeFrameData(const glm::mat4& view, const glm::mat4& projection,
+                                               const glm::vec3& camera_position, float time);
+  // Lights past kMaxLights are ignored
+  [[nodiscard]] static LightData MakeLightData(std::span<const glm::vec3> positions,
+                                               std::span<const glm::vec3> colors);
+};
+
+#endif // FRAME_UNIFORMS_H
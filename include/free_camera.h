@@ -1,9 +1,11 @@
 ﻿#ifndef FREE_CAMERA_H
 #define FREE_CAMERA_H
+#include <array>
 #include <glm/fwd.hpp>
 #include <glm/vec3.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/quaternion_geometric.hpp>
+#include "bounds.h"
 #include "model.h"
 
 enum Camera_Movement { FORWARD, BACKWARD, LEFT, RIGHT, UP, DOWN };
@@ -135,10 +137,18 @@ struct Frustum {
 
   Plane farFace;
   Plane nearFace;
+  // Copie des six plans ci-dessus pour les parcourir en boucle, tenue à jour par
+  // CreateFrustumFromCamera et Update
   std::array<Plane, 6> planes_ = {topFace, bottomFace, rightFace, leftFace, nearFace, farFace};
 
+  void SyncPlanes() {
+    planes_ = {topFace, bottomFace, rightFace, leftFace, nearFace, farFace};
+  }
 
  public:
+  // Normales tournées vers l'intérieur : un point p est dedans si
+  // dot(normal, p) - distance >= 0 pour les six plans
+  [[nodiscard]] const std::array<Plane, 6>& planes() const { return planes_; }
 
   void CreateFrustumFromCamera(const FreeCamera &cam, float aspect, float fovY, float zNear, float zFar) {
     const float halfVSide = zFar * tanf(fovY * 0.5f);
@@ -151,37 +161,31 @@ struct Frustum {
     leftFace = {cam.camera_position_, glm::cross(cam.camera_up_, frontMultFar + cam.camera_right_ * halfHSide)};
     topFace = {cam.camera_position_, glm::cross(cam.camera_right_, frontMultFar - cam.camera_up_ * halfVSide)};
     bottomFace = {cam.camera_position_, glm::cross(frontMultFar + cam.camera_up_ * halfVSide, cam.camera_right_)};
+    SyncPlanes();
   }
 
+  // Extraction des plans depuis la matrice projection * vue (Gribb & Hartmann) :
+  // chaque plan est la somme ou la différence de la 4e ligne et d'une autre ligne.
+  // glm stocke les matrices par colonnes, la ligne i est (m[0][i], m[1][i], m[2][i], m[3][i]).
   void Update(const glm::mat4& projView) {
-    // Extraire les plans du frustum à partir de la matrice projetée-vue (projView)
-    glm::mat4 matrix = glm::transpose(projView); // Assurez-vous de transposer la matrice si nécessaire
-
-
-
-    // Plage de valeurs pour les plans
-    topFace.normal = glm::vec3(matrix[0][3] + matrix[0][0], matrix[1][3] + matrix[1][0], matrix[2][3] + matrix[2][0]);
-    bottomFace.normal = glm::vec3(matrix[0][3] - matrix[0][0], matrix[1][3] - matrix[1][0], matrix[2][3] - matrix[2][0]);
-    rightFace.normal = glm::vec3(matrix[0][3] - matrix[0][1], matrix[1][3] - matrix[1][1], matrix[2][3] - matrix[2][1]);
-    leftFace.normal = glm::vec3(matrix[0][3] + matrix[0][1], matrix[1][3] + matrix[1][1], matrix[2][3] + matrix[2][1]);
-    nearFace.normal = glm::vec3(matrix[0][3] + matrix[0][2], matrix[1][3] + matrix[1][2], matrix[2][3] + matrix[2][2]);
-    farFace.normal = glm::vec3(matrix[0][3] - matrix[0][2], matrix[1][3] - matrix[1][2], matrix[2][3] - matrix[2][2]);
-
-    // Calculer les distances de chaque plan à l'origine (le point d'intersection du plan et de la vue)
-    topFace.distance = -(matrix[0][3] + matrix[0][0]);
-    bottomFace.distance = -(matrix[0][3] - matrix[0][0]);
-    rightFace.distance = -(matrix[0][3] - matrix[0][1]);
-    leftFace.distance = -(matrix[0][3] + matrix[0][1]);
-    nearFace.distance = -(matrix[0][3] + matrix[0][2]);
-    farFace.distance = -(matrix[0][3] - matrix[0][2]);
-
-    // Normaliser les vecteurs normaux des plans
-    topFace.normal = glm::normalize(topFace.normal);
-    bottomFace.normal = glm::normalize(bottomFace.normal);
-    rightFace.normal = glm::normalize(rightFace.normal);
-    leftFace.normal = glm::normalize(leftFace.normal);
-    nearFace.normal = glm::normalize(nearFace.normal);
-    farFace.normal = glm::normalize(farFace.normal);
+    const auto row = [&projView](const int i) {
+      return glm::vec4(projView[0][i], projView[1][i], projView[2][i], projView[3][i]);
+    };
+    // a.x * x + a.y * y + a.z * z + a.w >= 0 à l'intérieur, ramené à la forme de Plane
+    const auto make_plane = [](const glm::vec4& a) {
+      const float length = glm::length(glm::vec3(a));
+      Plane plane;
+      plane.normal = glm::vec3(a) / length;
+      plane.distance = -a.w / length;
+      return plane;
+    };
+    leftFace = make_plane(row(3) + row(0));
+    rightFace = make_plane(row(3) - row(0));
+    bottomFace = make_plane(row(3) + row(1));
+    topFace = make_plane(row(3) - row(1));
+    nearFace = make_plane(row(3) + row(2));
+    farFace = make_plane(row(3) - row(2));
+    SyncPlanes();
   }
 
   bool IsObjectInFrustum(const Model& model) const {
@@ -193,6 +197,16 @@ struct Frustum {
     return IsAABBInFrustum(min, max);
   }
 
+  // Même test pour un modèle placé par transform : boîte transformée par la méthode
+  // d'Arvo (TransformAabb) à partir des bornes mises en cache à l'import
+  bool IsObjectInFrustum(const Model& model, const glm::mat4& transform) const {
+    glm::vec3 min, max;
+    model.GetBoundingBox(min, max);
+    glm::vec3 world_min, world_max;
+    TransformAabb(transform, min, max, world_min, world_max);
+    return IsAABBInFrustum(world_min, world_max);
+  }
+
 
   bool IsAABBInFrustum(const glm::vec3& min, const glm::vec3& max) const {
     for (int i = 0; i < 6; ++i) {
@@ -213,7 +227,7 @@ struct Frustum {
       bool inside = false;
       for (int j = 0; j < 8; ++j) {
         // Vérifie si un coin de la boîte est à l'intérieur du plan
-        if (glm::dot(plane.normal, corners[j]) + plane.distance > 0) {
+        if (glm::dot(plane.normal, corners[j]) - plane.distance >= 0) {
           inside = true;
           break;
         }
@@ -229,9 +243,7 @@ struct Frustum {
 
   [[nodiscard]] bool IsSphereInFrustum(const Sphere &sphere) const {
     // Pour chaque plan du frustum
-    std::array<Plane, 6> allPlanes = {topFace, bottomFace, rightFace, leftFace, nearFace, farFace};
-
-    for (const auto &plane : allPlanes) {
+    for (const auto &plane : planes_) {
       // Calcul de la distance entre le centre de la sphère et le plan
       float distance = plane.GetSignedDistanceToPlaneFromACircle(sphere);
 
@@ -255,8 +267,7 @@ struct Frustum {
         center + glm::vec3( halfSize,  halfSize,  halfSize)
     };
 
-    const Plane planes[] = {topFace, bottomFace, rightFace, leftFace, nearFace, farFace};
-    for (const auto &plane : planes) {
+    for (const auto &plane : planes_) {
       bool allOutside = true;
 
       for (const auto &vertex : vertices) {
@@ -0,0 +1,69 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/vec3.hpp>
+
+struct Frustum;
+
+// Batched frustum culling of bounding volumes stored as structure of arrays.
+//
+// Each component of the volumes lives in its own array, so one SIMD load
+// reads the same component of 8 volumes (AVX2) or 4 (SSE2). Boxes use the
+// positive-vertex test: for each plane, only the corner furthest along the
+// plane normal is checked, picked once per plane since the normal is the same
+// for every box. The result is the same as Frustum::IsAABBInFrustum and
+// Frustum::IsSphereInFrustum, volume by volume.
+//
+// The instruction set is chosen at compile time (__AVX2__, then SSE2, then
+// plain C++); count padding is not needed, the last few volumes go through
+// the scalar loop.
+
+struct AabbSoa
+{
+  std::vector<float> min_x, min_y, min_z;
+  std::vector<float> max_x, max_y, max_z;
+
+  void Add(const glm::vec3& min, const glm::vec3& max);
+  void Clear();
+  void Reserve(std::size_t count);
+  // count volumes, to be written component by component
+  void Resize(std::size_t count);
+  [[nodiscard]] std::size_t size() const { return min_x.size(); }
+};
+
+struct SphereSoa
+{
+  std::vector<float> center_x, center_y, center_z;
+  std::vector<float> radius;
+
+  void Add(const glm::vec3& center, float sphere_radius);
+  void Clear();
+  void Reserve(std::size_t count);
+  void Resize(std::size_t count);
+  [[nodiscard]] std::size_t size() const { return radius.size(); }
+};
+
+// Words of a visibility bitmask over count volumes
+[[nodiscard]] constexpr std::size_t VisibilityMaskWords(const std::size_t count)
+{
+  return (count + 63) / 64;
+}
+
+// Bit i % 64 of visible[i / 64] is set when volume i touches the frustum.
+// visible holds at least VisibilityMaskWords(size()) words.
+void CullAabbs(const Frustum& frustum, const AabbSoa& boxes, std::span<std::uint64_t> visible);
+void CullSpheres(const Frustum& frustum, const SphereSoa& spheres, std::span<std::uint64_t> visible);
+// Writes the indices of the volumes touching the frustum in increasing order
+// and returns how many. visible holds at least size() indices.
+[[nodiscard]] std::size_t CullAabbs(const Frustum& frustum, const AabbSoa& boxes, std::span<std::uint32_t> visible);
+[[nodiscard]] std::size_t CullSpheres(const Frustum& frustum, const SphereSoa& spheres,
+                                      std::span<std::uint32_t> visible);
+
+// Instruction set the batches run on: "AVX2", "SSE2" or "scalar"
+[[nodiscard]] const char* FrustumCullingIsa();
+
+#endif // FRUSTUM_CULLING_H
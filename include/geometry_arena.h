@@ -0,0 +1,172 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "vertex_packing.h"
+
+struct Vertex;
+
+// Meshes with at most this many vertices are stored with 16-bit indices
+inline constexpr std::size_t kShortIndexVertexLimit = std::size_t{1} << 16;
+
+// First-fit allocator over a range of elements. Freed blocks are merged with
+// their neighbours so unloading a model leaves one reusable hole.
+class FreeListAllocator
+{
+ public:
+  explicit FreeListAllocator(std::size_t capacity = 0);
+
+  [[nodiscard]] std::optional<std::size_t> Allocate(std::size_t size);
+  void Free(std::size_t offset, std::size_t size);
+  // Adds [capacity(), new_capacity) to the free list
+  void Grow(std::size_t new_capacity);
+
+  [[nodiscard]] std::size_t capacity() const { return capacity_; }
+  [[nodiscard]] std::size_t used() const { return used_; }
+  [[nodiscard]] std::size_t free_block_count() const { return free_blocks_.size(); }
+
+ private:
+  std::map<std::size_t, std::size_t> free_blocks_; // offset -> size
+  std::size_t capacity_ = 0;
+  std::size_t used_ = 0;
+};
+
+// Range of the arena buffers owned by one mesh. Released on destruction.
+class GeometryAllocation
+{
+ public:
+  GeometryAllocation() = default;
+  ~GeometryAllocation();
+  GeometryAllocation(const GeometryAllocation&) = delete;
+  GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+  GeometryAllocation(GeometryAllocation&& other) noexcept;
+  GeometryAllocation& operator=(GeometryAllocation&& other) noexcept;
+
+  // Selects the arena vertex buffer, and the VAO to draw with
+  [[nodiscard]] VertexFormat vertex_format() const { return vertex_format_; }
+  // Passed to glDrawElementsBaseVertex, in vertices of vertex_format()
+  [[nodiscard]] int base_vertex() const { return static_cast<int>(vertex_offset_); }
+  [[nodiscard]] std::size_t vertex_count() const { return vertex_count_; }
+  // Position of the first index in the index buffer, counted in index_size() units
+  [[nodiscard]] std::size_t first_index() const { return index_offset_ * sizeof(std::uint32_t) / index_size_; }
+  [[nodiscard]] std::size_t index_count() const { return index_count_; }
+  // 2 or 4 bytes, and the matching GL_UNSIGNED_SHORT or GL_UNSIGNED_INT for the draw calls
+  [[nodiscard]] std::size_t index_size() const { return index_size_; }
+  [[nodiscard]] unsigned int index_type() const;
+  // Byte offset of the first index, the "indices" argument of the draw calls
+  [[nodiscard]] const void* index_byte_offset() const
+  {
+    return reinterpret_cast<const void*>(index_offset_ * sizeof(std::uint32_t));
+  }
+  explicit operator bool() const { return index_count_ != 0 || vertex_count_ != 0; }
+
+ private:
+  friend class GeometryArena;
+
+  // Space in the index buffer, in 32-bit words
+  [[nodiscard]] std::size_t index_words() const
+  {
+    return (index_count_ * index_size_ + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+  }
+
+  std::size_t vertex_offset_ = 0;
+  std::size_t vertex_count_ = 0;
+  std::size_t index_offset_ = 0; // In 32-bit words, so every range is aligned for both index sizes
+  std::size_t index_count_ = 0;
+  std::uint8_t index_size_ = sizeof(std::uint32_t);
+  VertexFormat vertex_format_ = VertexFormat::kFloat;
+};
+
+// Every mesh's vertices and indices suballocated from one shared vertex
+// buffer per VertexFormat and one shared index buffer, so drawing any number
+// of meshes of a format needs a single VAO bind followed by
+// glDrawElementsBaseVertex calls.
+//
+// Indices are relative to the mesh's base vertex, so every mesh with at most
+// kShortIndexVertexLimit vertices is stored with 16-bit indices. Draw calls
+// must pass GeometryAllocation::index_type().
+//
+// There is one VAO per vertex format and layout: vao(format) for the vertex
+// data alone, instanced VAOs (CreateInstancedVao) that add a per-instance mat4
+// at locations 3 to 6, and draw-id VAOs (CreateDrawIdVao) for multi-draw
+// indirect. The buffers double when full; every VAO is re-pointed and
+// existing allocations keep their offsets. GL thread only.
+class GeometryArena
+{
+ public:
+  static constexpr unsigned int kDrawIdLocation = 7;
+
+  static GeometryArena& Default();
+
+  GeometryArena(std::size_t vertex_capacity, std::size_t packed_vertex_capacity, std::size_t index_capacity);
+  ~GeometryArena();
+  GeometryArena(const GeometryArena&) = delete;
+  GeometryArena& operator=(const GeometryArena&) = delete;
+
+  // Copies the data into the arena, narrowing the indices to 16 bits when they
+  // fit. An empty allocation if both spans are empty.
+  GeometryAllocation Allocate(std::span<const Vertex> vertices, std::span<const unsigned int> indices);
+  GeometryAllocation Allocate(std::span<const PackedVertex> vertices, std::span<const unsigned int> indices);
+  // Another index range over the vertices of base (a level of detail). The
+  // result owns only its indices and must not be drawn once base is released.
+  GeometryAllocation AllocateIndices(const GeometryAllocation& base, std::span<const unsigned int> indices);
+
+  [[nodiscard]] unsigned int vao(VertexFormat format = VertexFormat::kFloat) const
+  {
+    return vaos_[static_cast<std::size_t>(format)];
+  }
+  // VAO reading the arena plus a mat4 per instance from instance_buffer
+  unsigned int CreateInstancedVao(unsigned int instance_buffer, VertexFormat format = VertexFormat::kFloat);
+  // VAO reading the arena plus a uint per instance at kDrawIdLocation. With
+  // instanceCount 1 and baseInstance set to the draw index, the attribute
+  // hands each indirect draw its own index (no gl_DrawID before GL 4.6).
+  unsigned int CreateDrawIdVao(unsigned int draw_id_buffer, VertexFormat format = VertexFormat::kFloat);
+  void DeleteVao(unsigned int vao);
+
+  [[nodiscard]] unsigned int vertex_buffer(VertexFormat format = VertexFormat::kFloat) const
+  {
+    return vertex_pools_[static_cast<std::size_t>(format)].buffer;
+  }
+  [[nodiscard]] unsigned int index_buffer() const { return index_buffer_; }
+  [[nodiscard]] std::size_t used_bytes() const;
+  [[nodiscard]] std::size_t capacity_bytes() const;
+
+ private:
+  friend class GeometryAllocation;
+
+  struct VertexPool
+  {
+    FreeListAllocator allocator;
+    unsigned int buffer = 0;
+    std::size_t stride = 0;
+  };
+  struct InstancedVao
+  {
+    unsigned int vao;
+    VertexFormat format;
+  };
+
+  GeometryAllocation Allocate(VertexFormat format, const void* vertices, std::size_t vertex_count,
+                              std::span<const unsigned int> indices);
+  // Fills the index range of allocation, narrowed to 16 bits when they fit
+  void WriteIndices(GeometryAllocation& allocation, std::span<const unsigned int> indices);
+  void Release(const GeometryAllocation& allocation);
+  // Doubles (at least) the buffer behind allocator, keeping its contents
+  void Grow(FreeListAllocator& allocator, unsigned int& buffer, std::size_t stride, std::size_t request);
+  [[nodiscard]] unsigned int CreateVertexArray(VertexFormat format, bool tangent) const;
+  void AttachBuffers(unsigned int vao, VertexFormat format) const;
+
+  VertexPool vertex_pools_[kVertexFormatCount];
+  FreeListAllocator indices_; // 32-bit words
+  unsigned int index_buffer_ = 0;
+  unsigned int vaos_[kVertexFormatCount] = {};
+  std::vector<InstancedVao> instanced_vaos_;
+};
+
+#endif // GEOMETRY_ARENA_H
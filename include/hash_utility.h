@@ -0,0 +1,37 @@
+#ifndef HASH_UTILITY_H
+#define HASH_UTILITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gpr5300
+{
+
+// 64-bit FNV-1a, used for cache keys and content addressing. Not cryptographic.
+inline constexpr std::uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+inline constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+inline std::uint64_t HashBytes(std::uint64_t hash, const void* data, std::size_t size)
+{
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+template <typename T>
+std::uint64_t HashValue(std::uint64_t hash, const T& value)
+{
+  return HashBytes(hash, &value, sizeof(T));
+}
+
+// Hash of a whole file's contents, 0 if it cannot be read.
+std::uint64_t HashFile(const std::string& path);
+
+} // namespace gpr5300
+
+#endif // HASH_UTILITY_H
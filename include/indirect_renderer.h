@@ -0,0 +1,127 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "vertex_packing.h"
+
+struct Frustum;
+class Mesh;
+class Model;
+class Shader;
+
+// Shader storage binding of the DrawRecords block (data/shaders/scene3d/model_indirect.vert)
+inline constexpr unsigned int kDrawRecordBinding = 0;
+
+// Layout of glMultiDrawElementsIndirect commands
+struct DrawElementsIndirectCommand
+{
+  std::uint32_t count;
+  std::uint32_t instance_count;
+  std::uint32_t first_index;
+  std::int32_t base_vertex;
+  std::uint32_t base_instance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand is read by the GPU");
+
+// Per-mesh data, one std430 DrawRecord per queued mesh, shared by its commands
+struct DrawRecord
+{
+  glm::mat4 model;
+  std::uint32_t material;
+  std::uint32_t padding[3];
+};
+static_assert(sizeof(DrawRecord) == 80, "DrawRecord must match the std430 DrawRecord struct");
+
+// Multi-draw indirect path for static meshes living in GeometryArena.
+//
+// Meshes are queued with their model matrix and drawn at the level of detail
+// picked by SetLodSelection. With SetMeshletCulling, meshes outside the
+// frustum are dropped and full-detail meshes only keep their visible meshlets
+// (meshlet.h), as one command per run of consecutive visible meshlets.
+//
+// Submit groups the commands by material (the same textures bound to the same
+// samplers), vertex format and index type, writes the commands and one
+// DrawRecord per mesh into the frame's StreamBuffer range and issues a single
+// glMultiDrawElementsIndirect per group. Each command's
+// baseInstance is the index of its mesh's DrawRecord, which reaches the vertex
+// shader through the draw-id VAO (GeometryArena::CreateDrawIdVao).
+//
+// The CPU-side vectors are kept between frames, so steady-state frames do
+// not allocate. GL thread only.
+class IndirectRenderer
+{
+ public:
+  void Create();
+  void Delete();
+
+  // Starts a new frame's list of draws
+  void Clear();
+  // Level of detail of the meshes added next. By default every mesh is drawn
+  // at full detail.
+  void SetLodSelection(const LodSelector& selector, const glm::vec3& camera_position);
+  // Culling of the meshes added next against frustum (world space), and of
+  // their meshlets against it and camera_position. nullptr disables culling.
+  void SetMeshletCulling(const Frustum* frustum, const glm::vec3& camera_position);
+  // Queues every mesh of model. Meshes without geometry are skipped.
+  void Add(const Model& model, const glm::mat4& transform);
+  void Add(const Mesh& mesh, const glm::mat4& transform);
+  // Streams the commands and records and draws every queued mesh with shader,
+  // which must already be in use
+  void Submit(const Shader& shader);
+
+  // Counters of the last Submit
+  [[nodiscard]] std::size_t draw_calls() const { return draw_calls_; }
+  [[nodiscard]] std::size_t draw_count() const { return command_count_; }
+  [[nodiscard]] std::size_t material_count() const { return buckets_.size(); }
+  // Triangles and meshlets kept by culling since the last Clear
+  [[nodiscard]] const MeshletCullStats& cull_stats() const { return cull_stats_; }
+
+ private:
+  struct QueuedDraw
+  {
+    const Mesh* mesh;
+    glm::mat4 transform;
+    std::uint32_t material;
+    std::uint32_t lod;
+    std::uint32_t first_range; // Index ranges of the mesh to draw, in ranges_
+    std::uint32_t range_count;
+  };
+  struct Bucket
+  {
+    const Mesh* material; // First mesh seen with this material, binds the textures
+    unsigned int index_type; // Of the level drawn, levels of detail may narrow their indices
+    std::uint32_t first_command;
+    std::uint32_t command_count;
+  };
+
+  // Adds command_count commands to the bucket of mesh's material
+  [[nodiscard]] std::uint32_t FindMaterial(const Mesh& mesh, unsigned int index_type, std::uint32_t command_count);
+  // Grows the draw-id buffer to hold at least count records. Its name is
+  // kept, so the VAO binding stays valid.
+  void Reserve(std::size_t count);
+
+  unsigned int draw_id_buffer_ = 0;
+  unsigned int vaos_[kVertexFormatCount] = {};
+  std::size_t capacity_ = 0;
+
+  std::vector<QueuedDraw> queued_;
+  std::vector<IndexRange> ranges_;
+  std::vector<Bucket> buckets_;
+  std::vector<std::uint32_t> cursors_; // Next command of each bucket while sorting
+  LodSelector lod_selector_;
+  glm::vec3 camera_position_{0.0f};
+  const Frustum* frustum_ = nullptr;
+  glm::vec3 cull_camera_position_{0.0f};
+  MeshletCullStats cull_stats_;
+  std::size_t draw_calls_ = 0;
+  std::size_t command_count_ = 0;
+};
+
+#endif // INDIRECT_RENDERER_H
@@ -0,0 +1,61 @@
+#ifndef INSTANCE_CULLING_H
+#define INSTANCE_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/mat4x4.hpp>
+
+#include "bounds.h"
+#include "frustum_culling.h"
+
+struct Frustum;
+
+namespace gpr5300
+{
+class ThreadPool;
+}
+
+// Frustum culling of many instances of one model, spread over a thread pool.
+//
+// Instances are split into chunks of kChunkSize. Each chunk places the
+// model's local bounding sphere with every instance transform, culls the
+// spheres in SIMD batches (CullSpheres) and keeps its visible indices apart.
+// A prefix sum over the chunk counts then gives each chunk its place in the
+// compacted output, which the chunks fill in parallel: the visible indices,
+// and with Compact the visible transforms themselves, in instance order.
+//
+// The per-chunk storage is kept between calls, so steady-state frames do not
+// allocate. One culler per instance set; Cull must run on one thread at a time.
+class InstanceCuller
+{
+ public:
+  static constexpr std::size_t kChunkSize = 4096;
+
+  // Indices of the instances whose sphere touches the frustum, increasing.
+  // Valid until the next Cull. Without pool, everything runs on the caller.
+  std::span<const std::uint32_t> Cull(const Frustum& frustum, std::span<const glm::mat4> transforms,
+                                      const BoundingSphere& local_sphere, gpr5300::ThreadPool* pool = nullptr);
+  // Copies the transforms of the last Cull's visible instances to out, which
+  // holds at least visible().size() matrices (a StreamBuffer slice, say)
+  void Compact(std::span<const glm::mat4> transforms, std::span<glm::mat4> out,
+               gpr5300::ThreadPool* pool = nullptr) const;
+
+  [[nodiscard]] std::span<const std::uint32_t> visible() const { return {visible_.data(), visible_count_}; }
+
+ private:
+  struct Chunk
+  {
+    SphereSoa spheres;
+    std::vector<std::uint32_t> visible; // Instance indices
+    std::size_t visible_count = 0;
+    std::size_t first_output = 0; // In visible_
+  };
+
+  std::vector<Chunk> chunks_;
+  std::vector<std::uint32_t> visible_;
+  std::size_t visible_count_ = 0;
+};
+
+#endif // INSTANCE_CULLING_H
@@ -0,0 +1,21 @@
+#ifndef MAPPED_IO_SYSTEM_H
+#define MAPPED_IO_SYSTEM_H
+
+#include <assimp/DefaultIOSystem.h>
+
+namespace gpr5300
+{
+
+// Assimp file system that serves every file opened for reading (the .gltf
+// itself and its .bin buffers) from a MappedFile, so large geometry buffers
+// are copied once out of the page cache instead of through stdio buffers.
+// Writes fall back to the default implementation.
+class MappedIOSystem final : public Assimp::DefaultIOSystem
+{
+ public:
+  Assimp::IOStream* Open(const char* file, const char* mode = "rb") override;
+};
+
+} // namespace gpr5300
+
+#endif // MAPPED_IO_SYSTEM_H
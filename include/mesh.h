@@ -1,12 +1,24 @@
 ﻿#ifndef MESH_H
 #define MESH_H
 
+#include <algorithm>
+#include <cfloat>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "bounds.h"
+#include "geometry_arena.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "shader.h"
+#include "vertex_packing.h"
+
 // Définition de la structure de sommet incluant la position, la normale,
 // les coordonnées de texture et la tangente pour le normal mapping.
 struct Vertex {
@@ -16,104 +28,271 @@ struct Vertex {
   glm::vec3 Tangent;
 };
 
+// Sphère centrée sur la boîte englobante, rayon jusqu'au sommet le plus éloigné :
+// plus serrée que la demi-diagonale de la boîte
+inline BoundingSphere ComputeBoundingSphere(std::span<const Vertex> vertices, const glm::vec3& aabb_min,
+                                            const glm::vec3& aabb_max)
+{
+  BoundingSphere sphere{(aabb_min + aabb_max) * 0.5f, 0.0f};
+  float radius_squared = 0.0f;
+  for (const Vertex& vertex : vertices)
+  {
+    const glm::vec3 offset = vertex.Position - sphere.center;
+    radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+  }
+  sphere.radius = std::sqrt(radius_squared);
+  return sphere;
+}
+
 struct Texture {
   unsigned int id;
   std::string type;
   std::string path;
 };
 
+// Niveau de détail simplifié (voir GenerateLods) : un autre jeu d'indices sur
+// les mêmes sommets, et l'erreur géométrique qu'il introduit (unités du modèle)
+struct MeshLodData {
+  std::vector<unsigned int> indices;
+  float error = 0.0f;
+};
+
+// Données d'un mesh côté CPU uniquement (aucun appel GL) : produites par l'import
+// sur les threads de chargement, puis transformées en Mesh sur le thread GL.
+// Les textures ne portent que leur type et leur chemin, l'id est résolu par le Model.
+struct MeshData {
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+  std::vector<Texture> textures;
+  glm::vec3 aabb_min = glm::vec3(FLT_MAX);
+  glm::vec3 aabb_max = glm::vec3(-FLT_MAX);
+  BoundingSphere bounding_sphere;
+  // Sommets compactés sur le thread de chargement ; vide si le mesh reste en float
+  std::vector<PackedVertex> packed_vertices;
+  // Niveaux de détail 1 et suivants, du plus fin au plus grossier
+  std::vector<MeshLodData> lods;
+  // Découpage des indices du niveau 0 pour le culling (BuildMeshlets)
+  std::vector<Meshlet> meshlets;
+};
+
 class Mesh {
  public:
-  // Données du mesh
+  // Données du mesh. Les sommets et indices ne sont qu'une copie CPU de ce qui est
+  // dans GeometryArena : ReleaseCpuData les libère une fois l'upload fait.
   std::vector<Vertex> vertices_;
   std::vector<unsigned int> indices_;
   std::vector<Texture> textures_;
 
-  // Retourne le VAO du mesh
-  [[nodiscard]] unsigned int VAO() const { return VAO_; }
+  // Boîte englobante locale du mesh
+  glm::vec3 aabb_min_ = glm::vec3(FLT_MAX);
+  glm::vec3 aabb_max_ = glm::vec3(-FLT_MAX);
+  // Sphère englobante locale, calculée une fois à l'import (TransformSphere pour l'espace monde)
+  [[nodiscard]] const BoundingSphere& bounding_sphere() const { return bounding_sphere_; }
 
-  // Constructeur : stocke les données du mesh et initialise le VAO/VBO/EBO.
-  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+  // VAO partagé par tous les meshes d'un même format de sommet (voir GeometryArena)
+  [[nodiscard]] static unsigned int VAO(VertexFormat format = VertexFormat::kFloat)
   {
-    this->vertices_ = vertices;
-    this->indices_ = indices;
-    this->textures_ = textures;
+    return GeometryArena::Default().vao(format);
+  }
+  [[nodiscard]] VertexFormat vertex_format() const { return geometry_.vertex_format(); }
+  // Emplacement des sommets et indices du mesh dans les buffers partagés. Les
+  // niveaux de détail n'ont que leurs indices, ils partagent les sommets du niveau 0.
+  [[nodiscard]] const GeometryAllocation& geometry(std::size_t lod = 0) const
+  {
+    return lod == 0 ? geometry_ : lods_[lod - 1];
+  }
 
-    SetupMesh();
+  // Niveaux de détail : 1 (le mesh seul) à kMaxMeshLods
+  [[nodiscard]] std::size_t lod_count() const { return lods_.size() + 1; }
+  // Erreur géométrique de chaque niveau, croissante, lod_errors()[0] == 0
+  [[nodiscard]] std::span<const float> lod_errors() const { return lod_errors_; }
+  void AddLod(std::span<const unsigned int> indices, float error)
+  {
+    if (indices.empty() || lod_count() >= kMaxMeshLods)
+      return;
+    lods_.push_back(GeometryArena::Default().AllocateIndices(geometry_, indices));
+    lod_errors_.push_back(std::max(error, lod_errors_.back()));
   }
+  // Meshlets du niveau 0, vide si le mesh n'a pas été découpé
+  [[nodiscard]] std::span<const Meshlet> meshlets() const { return meshlets_; }
+  void set_meshlets(std::vector<Meshlet> meshlets) { meshlets_ = std::move(meshlets); }
 
-  // Fonction de dessin : lie les textures, puis dessine le mesh
-  void Draw(GLuint& shader)
+  // Niveau le plus grossier dont l'erreur projetée reste sous le seuil du sélecteur
+  [[nodiscard]] std::size_t SelectLod(const LodSelector& selector, const glm::mat4& transform,
+                                      const glm::vec3& camera_position) const
+  {
+    return selector.Select(lod_errors_, transform, aabb_min_, aabb_max_, camera_position);
+  }
+
+  // Constructeur : prend possession des données du mesh (passées par std::move
+  // pour éviter toute copie) et les copie dans GeometryArena.
+  // VertexFormat::kPacked n'est qu'une demande : le mesh reste en float si la
+  // compression dépasse la tolérance (voir PackVertices).
+  Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+       VertexFormat format = VertexFormat::kFloat)
+      : vertices_(std::move(vertices)),
+        indices_(std::move(indices)),
+        textures_(std::move(textures))
+  {
+    for (const Vertex& vertex : vertices_)
+    {
+      aabb_min_ = glm::min(aabb_min_, vertex.Position);
+      aabb_max_ = glm::max(aabb_max_, vertex.Position);
+    }
+    bounding_sphere_ = ComputeBoundingSphere(vertices_, aabb_min_, aabb_max_);
+
+    NameSamplers();
+    Upload(vertices_, indices_, format);
+  }
+
+  // Constructeur depuis des données préparées sur un thread de chargement. Des
+  // sommets déjà compactés (data.packed_vertices) sont envoyés tels quels.
+  explicit Mesh(MeshData data, VertexFormat format = VertexFormat::kFloat)
+      : vertices_(std::move(data.vertices)),
+        indices_(std::move(data.indices)),
+        textures_(std::move(data.textures)),
+        aabb_min_(data.aabb_min),
+        aabb_max_(data.aabb_max),
+        meshlets_(std::move(data.meshlets)),
+        bounding_sphere_(data.bounding_sphere)
+  {
+    NameSamplers();
+    if (!data.packed_vertices.empty())
+      geometry_ = GeometryArena::Default().Allocate(std::span<const PackedVertex>(data.packed_vertices), indices_);
+    else
+      Upload(vertices_, indices_, format);
+    for (const MeshLodData& lod : data.lods)
+      AddLod(lod.indices, lod.error);
+  }
+
+  // Constructeur depuis des données déjà préparées (cache binaire) : les bornes
+  // sont fournies et l'upload se fait directement depuis la mémoire mappée. Sans
+  // keep_cpu_data, le mesh ne garde aucune copie CPU des sommets et indices.
+  Mesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices, std::vector<Texture> textures,
+       const glm::vec3& aabb_min, const glm::vec3& aabb_max, const BoundingSphere& bounding_sphere,
+       VertexFormat format = VertexFormat::kFloat, bool keep_cpu_data = true)
+      : textures_(std::move(textures)),
+        aabb_min_(aabb_min),
+        aabb_max_(aabb_max),
+        bounding_sphere_(bounding_sphere)
+  {
+    if (keep_cpu_data)
+    {
+      vertices_.assign(vertices.begin(), vertices.end());
+      indices_.assign(indices.begin(), indices.end());
+    }
+    NameSamplers();
+    Upload(vertices, indices, format);
+  }
+
+  Mesh(Mesh&&) noexcept = default;
+  Mesh& operator=(Mesh&&) noexcept = default;
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+
+  // Fonction de dessin : lie les textures, puis dessine le mesh.
+  void Draw(const Shader& shader) const
+  {
+    glBindVertexArray(VAO(vertex_format()));
+    BindTextures(shader);
+    DrawElements();
+    glBindVertexArray(0);
+  }
+
+  // Les noms des samplers sont construits une seule fois (NameSamplers) : ici
+  // il n'y a qu'une recherche dans la table des uniformes du shader.
+  void BindTextures(const Shader& shader) const
   {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
     for (unsigned int i = 0; i < textures_.size(); i++)
     {
       glActiveTexture(GL_TEXTURE0 + i); // Activation de l'unité de texture appropriée
-      // Récupération du numéro de la texture en fonction de son type
-      std::string number;
-      std::string name = textures_[i].type;
-      if (name == "texture_diffuse")
-        number = std::to_string(diffuseNr++);
-      else if (name == "texture_specular")
-        number = std::to_string(specularNr++);
-
-      // Envoi de l'uniforme au shader
-      glUniform1i(glGetUniformLocation(shader, ("material." + name).append(number).c_str()), i);
+      // "material.texture_diffuse1", ou "texture_diffuse1" pour les shaders sans struct material
+      const std::string_view name = sampler_names_[i];
+      Uniform<int> sampler = shader.GetUniform<int>(name);
+      if (!sampler.valid())
+        sampler = shader.GetUniform<int>(name.substr(kMaterialPrefix.size()));
+      shader.Set(sampler, static_cast<int>(i));
       glBindTexture(GL_TEXTURE_2D, textures_[i].id);
     }
     glActiveTexture(GL_TEXTURE0);
-
-    // Dessin du mesh
-    glBindVertexArray(VAO_);
-    glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
   }
 
-  // Retourne les sommets du mesh
-  const std::vector<Vertex>& get_vertices() const
+  // Dessin seul, le VAO de l'arène (ou un VAO instancié) du format du mesh doit être lié.
+  // Les indices sont en 16 ou 32 bits selon le mesh (voir GeometryArena::Allocate).
+  void DrawElements(const std::size_t lod = 0) const
   {
-    return vertices_;
+    const GeometryAllocation& geometry = this->geometry(lod);
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(geometry.index_count()), geometry.index_type(),
+                             geometry.index_byte_offset(), geometry.base_vertex());
   }
-  unsigned int VAO_, VBO_, EBO_;
- private:
-  // Données de rendu
 
-
-  // Configuration du VAO, VBO et EBO et des attributs de sommet
-  void SetupMesh()
+  // base_instance : première matrice lue dans le buffer d'instances
+  void DrawElementsInstanced(const GLsizei instance_count, const std::size_t lod = 0,
+                             const GLuint base_instance = 0) const
   {
-    glGenVertexArrays(1, &VAO_);
-    glGenBuffers(1, &VBO_);
-    glGenBuffers(1, &EBO_);
-
-    glBindVertexArray(VAO_);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), &vertices_[0], GL_STATIC_DRAW);
+    const GeometryAllocation& geometry = this->geometry(lod);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(geometry.index_count()),
+                                                  geometry.index_type(), geometry.index_byte_offset(),
+                                                  instance_count, geometry.base_vertex(), base_instance);
+  }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int),
-                 &indices_[0], GL_STATIC_DRAW);
+  // Copie CPU des sommets et indices du niveau 0, vide après ReleaseCpuData
+  [[nodiscard]] std::span<const Vertex> vertices() const { return vertices_; }
+  [[nodiscard]] std::span<const unsigned int> indices() const { return indices_; }
+  [[nodiscard]] std::span<const Texture> textures() const { return textures_; }
+  [[nodiscard]] bool has_cpu_data() const { return !vertices_.empty() || !indices_.empty(); }
 
-    // Configuration des attributs de sommet :
+  // Libère la copie CPU des sommets et indices : le dessin n'utilise que
+  // GeometryArena, les bornes et les meshlets restent disponibles.
+  void ReleaseCpuData()
+  {
+    std::vector<Vertex>().swap(vertices_);
+    std::vector<unsigned int>().swap(indices_);
+  }
 
-    // Positions (location = 0)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+ private:
+  // Données de rendu
+  GeometryAllocation geometry_;
+  std::vector<GeometryAllocation> lods_;
+  std::vector<float> lod_errors_ = {0.0f};
+  std::vector<Meshlet> meshlets_;
+  BoundingSphere bounding_sphere_;
 
-    // Normales (location = 1)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+  static constexpr std::string_view kMaterialPrefix = "material.";
 
-    // Coordonnées de texture (location = 2)
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+  // Nom de l'uniforme de chaque texture : le type suivi de son numéro parmi les
+  // textures du même type (texture_diffuse1, texture_diffuse2, texture_specular1...)
+  std::vector<std::string> sampler_names_;
 
-    // Tangentes (location = 3)
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+  // Copie les sommets dans l'arène, compactés si c'est demandé et assez précis
+  void Upload(std::span<const Vertex> vertices, std::span<const unsigned int> indices, const VertexFormat format)
+  {
+    if (format == VertexFormat::kPacked)
+    {
+      std::vector<PackedVertex> packed;
+      if (PackVertices(vertices, aabb_min_, aabb_max_, packed))
+      {
+        geometry_ = GeometryArena::Default().Allocate(std::span<const PackedVertex>(packed), indices);
+        return;
+      }
+    }
+    geometry_ = GeometryArena::Default().Allocate(vertices, indices);
+  }
 
-    glBindVertexArray(0);
+  void NameSamplers()
+  {
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    sampler_names_.clear();
+    for (const Texture& texture : textures_)
+    {
+      std::string name = std::string(kMaterialPrefix) + texture.type;
+      if (texture.type == "texture_diffuse")
+        name += std::to_string(diffuseNr++);
+      else if (texture.type == "texture_specular")
+        name += std::to_string(specularNr++);
+      sampler_names_.push_back(std::move(name));
+    }
   }
 };
 
@@ -0,0 +1,143 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <glm/vec3.hpp>
+
+#include "file_utility.h"
+#include "mesh.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+
+// Baked mesh cache: the post-processed Vertex/index arrays of a model, its
+// material-to-texture bindings and per-mesh bounds, written next to the source
+// asset so warm starts can skip Assimp entirely.
+//
+// Layout (native endianness, every section 16-byte aligned):
+//   MeshCacheHeader
+//   MeshCacheMeshRecord[mesh_count]
+//   MeshCacheMaterialRecord[material_count]
+//   MeshCacheBindingRecord[binding_count]
+//   char strings[string_bytes]
+//   Vertex vertices[]
+//   unsigned int indices[]   each mesh's indices, then those of its levels of detail
+//   Meshlet meshlets[]
+
+inline constexpr std::string_view kMeshCacheExtension = ".meshcache";
+// 2: geometry run through OptimizeMesh (mesh_optimizer.h) before being written
+// 3: meshes split by SplitForShortIndices
+// 4: levels of detail (mesh_lod.h) stored after each mesh's indices
+// 5: meshlets (meshlet.h)
+// 6: bounding spheres
+// 7: bounding spheres of the parts made by SplitForShortIndices
+inline constexpr std::uint32_t kMeshCacheVersion = 7;
+
+struct MeshCacheHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t import_flags;
+  std::uint64_t key;
+  std::uint32_t mesh_count;
+  std::uint32_t material_count;
+  std::uint32_t binding_count;
+  std::uint32_t string_bytes;
+  std::uint64_t vertex_count;
+  std::uint64_t index_count;
+  std::uint64_t meshlet_count;
+};
+
+struct MeshCacheMeshRecord
+{
+  std::uint32_t first_vertex;
+  std::uint32_t vertex_count;
+  std::uint32_t first_index;
+  std::uint32_t index_count; // Level 0 only
+  std::uint32_t material;
+  float aabb_min[3];
+  float aabb_max[3];
+  float bounding_radius; // Sphere centered on the box
+  std::uint32_t lod_count; // Levels after level 0
+  std::uint32_t lod_index_count[kMaxMeshLods - 1];
+  float lod_error[kMaxMeshLods - 1];
+  std::uint32_t first_meshlet;
+  std::uint32_t meshlet_count;
+};
+
+struct MeshCacheMaterialRecord
+{
+  std::uint32_t first_binding;
+  std::uint32_t binding_count;
+};
+
+struct MeshCacheBindingRecord
+{
+  std::uint32_t type_offset;
+  std::uint32_t type_length;
+  std::uint32_t path_offset;
+  std::uint32_t path_length;
+};
+
+struct MeshCacheBinding
+{
+  std::string_view type;
+  std::string_view path;
+};
+
+// Hash of the source file contents, the sibling .bin buffers (size and
+// modification time) and the Assimp import flags. Returns 0 if the source
+// cannot be read, which never matches a cache.
+std::uint64_t ComputeMeshCacheKey(const std::string& source_path, unsigned int import_flags);
+
+// Writes the meshes of a freshly imported model. Identical texture lists are
+// folded into one material entry.
+bool WriteMeshCache(const std::string& cache_path, std::uint64_t key, unsigned int import_flags,
+                    std::span<const MeshData> meshes);
+
+// Read-only view over a memory mapped cache file. Vertex and index spans point
+// straight into the mapping and stay valid while the object is alive.
+class MeshCacheFile
+{
+ public:
+  MeshCacheFile() = default;
+  ~MeshCacheFile();
+  MeshCacheFile(const MeshCacheFile&) = delete;
+  MeshCacheFile& operator=(const MeshCacheFile&) = delete;
+
+  // Maps the file and validates it against the expected key. Returns false if
+  // the cache is missing, truncated or stale.
+  bool Open(const std::string& cache_path, std::uint64_t key, unsigned int import_flags);
+  void Close();
+
+  [[nodiscard]] std::size_t mesh_count() const { return header_ ? header_->mesh_count : 0; }
+  [[nodiscard]] std::span<const Vertex> vertices(std::size_t mesh) const;
+  [[nodiscard]] std::span<const unsigned int> indices(std::size_t mesh) const;
+  // Levels of detail after level 0: lod goes from 1 to lod_count(mesh)
+  [[nodiscard]] std::size_t lod_count(std::size_t mesh) const { return meshes_[mesh].lod_count; }
+  [[nodiscard]] std::span<const unsigned int> lod_indices(std::size_t mesh, std::size_t lod) const;
+  [[nodiscard]] float lod_error(std::size_t mesh, std::size_t lod) const { return meshes_[mesh].lod_error[lod - 1]; }
+  [[nodiscard]] std::span<const Meshlet> meshlets(std::size_t mesh) const;
+  [[nodiscard]] glm::vec3 aabb_min(std::size_t mesh) const;
+  [[nodiscard]] glm::vec3 aabb_max(std::size_t mesh) const;
+  [[nodiscard]] BoundingSphere bounding_sphere(std::size_t mesh) const;
+  [[nodiscard]] std::size_t binding_count(std::size_t mesh) const;
+  [[nodiscard]] MeshCacheBinding binding(std::size_t mesh, std::size_t index) const;
+
+ private:
+  gpr5300::MappedFile file_;
+
+  const MeshCacheHeader* header_ = nullptr;
+  const MeshCacheMeshRecord* meshes_ = nullptr;
+  const MeshCacheMaterialRecord* materials_ = nullptr;
+  const MeshCacheBindingRecord* bindings_ = nullptr;
+  const char* strings_ = nullptr;
+  const Vertex* vertices_ = nullptr;
+  const unsigned int* indices_ = nullptr;
+  const Meshlet* meshlets_ = nullptr;
+};
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,60 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+struct MeshData;
+struct Vertex;
+
+// Discrete levels of detail.
+//
+// At import time GenerateLods simplifies each mesh with quadric error metrics
+// (Garland & Heckbert edge collapses onto existing vertices) into up to
+// kMaxMeshLods - 1 coarser index buffers over the same vertices. Each level
+// records its geometric error, in object space: the largest, over its
+// collapses, of the kept vertex's area-weighted RMS distance to the original
+// planes around it. It estimates how far the surface moved, it does not
+// bound it; single vertices may move farther.
+//
+// At draw time LodSelector projects that error to pixels from the distance
+// to the camera, fovY and the viewport height, and picks the coarsest level
+// whose estimate stays under a pixel budget: a target, not a guarantee.
+
+// Including the full-detail level 0
+inline constexpr std::size_t kMaxMeshLods = 4;
+
+// Index buffer over the same vertices with at most target_index_count
+// indices, or as close to it as collapses below max_error allow. error
+// receives the geometric error reached, in object-space units.
+[[nodiscard]] std::vector<unsigned int> SimplifyMesh(std::span<const Vertex> vertices,
+                                                     std::span<const unsigned int> indices,
+                                                     std::size_t target_index_count, float max_error,
+                                                     float* error = nullptr);
+
+// Fills mesh.lods, each level with about half the triangles of the previous
+// one. Stops early when a level would not remove at least 10% of them.
+void GenerateLods(MeshData& mesh);
+
+struct LodSelector
+{
+  float pixels_per_unit = 0.0f; // Size in pixels of one unit at distance 1
+  float max_pixel_error = 1.0f;
+
+  [[nodiscard]] static LodSelector FromCamera(float fov_y, float viewport_height, float max_pixel_error = 1.0f);
+
+  // Object-space error seen at distance, in pixels
+  [[nodiscard]] float ProjectedError(float error, float distance, float scale = 1.0f) const;
+  // errors[i] is the error of level i, increasing, errors[0] == 0
+  [[nodiscard]] std::size_t Select(std::span<const float> errors, float distance, float scale = 1.0f) const;
+  // Same, from the bounds of the mesh placed by transform. The distance is
+  // taken to the nearest point of the bounding sphere.
+  [[nodiscard]] std::size_t Select(std::span<const float> errors, const glm::mat4& transform,
+                                   const glm::vec3& aabb_min, const glm::vec3& aabb_max,
+                                   const glm::vec3& camera_position) const;
+};
+
+#endif // MESH_LOD_H
@@ -0,0 +1,76 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+struct MeshData;
+struct Vertex;
+
+// Import-time geometry optimization for indexed triangle lists, CPU only.
+//
+// OptimizeMesh chains the four passes in the order they must run:
+//   1. DeduplicateVertices  merges bitwise-identical vertices
+//   2. OptimizeVertexCache  reorders triangles for the post-transform cache
+//                           (Forsyth's linear-speed algorithm)
+//   3. OptimizeOverdraw     splits the cache-friendly order into clusters and
+//                           draws outward-facing clusters first, keeping the
+//                           cache miss ratio within a threshold
+//   4. OptimizeVertexFetch  renumbers vertices in first-use order, so the
+//                           vertex fetch streams through memory
+// Model runs it on every imported mesh before the mesh cache is written, then
+// SplitForShortIndices so that every part can use 16-bit indices.
+
+// FIFO size used to measure the post-transform cache, a conservative model of
+// current GPUs
+inline constexpr std::size_t kVertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+  std::size_t triangle_count = 0;
+  std::size_t vertex_count = 0;
+  std::size_t transformed_count = 0; // Vertex shader invocations in the simulated cache
+
+  // Average cache miss ratio: transformed vertices per triangle, 0.5 to 3
+  [[nodiscard]] float acmr() const
+  {
+    return triangle_count == 0 ? 0.0f : static_cast<float>(transformed_count) / static_cast<float>(triangle_count);
+  }
+  // Average transform to vertex ratio: 1 means every vertex is shaded once
+  [[nodiscard]] float atvr() const
+  {
+    return vertex_count == 0 ? 0.0f : static_cast<float>(transformed_count) / static_cast<float>(vertex_count);
+  }
+};
+
+// Simulates a FIFO post-transform cache over the index buffer
+[[nodiscard]] VertexCacheStats AnalyzeVertexCache(std::span<const unsigned int> indices, std::size_t vertex_count,
+                                                  std::size_t cache_size = kVertexCacheSize);
+
+// Returns the number of vertices removed
+std::size_t DeduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+void OptimizeVertexCache(std::span<unsigned int> indices, std::size_t vertex_count);
+// threshold bounds the ACMR of the result relative to the input's
+void OptimizeOverdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices, float threshold = 1.05f);
+// Drops unreferenced vertices
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::span<unsigned int> indices);
+
+struct MeshOptimizationReport
+{
+  VertexCacheStats before;
+  VertexCacheStats after;
+  std::size_t duplicates_removed = 0;
+};
+
+// Runs the four passes. Index buffers that are not a triangle list (point or
+// line primitives) are left untouched.
+MeshOptimizationReport OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Replaces every triangle-list mesh with more than kShortIndexVertexLimit
+// vertices (geometry_arena.h) by parts that each fit 16-bit indices. Triangle
+// order is kept, each part's vertices are numbered in first-use order, and each
+// part gets its own box and bounding sphere.
+void SplitForShortIndices(std::vector<MeshData>& meshes);
+
+#endif // MESH_OPTIMIZER_H
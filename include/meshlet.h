@@ -0,0 +1,70 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+struct Frustum;
+struct Vertex;
+
+// Meshlets: consecutive runs of a mesh's triangles small enough to be culled
+// one by one.
+//
+// BuildMeshlets grows each meshlet from the first free triangle in the
+// vertex-cache-optimized order, through the neighbouring triangles that add the
+// fewest vertices and stay closest to its average normal, up to
+// kMeshletMaxTriangles triangles touching at most kMeshletMaxVertices vertices.
+// The triangles are then reordered so that each meshlet is a contiguous index
+// range, optimized for the vertex cache on its own: a meshlet is only that
+// range plus its bounds.
+//
+// CullMeshlets tests each meshlet's bounding sphere against the frustum and
+// its normal cone against the camera position, and returns the index ranges
+// left, with adjacent visible meshlets merged into one range.
+
+inline constexpr std::size_t kMeshletMaxVertices = 64;
+inline constexpr std::size_t kMeshletMaxTriangles = 124;
+
+struct Meshlet
+{
+  std::uint32_t first_index; // In the mesh's index buffer
+  std::uint32_t index_count;
+  // Bounding sphere, object space
+  glm::vec3 center;
+  float radius;
+  // Every triangle faces away from a camera at p whenever
+  // dot(normalize(cone_apex - p), cone_axis) >= cone_cutoff
+  glm::vec3 cone_apex;
+  glm::vec3 cone_axis;
+  float cone_cutoff; // Above 1 when the normals spread too wide: never back-face culled
+};
+
+struct IndexRange
+{
+  std::uint32_t first_index;
+  std::uint32_t index_count;
+};
+
+struct MeshletCullStats
+{
+  std::size_t meshlet_count = 0;
+  std::size_t visible_meshlet_count = 0;
+  std::size_t triangle_count = 0;
+  std::size_t visible_triangle_count = 0;
+
+  MeshletCullStats& operator+=(const MeshletCullStats& other);
+};
+
+// Reorders the triangles of indices
+[[nodiscard]] std::vector<Meshlet> BuildMeshlets(std::span<const Vertex> vertices, std::span<unsigned int> indices);
+
+// Appends the visible ranges of the mesh placed by transform (rotation,
+// translation and uniform scale) to visible. frustum is in world space.
+MeshletCullStats CullMeshlets(std::span<const Meshlet> meshlets, const glm::mat4& transform, const Frustum& frustum,
+                              const glm::vec3& camera_position, std::vector<IndexRange>& visible);
+
+#endif // MESHLET_H
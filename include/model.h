@@ -6,22 +6,56 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <vector>
 #include <cstring>
 #include <string>
 #include <cfloat>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+#include "meshlet.h"
 #include "stb_image.h"
+#include "hash_utility.h"
+#include "mapped_io_system.h"
 #include "texture_loader.h"
+#include "texture_registry.h"
+#include "texture_uploader.h"
+#include "thread_pool.h"
 
-// Fonction utilitaire pour charger une texture depuis un fichier
-unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
+// Avancement d'un chargement asynchrone, affichable tel quel dans ImGui
+struct ModelLoadProgress
+{
+  bool importing = true; // Import (cache ou Assimp) encore en cours sur un thread de chargement
+  std::size_t meshes_ready = 0;
+  std::size_t meshes_total = 0;
+  std::size_t textures_ready = 0;
+  std::size_t textures_total = 0;
+
+  [[nodiscard]] float fraction() const
+  {
+    const std::size_t total = meshes_total + textures_total;
+    if (importing)
+      return 0.0f;
+    return total == 0 ? 1.0f : static_cast<float>(meshes_ready + textures_ready) / static_cast<float>(total);
+  }
+};
 
 class Model
 {
  public:
+  // Post-traitements Assimp appliqués à l'import ; ils font partie de la clé du cache.
+  static constexpr unsigned int kImportFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
   Model() = default;
 
   // Constructeur qui charge le modèle depuis un fichier
@@ -30,35 +64,127 @@ class Model
     LoadModel(path);
   }
 
-  // Fonction de dessin : parcourt tous les meshes et les dessine avec le shader donné
-  void Draw(GLuint& shader)
+  // Fonction de dessin : parcourt tous les meshes et les dessine avec le shader donné.
+  // Pendant un chargement asynchrone, seuls les meshes déjà envoyés au GPU sont dessinés.
+  // Les meshes partagent le VAO de GeometryArena de leur format de sommet : un bind
+  // pour tout le modèle, plus un par changement de format.
+  void Draw(const Shader& shader) const
+  {
+    Draw(shader, LodSelector{}, glm::mat4(1.0f), glm::vec3(0.0f));
+  }
+
+  // Même chose, chaque mesh au niveau de détail choisi par selector pour le
+  // modèle placé par transform et vu depuis camera_position.
+  void Draw(const Shader& shader, const LodSelector& selector, const glm::mat4& transform,
+            const glm::vec3& camera_position) const
   {
-    for (auto& meshe : meshes_)
-      meshe.Draw(shader);
+    VertexFormat bound_format = VertexFormat::kFloat;
+    glBindVertexArray(Mesh::VAO(bound_format));
+    for (const Mesh& meshe : meshes_)
+    {
+      if (meshe.vertex_format() != bound_format)
+      {
+        bound_format = meshe.vertex_format();
+        glBindVertexArray(Mesh::VAO(bound_format));
+      }
+      meshe.BindTextures(shader);
+      meshe.DrawElements(meshe.SelectLod(selector, transform, camera_position));
+    }
+    glBindVertexArray(0);
   }
 
-  [[nodiscard]] std::vector<Mesh> meshes(){ return meshes_; }
-  [[nodiscard]] std::vector<Texture> get_textures_loaded(){ return textures_loaded; }
+  [[nodiscard]] const std::vector<Mesh>& meshes() const { return meshes_; }
+
+  // Niveaux de détail du modèle entier, pour choisir un seul niveau par instance :
+  // le niveau l de chaque mesh (ou son plus grossier s'il en a moins), avec
+  // l'erreur du pire de ses meshes.
+  [[nodiscard]] std::size_t lod_count() const
+  {
+    std::size_t count = 1;
+    for (const Mesh& mesh : meshes_)
+      count = std::max(count, mesh.lod_count());
+    return count;
+  }
+  [[nodiscard]] std::array<float, kMaxMeshLods> lod_errors() const
+  {
+    std::array<float, kMaxMeshLods> errors{};
+    for (const Mesh& mesh : meshes_)
+      for (std::size_t lod = 1; lod < kMaxMeshLods; lod++)
+        errors[lod] = std::max(errors[lod], mesh.lod_errors()[std::min(lod, mesh.lod_count() - 1)]);
+    return errors;
+  }
+
+  // Format de sommet demandé pour les meshes chargés ensuite. Avec kPacked, chaque
+  // mesh est compacté s'il reste dans la tolérance de PackVertices, sinon il reste en float.
+  void set_vertex_format(const VertexFormat format) { vertex_format_ = format; }
+  [[nodiscard]] VertexFormat vertex_format() const { return vertex_format_; }
+  // Sans keep_cpu_data, les meshes chargés ensuite libèrent leur copie CPU des
+  // sommets et indices dès qu'ils sont dans GeometryArena (voir Mesh::ReleaseCpuData).
+  void set_keep_cpu_data(const bool keep_cpu_data) { keep_cpu_data_ = keep_cpu_data; }
+  [[nodiscard]] bool keep_cpu_data() const { return keep_cpu_data_; }
+  // Libère la copie CPU des meshes déjà chargés, et passe keep_cpu_data à false pour les suivants
+  void ReleaseCpuData()
+  {
+    keep_cpu_data_ = false;
+    for (Mesh& mesh : meshes_)
+      mesh.ReleaseCpuData();
+  }
+  // Vue sur les textures du modèle, sans copie
+  [[nodiscard]] std::span<const Texture> get_textures_loaded() const { return textures_loaded; }
 
  private:
   // Données du modèle
-  std::vector<Texture> textures_loaded; // S'assure qu'une texture n'est chargée qu'une seule fois.
+  std::vector<Texture> textures_loaded; // Une entrée par chemin de texture du modèle
+  // Références dans TextureRegistry (partagées avec les autres modèles), parallèles à textures_loaded
+  std::vector<TextureHandle> texture_handles_;
+  // Chemin relatif -> index dans textures_loaded
+  std::unordered_map<std::string, std::size_t> texture_indices_;
 
   std::string directory_;
+  VertexFormat vertex_format_ = VertexFormat::kFloat;
+  bool keep_cpu_data_ = true;
+  // Bornes locales de l'ensemble des meshes (UpdateBounds)
+  glm::vec3 aabb_min_ = glm::vec3(FLT_MAX);
+  glm::vec3 aabb_max_ = glm::vec3(-FLT_MAX);
+  BoundingSphere bounding_sphere_;
+  // Textures préchargées en parallèle, pas encore rattachées à un mesh
+  std::unordered_map<std::string, TextureHandle> preloaded_textures_;
+
+  // Image prête à rejoindre le registre ; pixels reste vide si le registre
+  // la possédait déjà au moment du décodage.
+  struct DecodedTexture
+  {
+    Texture texture;
+    std::string canonical_path;
+    std::uint64_t content_hash = 0;
+    TexturePixels pixels;
+  };
+
+  // État partagé avec les threads de chargement ; il survit au Model si celui-ci
+  // est détruit avant la fin de l'import.
+  struct AsyncLoad
+  {
+    std::mutex mutex;
+    std::deque<MeshData> meshes;                    // Prêts pour l'upload
+    std::deque<DecodedTexture> images;              // Décodées, en attente d'upload
+    std::atomic<bool> imported = false;
+    std::atomic<std::size_t> meshes_total = 0;
+    std::atomic<std::size_t> textures_total = 0;
+  };
+  std::shared_ptr<AsyncLoad> async_;
+  // En cours de transfert par TextureUploader
+  std::vector<std::pair<Texture, TextureHandle>> uploading_textures_;
+  ModelLoadProgress progress_{false};
 
  public:
   std::vector<Mesh> meshes_;
-  // Fonction pour récupérer la bounding box du modèle
+  // Boîte englobante locale du modèle, tenue à jour à chaque ajout de meshes
   void GetBoundingBox(glm::vec3& min, glm::vec3& max) const {
-    min = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
-    max = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-    for (const Mesh& mesh : meshes_) {
-      for (const Vertex& vertex : mesh.vertices_) {
-        min = glm::min(min, vertex.Position);
-        max = glm::max(max, vertex.Position);
-      }
-    }
+    min = aabb_min_;
+    max = aabb_max_;
   }
+  // Sphère englobante locale du modèle (TransformSphere pour l'espace monde)
+  [[nodiscard]] const BoundingSphere& bounding_sphere() const { return bounding_sphere_; }
 
   // Chargement du modèle depuis un fichier
   void LoadModel(const std::string& path)
@@ -66,44 +192,312 @@ class Model
     // Pour certains formats (ex. .obj), vous pouvez décommenter la ligne suivante
     // stbi_set_flip_vertically_on_load(true);
 
+    directory_ = path.substr(0, path.find_last_of('/'));
+
+    // Démarrage à chaud : le cache binaire évite tout passage par Assimp
+    const std::string cache_path = path + std::string(kMeshCacheExtension);
+    const std::uint64_t cache_key = ComputeMeshCacheKey(path, kImportFlags);
+    if (LoadFromCache(cache_path, cache_key))
+      return;
+
+    std::vector<MeshData> meshes;
+    if (!ImportWithAssimp(path, meshes))
+      return;
+    WriteMeshCache(cache_path, cache_key, kImportFlags, meshes);
+
+    PreloadTextures(CollectTexturePaths(meshes));
+    meshes_.reserve(meshes.size());
+    for (MeshData& mesh : meshes)
+    {
+      ResolveTextures(mesh.textures);
+      Mesh& added = meshes_.emplace_back(std::move(mesh), vertex_format_);
+      if (!keep_cpu_data_)
+        added.ReleaseCpuData();
+    }
+    UpdateBounds();
+  }
+
+  // Chargement asynchrone : l'import et le décodage des images tournent sur les
+  // threads de chargement, le modèle est dessinable immédiatement (vide au départ).
+  // UpdateAsyncLoad doit ensuite être appelée à chaque frame sur le thread GL.
+  void LoadAsync(const std::string& path, gpr5300::ThreadPool* pool = nullptr)
+  {
+    directory_ = path.substr(0, path.find_last_of('/'));
+    async_ = std::make_shared<AsyncLoad>();
+    progress_ = {};
+
+    gpr5300::ThreadPool& workers = pool ? *pool : gpr5300::ThreadPool::Default();
+    workers.Submit([state = async_, path, directory = directory_, format = vertex_format_,
+                    keep_cpu_data = keep_cpu_data_, &workers]() {
+      std::vector<MeshData> meshes = ImportMeshes(path);
+      // La compression des sommets se fait ici plutôt que sur le thread GL. Les
+      // sommets float ne servent plus à rien une fois compactés sans keep_cpu_data.
+      if (format == VertexFormat::kPacked)
+      {
+        workers.ParallelFor(meshes.size(), [&](const std::size_t i) {
+          if (PackVertices(meshes[i].vertices, meshes[i].aabb_min, meshes[i].aabb_max, meshes[i].packed_vertices) &&
+              !keep_cpu_data)
+            std::vector<Vertex>().swap(meshes[i].vertices);
+        });
+      }
+
+      std::vector<Texture> textures;
+      std::unordered_set<std::string> seen;
+      for (const MeshData& mesh : meshes)
+        for (const Texture& texture : mesh.textures)
+          if (seen.insert(texture.path).second)
+            textures.push_back(texture);
+
+      state->meshes_total = meshes.size();
+      state->textures_total = textures.size();
+      {
+        std::scoped_lock lock(state->mutex);
+        for (MeshData& mesh : meshes)
+          state->meshes.push_back(std::move(mesh));
+      }
+      state->imported = true;
+
+      // Chaque image est publiée dès qu'elle est décodée
+      workers.ParallelFor(textures.size(), [&](const std::size_t i) {
+        DecodedTexture decoded = DecodeTexture(directory, textures[i]);
+        std::scoped_lock lock(state->mutex);
+        state->images.push_back(std::move(decoded));
+      });
+    });
+  }
+
+  // Envoie au GPU ce que les threads de chargement ont produit. Les meshes deviennent
+  // dessinables un par un (au plus mesh_budget par frame) ; leurs textures pointent sur
+  // la texture de repli 1x1 jusqu'à ce que TextureUploader ait fini de les transférer.
+  void UpdateAsyncLoad(std::size_t mesh_budget = 16)
+  {
+    if (!async_)
+      return;
+
+    std::vector<MeshData> meshes;
+    std::vector<DecodedTexture> images;
+    {
+      std::scoped_lock lock(async_->mutex);
+      while (!async_->meshes.empty() && meshes.size() < mesh_budget)
+      {
+        meshes.push_back(std::move(async_->meshes.front()));
+        async_->meshes.pop_front();
+      }
+      while (!async_->images.empty())
+      {
+        images.push_back(std::move(async_->images.front()));
+        async_->images.pop_front();
+      }
+    }
+
+    // Le transfert est étalé sur plusieurs frames par TextureUploader (budget en octets)
+    for (DecodedTexture& decoded : images)
+    {
+      TextureHandle handle = RegisterTexture(decoded, true);
+      if (!handle)
+      {
+        AddLoadedTexture(decoded.texture, {});
+        continue;
+      }
+      decoded.texture.id = handle.id();
+      uploading_textures_.emplace_back(decoded.texture, std::move(handle));
+    }
+
+    for (auto it = uploading_textures_.begin(); it != uploading_textures_.end();)
+    {
+      auto& [texture, handle] = *it;
+      if (TextureUploader::Default().pending(texture.id))
+      {
+        ++it;
+        continue;
+      }
+      for (Mesh& mesh : meshes_)
+        for (Texture& binding : mesh.textures_)
+          if (binding.path == texture.path)
+            binding.id = texture.id;
+      AddLoadedTexture(texture, std::move(handle));
+      it = uploading_textures_.erase(it);
+    }
+
+    for (MeshData& mesh : meshes)
+    {
+      for (Texture& binding : mesh.textures)
+      {
+        binding.id = FallbackTexture();
+        const auto loaded = texture_indices_.find(binding.path);
+        if (loaded != texture_indices_.end() && textures_loaded[loaded->second].id != 0)
+          binding.id = textures_loaded[loaded->second].id;
+      }
+      Mesh& added = meshes_.emplace_back(std::move(mesh));
+      if (!keep_cpu_data_)
+        added.ReleaseCpuData();
+    }
+    if (!meshes.empty())
+      UpdateBounds();
+
+    progress_.importing = !async_->imported;
+    progress_.meshes_ready = meshes_.size();
+    progress_.meshes_total = async_->meshes_total;
+    progress_.textures_ready = textures_loaded.size();
+    progress_.textures_total = async_->textures_total;
+    if (!progress_.importing && progress_.meshes_ready == progress_.meshes_total &&
+        progress_.textures_ready == progress_.textures_total)
+      async_.reset();
+  }
+
+  [[nodiscard]] const ModelLoadProgress& load_progress() const { return progress_; }
+  [[nodiscard]] bool loading() const { return async_ != nullptr; }
+
+  // Chargement depuis le cache : un seul mmap, puis upload direct des tableaux mappés
+  bool LoadFromCache(const std::string& cache_path, std::uint64_t cache_key)
+  {
+    MeshCacheFile cache;
+    if (!cache.Open(cache_path, cache_key, kImportFlags))
+      return false;
+
+    std::vector<std::string> texture_paths;
+    for (std::size_t i = 0; i < cache.mesh_count(); i++)
+      for (std::size_t j = 0; j < cache.binding_count(i); j++)
+        texture_paths.emplace_back(cache.binding(i, j).path);
+    PreloadTextures(texture_paths);
+
+    meshes_.reserve(cache.mesh_count());
+    for (std::size_t i = 0; i < cache.mesh_count(); i++)
+    {
+      std::vector<Texture> textures;
+      for (std::size_t j = 0; j < cache.binding_count(i); j++)
+      {
+        const MeshCacheBinding binding = cache.binding(i, j);
+        textures.push_back(LoadTexture(std::string(binding.path), std::string(binding.type)));
+      }
+      Mesh& mesh = meshes_.emplace_back(cache.vertices(i), cache.indices(i), std::move(textures),
+                                        cache.aabb_min(i), cache.aabb_max(i), cache.bounding_sphere(i),
+                                        vertex_format_, keep_cpu_data_);
+      for (std::size_t lod = 1; lod <= cache.lod_count(i); lod++)
+        mesh.AddLod(cache.lod_indices(i, lod), cache.lod_error(i, lod));
+      const auto meshlets = cache.meshlets(i);
+      mesh.set_meshlets({meshlets.begin(), meshlets.end()});
+    }
+    UpdateBounds();
+    return true;
+  }
+
+  // Bornes du modèle recalculées depuis celles, déjà connues, de ses meshes : la
+  // sphère est centrée sur la boîte et contient la sphère de chaque mesh
+  void UpdateBounds()
+  {
+    aabb_min_ = glm::vec3(FLT_MAX);
+    aabb_max_ = glm::vec3(-FLT_MAX);
+    for (const Mesh& mesh : meshes_)
+    {
+      aabb_min_ = glm::min(aabb_min_, mesh.aabb_min_);
+      aabb_max_ = glm::max(aabb_max_, mesh.aabb_max_);
+    }
+    bounding_sphere_ = {(aabb_min_ + aabb_max_) * 0.5f, 0.0f};
+    for (const Mesh& mesh : meshes_)
+      bounding_sphere_.radius = std::max(bounding_sphere_.radius,
+                                         glm::length(mesh.bounding_sphere().center - bounding_sphere_.center) +
+                                             mesh.bounding_sphere().radius);
+  }
+
+  // Import côté CPU uniquement (cache ou Assimp), utilisable depuis n'importe quel thread
+  static std::vector<MeshData> ImportMeshes(const std::string& path)
+  {
+    const std::string cache_path = path + std::string(kMeshCacheExtension);
+    const std::uint64_t cache_key = ComputeMeshCacheKey(path, kImportFlags);
+
+    std::vector<MeshData> meshes;
+    MeshCacheFile cache;
+    if (cache.Open(cache_path, cache_key, kImportFlags))
+    {
+      meshes.resize(cache.mesh_count());
+      for (std::size_t i = 0; i < cache.mesh_count(); i++)
+      {
+        const auto vertices = cache.vertices(i);
+        const auto indices = cache.indices(i);
+        meshes[i].vertices.assign(vertices.begin(), vertices.end());
+        meshes[i].indices.assign(indices.begin(), indices.end());
+        meshes[i].aabb_min = cache.aabb_min(i);
+        meshes[i].aabb_max = cache.aabb_max(i);
+        meshes[i].bounding_sphere = cache.bounding_sphere(i);
+        for (std::size_t lod = 1; lod <= cache.lod_count(i); lod++)
+        {
+          const auto lod_indices = cache.lod_indices(i, lod);
+          meshes[i].lods.push_back({{lod_indices.begin(), lod_indices.end()}, cache.lod_error(i, lod)});
+        }
+        const auto meshlets = cache.meshlets(i);
+        meshes[i].meshlets.assign(meshlets.begin(), meshlets.end());
+        for (std::size_t j = 0; j < cache.binding_count(i); j++)
+        {
+          const MeshCacheBinding binding = cache.binding(i, j);
+          meshes[i].textures.push_back({0, std::string(binding.type), std::string(binding.path)});
+        }
+      }
+      return meshes;
+    }
+
+    if (ImportWithAssimp(path, meshes))
+      WriteMeshCache(cache_path, cache_key, kImportFlags, meshes);
+    return meshes;
+  }
+
+  // optimize applique OptimizeMesh à chaque mesh importé puis génère ses niveaux de
+  // détail et ses meshlets (le cache contient la version optimisée)
+  static bool ImportWithAssimp(const std::string& path, std::vector<MeshData>& meshes, bool optimize = true)
+  {
     Assimp::Importer import;
+    // Le .gltf et ses buffers .bin sont lus depuis des fichiers mappés en mémoire
+    import.SetIOHandler(new gpr5300::MappedIOSystem());
 
-    const aiScene* scene = import.ReadFile(path,
-                                           aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    const aiScene* scene = import.ReadFile(path, kImportFlags);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
       std::cerr << "ERROR::ASSIMP::" << import.GetErrorString() << "\n";
-      return;
+      return false;
     }
-    directory_ = path.substr(0, path.find_last_of('/'));
-    ProcessNode(scene->mRootNode, scene);
+    ProcessNode(scene->mRootNode, scene, meshes);
+    if (optimize)
+    {
+      for (MeshData& mesh : meshes)
+        OptimizeMesh(mesh.vertices, mesh.indices);
+      // Chaque mesh tient ensuite dans des indices 16 bits
+      SplitForShortIndices(meshes);
+      // Les simplifications sont indépendantes d'un mesh à l'autre
+      gpr5300::ThreadPool::Default().ParallelFor(meshes.size(), [&](const std::size_t i) {
+        GenerateLods(meshes[i]);
+        meshes[i].meshlets = BuildMeshlets(meshes[i].vertices, meshes[i].indices);
+      });
+    }
+    return true;
   }
 
   // Traitement récursif des noeuds de la scène
-  void ProcessNode(aiNode* node, const aiScene* scene)
+  static void ProcessNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes)
   {
     // Traiter tous les meshes du noeud
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
       aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-      meshes_.push_back(ProcessMesh(mesh, scene));
+      meshes.push_back(ProcessMesh(mesh, scene));
     }
     // Puis traiter ses enfants
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-      ProcessNode(node->mChildren[i], scene);
+      ProcessNode(node->mChildren[i], scene, meshes);
     }
   }
 
-  // Traitement d'un mesh individuel
-  Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene)
+  // Traitement d'un mesh individuel (CPU uniquement, les textures ne sont pas encore chargées)
+  static MeshData ProcessMesh(aiMesh* mesh, const aiScene* scene)
   {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    MeshData data;
+    std::vector<Vertex>& vertices = data.vertices;
+    std::vector<unsigned int>& indices = data.indices;
+    std::vector<Texture>& textures = data.textures;
 
     // Traitement des sommets
+    vertices.reserve(mesh->mNumVertices);
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
       Vertex vertex{};
@@ -114,6 +508,8 @@ class Model
       vector.y = mesh->mVertices[i].y;
       vector.z = mesh->mVertices[i].z;
       vertex.Position = vector;
+      data.aabb_min = glm::min(data.aabb_min, vector);
+      data.aabb_max = glm::max(data.aabb_max, vector);
 
       // Normales
       vector.x = mesh->mNormals[i].x;
@@ -151,6 +547,7 @@ class Model
     }
 
     // Traitement des indices
+    indices.reserve(static_cast<std::size_t>(mesh->mNumFaces) * 3);
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
       aiFace face = mesh->mFaces[i];
@@ -158,134 +555,143 @@ class Model
         indices.push_back(face.mIndices[j]);
     }
 
-    // Traitement du matériau et chargement des textures
+    // Traitement du matériau : seules les références aux textures sont relevées ici
     if (mesh->mMaterialIndex >= 0)
     {
       aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-      std::vector<Texture> diffuseMaps = LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-      textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-      std::vector<Texture> specularMaps = LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-      textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+      CollectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
+      CollectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
 
       // Optionnel : si vous souhaitez charger une texture de normale (différente des tangentes calculées)
-      // std::vector<Texture> normalMaps = LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-      // textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+      // CollectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
     }
 
-    return Mesh(vertices, indices, textures);
+    data.bounding_sphere = ComputeBoundingSphere(vertices, data.aabb_min, data.aabb_max);
+    return data;
   }
 
-  // Chargement des textures associées à un matériau
-  std::vector<Texture> LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+  // Références des textures associées à un matériau
+  static void CollectMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName,
+                                      std::vector<Texture>& textures)
   {
-    std::vector<Texture> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
       aiString str;
       mat->GetTexture(type, i, &str);
-      bool skip = false;
-      for (unsigned int j = 0; j < textures_loaded.size(); j++)
-      {
-        if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-        {
-          textures.push_back(textures_loaded[j]);
-          skip = true;
-          break;
-        }
-      }
-      if (!skip)
-      {   // Si la texture n'a pas été chargée, on la charge
-        Texture texture;
-        texture.id = TextureFromFile(str.C_Str(), this->directory_);
-        texture.type = typeName;
-        texture.path = str.C_Str();
-        textures.push_back(texture);
-        textures_loaded.push_back(texture);
-      }
+      textures.push_back({0, typeName, str.C_Str()});
     }
-    return textures;
   }
-};
-
-// Définition de la fonction utilitaire pour charger une texture depuis un fichier
-unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
-{
-  std::string filename = std::string(path);
-  filename = directory + '/' + filename;
 
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
+  // Remplace les références de textures par les textures chargées
+  void ResolveTextures(std::vector<Texture>& textures)
+  {
+    for (Texture& texture : textures)
+      texture = LoadTexture(texture.path, texture.type);
+  }
 
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-  if (data)
+  // Retourne la texture déjà chargée pour ce chemin, ou la charge
+  Texture LoadTexture(const std::string& path, const std::string& typeName)
   {
-    GLenum internal_format;
-    GLenum data_format;
-    if (nrComponents == 1)
-    {
-      internal_format = data_format = GL_RED;
-    }
-    else if (nrComponents == 3)
+    const auto loaded = texture_indices_.find(path);
+    if (loaded != texture_indices_.end())
+      return textures_loaded[loaded->second];
+
+    // Si la texture n'a pas été chargée, on reprend celle préchargée en parallèle,
+    // ou on passe par le registre (qui la partage avec les autres modèles)
+    TextureHandle handle;
+    const auto preloaded = preloaded_textures_.find(path);
+    if (preloaded != preloaded_textures_.end())
     {
-      internal_format = gamma ? GL_SRGB : GL_RGB;
-      data_format = GL_RGB;
+      handle = std::move(preloaded->second);
+      preloaded_textures_.erase(preloaded);
     }
-    else if (nrComponents == 4)
+    else
     {
-      internal_format = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-      data_format = GL_RGBA;
+      handle = TextureRegistry::Default().Load(directory_ + '/' + path);
+      if (!handle)
+        std::cout << "Texture failed to load at path: " << path << std::endl;
     }
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, data_format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, data_format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, data_format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
+    Texture texture;
+    texture.id = handle.id();
+    texture.type = typeName;
+    texture.path = path;
+    AddLoadedTexture(texture, std::move(handle));
+    return texture;
   }
-  else
+
+  void AddLoadedTexture(const Texture& texture, TextureHandle handle)
   {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
+    texture_indices_[texture.path] = textures_loaded.size();
+    textures_loaded.push_back(texture);
+    texture_handles_.push_back(std::move(handle));
   }
 
-  return textureID;
-}
-
-// Génération d'un cubemap à partir d'un ensemble de chemins vers les images
-unsigned int GenerateCubemap(std::span<const std::string_view> faces_paths)
-{
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+  // Côté thread de chargement : chemin canonique et empreinte du fichier, puis
+  // décodage seulement si le registre ne connaît pas encore l'image.
+  static DecodedTexture DecodeTexture(const std::string& directory, const Texture& texture)
+  {
+    DecodedTexture decoded;
+    decoded.texture = texture;
+    const std::string file = directory + '/' + texture.path;
+    decoded.canonical_path = TextureRegistry::CanonicalPath(file);
+    decoded.content_hash = gpr5300::HashFile(file);
+    if (!TextureRegistry::Default().Contains(decoded.canonical_path, decoded.content_hash, false))
+      decoded.pixels = DecodeTexturePixels(file);
+    return decoded;
+  }
 
-  int width, height, nrChannels;
-  for (unsigned int i = 0; i < faces_paths.size(); i++)
+  // Côté thread GL : texture du registre, ou nouvelle texture envoyée au GPU
+  // (en flux par TextureUploader si stream, sinon immédiatement).
+  TextureHandle RegisterTexture(DecodedTexture& decoded, bool stream)
   {
-    unsigned char *data = stbi_load(faces_paths[i].data(), &width, &height, &nrChannels, 0);
-    if (data)
+    TextureRegistry& registry = TextureRegistry::Default();
+    TextureHandle handle = registry.Find(decoded.canonical_path, decoded.content_hash, false);
+    if (!handle && decoded.pixels.valid())
     {
-      glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-      stbi_image_free(data);
+      const unsigned int id = stream ? TextureUploader::Default().Enqueue(std::move(decoded.pixels))
+                                     : UploadTexturePixels(decoded.pixels);
+      handle = registry.Insert(decoded.canonical_path, decoded.content_hash, false, id);
     }
-    else
+    else if (!handle)
     {
-      std::cout << "Cubemap texture failed to load at path: " << faces_paths[i] << std::endl;
-      stbi_image_free(data);
+      // Illisible, ou libérée par ses autres utilisateurs depuis le décodage
+      handle = registry.Load(directory_ + '/' + decoded.texture.path);
     }
+    if (!handle)
+      std::cout << "Texture failed to load at path: " << decoded.texture.path << std::endl;
+    return handle;
+  }
+
+  // Liste des textures référencées par les meshes importés
+  static std::vector<std::string> CollectTexturePaths(const std::vector<MeshData>& meshes)
+  {
+    std::vector<std::string> paths;
+    for (const MeshData& mesh : meshes)
+      for (const Texture& texture : mesh.textures)
+        paths.push_back(texture.path);
+    return paths;
   }
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-  return textureID;
-}
+
+  // Phase CPU : décodage parallèle des images absentes du registre, puis phase GL : upload seul.
+  // Les textures obtenues sont consommées par LoadTexture.
+  void PreloadTextures(const std::vector<std::string>& paths)
+  {
+    std::vector<Texture> textures;
+    std::unordered_set<std::string> seen;
+    for (const std::string& path : paths)
+    {
+      if (!seen.insert(path).second || preloaded_textures_.contains(path) || texture_indices_.contains(path))
+        continue;
+      textures.push_back({0, "", path});
+    }
+
+    std::vector<DecodedTexture> decoded(textures.size());
+    gpr5300::ThreadPool::Default().ParallelFor(textures.size(), [&](const std::size_t i) {
+      decoded[i] = DecodeTexture(directory_, textures[i]);
+    });
+    for (DecodedTexture& texture : decoded)
+      preloaded_textures_[texture.texture.path] = RegisterTexture(texture, false);
+  }
+};
 
 #endif // MODEL_H
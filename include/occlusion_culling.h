@@ -0,0 +1,156 @@
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "bounds.h"
+
+class Mesh;
+
+namespace gpr5300
+{
+class ThreadPool;
+}
+
+// Occlusion culling on the CPU, against a small depth buffer of the big
+// occluders, so that hidden meshes and instances never reach GL.
+//
+// Occluders (walls, floors, large props) are registered once: their positions
+// and indices are copied, so they outlive Mesh::ReleaseCpuData. Each frame,
+// Begin takes the camera, Add places occluders, and Rasterize transforms and
+// sets up their triangles, one ParallelFor index per placed occluder, then
+// fills the depth buffer in bands of kBandHeight rows, one index per band,
+// 8 (AVX2) or 4 (SSE2) pixels per step. Each band ends by keeping the
+// farthest depth of its kTileSize x kTileSize tiles.
+//
+// IsBoxVisible projects a world-space box to a screen rectangle and its
+// nearest depth. A tile whose farthest depth is nearer hides its part of the
+// rectangle without reading its pixels; the other tiles are read pixel by
+// pixel. Boxes crossing the near plane are visible, occluder triangles
+// crossing it are dropped and occluder depths are biased farther than float
+// rounding can move them, so mistakes go toward drawing too much, with one
+// exception: a pixel is covered when the triangle covers its center, so an
+// object showing less than a pixel of this buffer past an occluder's edge can
+// be culled.
+//
+// Depths are window depths of glDepthRange(0, 1): 0 on the near plane, 1 on
+// the far plane and where no occluder was drawn. Row 0 is the bottom of the
+// screen, as in GL. No GL calls, so it runs headless. Is*Visible may run on
+// several threads at once, between two Rasterize calls.
+class OcclusionCuller
+{
+ public:
+  static constexpr int kWidth = 256;
+  static constexpr int kHeight = 128;
+  static constexpr int kTileSize = 8;
+  static constexpr int kTilesX = kWidth / kTileSize;
+  static constexpr int kTilesY = kHeight / kTileSize;
+  // Rows filled by one ParallelFor index, whole tiles
+  static constexpr int kBandHeight = 16;
+  static constexpr std::uint32_t kNoOccluder = 0xFFFFFFFFu;
+
+  // Screen-space triangle: edge functions and depth plane, each a * x + (b * y + c)
+  // at the pixel center (x, y), inside where all three edges are >= 0
+  struct Triangle
+  {
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float depth_a;
+    float depth_b;
+    float depth_c;
+    int min_x; // Pixel bounds, clamped to the buffer; min_x > max_x when nothing is drawn
+    int min_y;
+    int max_x;
+    int max_y;
+  };
+
+  OcclusionCuller();
+
+  // Copies occluder geometry: positions in its local space and a triangle list.
+  // Returns its id for Add.
+  std::uint32_t AddOccluder(std::span<const glm::vec3> positions, std::span<const unsigned int> indices);
+  // Same from the CPU copy of mesh, kNoOccluder once it is released
+  std::uint32_t AddOccluder(const Mesh& mesh);
+  void ClearOccluders();
+
+  // Starts a frame seen through view_projection (projection * view)
+  void Begin(const glm::mat4& view_projection);
+  // Draws occluder under transform in this frame. Frames that place each
+  // occluder at most once never allocate.
+  void Add(std::uint32_t occluder, const glm::mat4& transform);
+  // Rasterizes what was added since Begin. Without pool, everything runs on the caller.
+  void Rasterize(gpr5300::ThreadPool* pool = nullptr);
+
+  // World-space box [min, max] against the last Rasterize
+  [[nodiscard]] bool IsBoxVisible(const glm::vec3& min, const glm::vec3& max) const;
+  [[nodiscard]] bool IsSphereVisible(const BoundingSphere& sphere) const;
+  // Pixels [min_x, max_x] x [min_y, max_y] of an object whose nearest depth is depth
+  [[nodiscard]] bool IsRectVisible(int min_x, int min_y, int max_x, int max_y, float depth) const;
+
+  // Triangle through three clip-space vertices, as Rasterize draws it; false
+  // if it crosses the near plane or covers no pixel center
+  [[nodiscard]] static bool SetupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2,
+                                          Triangle& triangle);
+
+  // kWidth * kHeight depths, row by row from the bottom
+  [[nodiscard]] std::span<const float> depth() const { return depth_; }
+  // Farthest depth of each tile, kTilesX * kTilesY, row by row
+  [[nodiscard]] std::span<const float> tile_max_depth() const { return tile_max_depth_; }
+  [[nodiscard]] const glm::mat4& view_projection() const { return view_projection_; }
+  [[nodiscard]] std::size_t occluder_count() const { return occluders_.size(); }
+  [[nodiscard]] std::size_t instance_count() const { return instances_.size(); }
+  // Triangles of the placed occluders, and those left after near plane and screen clipping
+  [[nodiscard]] std::size_t triangle_count() const { return triangle_count_; }
+  [[nodiscard]] std::size_t drawn_triangle_count() const { return drawn_triangle_count_; }
+
+ private:
+  struct Occluder
+  {
+    std::uint32_t first_position;
+    std::uint32_t position_count;
+    std::uint32_t first_index;
+    std::uint32_t index_count;
+  };
+
+  struct Instance
+  {
+    glm::mat4 clip_from_local;
+    std::uint32_t occluder;
+    std::uint32_t first_vertex;   // In clip_vertices_
+    std::uint32_t first_triangle; // In triangles_
+    std::uint32_t drawn_triangles;
+  };
+
+  // Window position (x, y in pixels, z depth) of a clip-space point in front of the near plane
+  [[nodiscard]] static glm::vec3 ToWindow(const glm::vec4& clip);
+  void SetupInstance(Instance& instance);
+  void RasterizeBand(int band);
+
+  std::vector<glm::vec3> positions_;
+  std::vector<unsigned int> indices_; // Relative to the occluder's first position
+  std::vector<Occluder> occluders_;
+
+  glm::mat4 view_projection_{1.0f};
+  std::vector<Instance> instances_;
+  std::vector<glm::vec4> clip_vertices_;
+  std::vector<Triangle> triangles_;
+  std::size_t vertex_count_ = 0;
+  std::size_t triangle_count_ = 0;
+  std::size_t drawn_triangle_count_ = 0;
+
+  std::array<float, kWidth * kHeight> depth_;
+  std::array<float, kTilesX * kTilesY> tile_max_depth_;
+};
+
+// Instruction set of the rasterizer: "AVX2", "SSE2" or "scalar"
+[[nodiscard]] const char* OcclusionCullingIsa();
+
+#endif // OCCLUSION_CULLING_H
@@ -15,6 +15,9 @@ namespace gpr5300
         virtual void DrawImGui() {}
         virtual void OnEvent(const SDL_Event& event) {}
         virtual void UpdateCamera(const float dt) {}
+        // True once the scene is done loading: from then on its frames must
+        // not allocate from the general heap (checked by Engine::Run)
+        [[nodiscard]] virtual bool IsSteadyState() const { return false; }
 
     };
 
@@ -1,59 +1,74 @@
 ﻿#ifndef SHADER_H_
 #define SHADER_H_
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 
 #include "file_utility.h"
+#include "frame_uniforms.h"
+#include "shader_cache.h"
+#include "shader_include.h"
+#include "uniform_table.h"
+
+// Typed handle to a uniform location, held by callers so that per-frame
+// updates skip every name lookup. T only selects the matching Shader::Set.
+template <typename T>
+class Uniform
+{
+ public:
+  Uniform() = default;
+  explicit Uniform(const int location) : location_(location) {}
+
+  [[nodiscard]] int location() const { return location_; }
+  [[nodiscard]] bool valid() const { return location_ >= 0; }
+
+ private:
+  int location_ = -1;
+};
 
 class Shader
 {
  public:
   unsigned int id_;
   Shader() = default;
-  //Constructor from paths
+  //Constructor from paths, restored from ProgramCache when the sources and driver are unchanged
   Shader(const char* vertex_path, const char* fragment_path)
   {
-    GLint success;
     //Load shaders
-    const auto vertex_content = gpr5300::LoadFile(vertex_path);
-    const auto* v_shader_code = vertex_content.data();
-    const unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &v_shader_code, nullptr);
-    glCompileShader(vertex_shader);
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    const gpr5300::MappedFile vertex_file(vertex_path);
+    if (!vertex_file.is_open())
     {
-      std::cerr << "Error while loading vertex shader\n";
+      std::cerr << "Cannot open vertex shader " << vertex_path << "\n";
     }
-
-    const auto fragment_content = gpr5300::LoadFile(fragment_path);
-    const auto* f_shader_code = fragment_content.data();
-    const unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &f_shader_code, nullptr);
-    glCompileShader(fragment_shader);
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    const gpr5300::MappedFile fragment_file(fragment_path);
+    if (!fragment_file.is_open())
     {
-      std::cerr << "Error while loading fragment shader\n";
+      std::cerr << "Cannot open fragment shader " << fragment_path << "\n";
     }
 
-    //Load program
-    id_ = glCreateProgram();
-    glAttachShader(id_, vertex_shader);
-    glAttachShader(id_, fragment_shader);
-    glLinkProgram(id_);
-    //Check if shader program was linked correctly
-    glGetProgramiv(id_, GL_LINK_STATUS, &success);
-    if (!success)
+    // Sources with #include are expanded into these, the others are used straight from the mapping
+    std::string vertex_expanded;
+    std::string fragment_expanded;
+    const std::string_view vertex_source = ExpandShaderIncludes(vertex_path, vertex_file.text(), vertex_expanded);
+    const std::string_view fragment_source =
+        ExpandShaderIncludes(fragment_path, fragment_file.text(), fragment_expanded);
+
+    ProgramCache& cache = ProgramCache::Default();
+    const std::uint64_t cache_key = cache.Key(vertex_source, fragment_source);
+    id_ = cache.Load(cache_key);
+    if (id_ == 0)
     {
-      std::cerr << "Error while linking shader program\n";
+      id_ = Compile(vertex_source, fragment_source, cache_key);
     }
-
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    uniforms_.Build(id_);
+    BindFrameUniformBlocks(id_);
   }
 
   void Use() const
@@ -66,62 +81,135 @@ class Shader
     glDeleteProgram(id_);
   }
 
-  //Uniform functions
-  void SetBool(const std::string &name, const bool value) const
+  // Handle to a uniform, resolved once through the program's uniform table.
+  // Invalid (and ignored by Set) when the program has no such active uniform.
+  template <typename T>
+  [[nodiscard]] Uniform<T> GetUniform(const std::string_view name) const
   {
-    glUniform1i(glGetUniformLocation(id_, name.c_str()), static_cast<int>(value));
+    return Uniform<T>(uniforms_.Find(name));
   }
-  void SetInt(const std::string &name, const int value) const
+  [[nodiscard]] const UniformTable& uniforms() const { return uniforms_; }
+
+  //Uniform functions, the program must be in use
+  void Set(const Uniform<bool> uniform, const bool value) const { glUniform1i(uniform.location(), value); }
+  void Set(const Uniform<int> uniform, const int value) const { glUniform1i(uniform.location(), value); }
+  void Set(const Uniform<float> uniform, const float value) const { glUniform1f(uniform.location(), value); }
+  void Set(const Uniform<glm::vec2> uniform, const glm::vec2& value) const
   {
-    glUniform1i(glGetUniformLocation(id_, name.c_str()), value);
+    glUniform2fv(uniform.location(), 1, glm::value_ptr(value));
   }
-  void SetFloat(const std::string &name, const float value) const
+  void Set(const Uniform<glm::vec3> uniform, const glm::vec3& value) const
   {
-    glUniform1f(glGetUniformLocation(id_, name.c_str()), value);
+    glUniform3fv(uniform.location(), 1, glm::value_ptr(value));
   }
-  void SetVec2(const std::string &name, const glm::vec2 &value) const
+  void Set(const Uniform<glm::vec4> uniform, const glm::vec4& value) const
   {
-    glUniform2fv(glGetUniformLocation(id_, name.c_str()), 1, &value[0]);
+    glUniform4fv(uniform.location(), 1, glm::value_ptr(value));
   }
-  void SetVec2(const std::string &name, const float x, const float y) const
+  void Set(const Uniform<glm::mat2> uniform, const glm::mat2& value) const
   {
-    glUniform2f(glGetUniformLocation(id_, name.c_str()), x, y);
+    glUniformMatrix2fv(uniform.location(), 1, GL_FALSE, glm::value_ptr(value));
   }
-  void SetVec3(const std::string &name, const glm::vec3 &value) const
+  void Set(const Uniform<glm::mat3> uniform, const glm::mat3& value) const
   {
-    glUniform3fv(glGetUniformLocation(id_, name.c_str()), 1, &value[0]);
+    glUniformMatrix3fv(uniform.location(), 1, GL_FALSE, glm::value_ptr(value));
   }
-  void SetVec3(const std::string &name, const float x, const float y, const float z) const
+  void Set(const Uniform<glm::mat4> uniform, const glm::mat4& value) const
   {
-    glUniform3f(glGetUniformLocation(id_, name.c_str()), x, y, z);
+    glUniformMatrix4fv(uniform.location(), 1, GL_FALSE, glm::value_ptr(value));
   }
-  void SetVec4(const std::string &name, const glm::vec4 &value) const
+  // Whole array in one call, starting at the element the handle points to
+  void Set(const Uniform<glm::vec3> uniform, const std::span<const glm::vec3> values) const
   {
-    glUniform4fv(glGetUniformLocation(id_, name.c_str()), 1, &value[0]);
+    if (values.empty())
+    {
+      return;
+    }
+    glUniform3fv(uniform.location(), static_cast<GLsizei>(values.size()), glm::value_ptr(values.front()));
   }
-  void SetVec4(const std::string &name, const float x, const float y, const float z, const float w) const
+
+  //Uniform functions by name: a table lookup, no GL query
+  void SetBool(const std::string_view name, const bool value) const { Set(GetUniform<bool>(name), value); }
+  void SetInt(const std::string_view name, const int value) const { Set(GetUniform<int>(name), value); }
+  void SetFloat(const std::string_view name, const float value) const { Set(GetUniform<float>(name), value); }
+  void SetVec2(const std::string_view name, const glm::vec2& value) const { Set(GetUniform<glm::vec2>(name), value); }
+  void SetVec2(const std::string_view name, const float x, const float y) const
   {
-    glUniform4f(glGetUniformLocation(id_, name.c_str()), x, y, z, w);
+    glUniform2f(uniforms_.Find(name), x, y);
   }
-  void SetMat2(const std::string &name, const glm::mat2 &value) const
+  void SetVec3(const std::string_view name, const glm::vec3& value) const { Set(GetUniform<glm::vec3>(name), value); }
+  void SetVec3(const std::string_view name, const float x, const float y, const float z) const
   {
-    glUniformMatrix2fv(glGetUniformLocation(id_, name.c_str()), 1,GL_FALSE, value_ptr(value));
+    glUniform3f(uniforms_.Find(name), x, y, z);
   }
-  void SetMat3(const std::string &name, const glm::mat3 &value) const
+  void SetVec4(const std::string_view name, const glm::vec4& value) const { Set(GetUniform<glm::vec4>(name), value); }
+  void SetVec4(const std::string_view name, const float x, const float y, const float z, const float w) const
   {
-    glUniformMatrix3fv(glGetUniformLocation(id_, name.c_str()), 1, GL_FALSE, value_ptr(value));
+    glUniform4f(uniforms_.Find(name), x, y, z, w);
   }
-  void SetMat4(const std::string &name, const glm::mat4 &value) const
+  void SetMat2(const std::string_view name, const glm::mat2& value) const { Set(GetUniform<glm::mat2>(name), value); }
+  void SetMat3(const std::string_view name, const glm::mat3& value) const { Set(GetUniform<glm::mat3>(name), value); }
+  void SetMat4(const std::string_view name, const glm::mat4& value) const { Set(GetUniform<glm::mat4>(name), value); }
+  void SetVec3Array(const std::string_view name, const std::vector<glm::vec3>& values, const size_t count) const
   {
-    glUniformMatrix4fv(glGetUniformLocation(id_, name.c_str()), 1, GL_FALSE, value_ptr(value));
+    Set(GetUniform<glm::vec3>(name), std::span(values).first(count));
   }
-  void SetVec3Array(const std::string& name, const std::vector<glm::vec3>& values, size_t count) {
-    for (size_t i = 0; i < count; ++i) {
-      std::string indexedName = name + "[" + std::to_string(i) + "]";
-      glUniform3fv(glGetUniformLocation(id_, indexedName.c_str()), 1, glm::value_ptr(values[i]));
+
+ private:
+  unsigned int Compile(const std::string_view vertex_source, const std::string_view fragment_source,
+                       const std::uint64_t cache_key)
+  {
+    GLint success;
+    const auto compile_start = std::chrono::steady_clock::now();
+
+    const auto* v_shader_code = vertex_source.data();
+    const auto v_shader_length = static_cast<GLint>(vertex_source.size());
+    const unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader, 1, &v_shader_code, &v_shader_length);
+    glCompileShader(vertex_shader);
+    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+      std::cerr << "Error while loading vertex shader\n";
+    }
+
+    const auto* f_shader_code = fragment_source.data();
+    const auto f_shader_length = static_cast<GLint>(fragment_source.size());
+    const unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader, 1, &f_shader_code, &f_shader_length);
+    glCompileShader(fragment_shader);
+    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+      std::cerr << "Error while loading fragment shader\n";
+    }
+
+    //Load program
+    const unsigned int program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    //Check if shader program was linked correctly
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+      std::cerr << "Error while linking shader program\n";
+    }
+
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    if (success)
+    {
+      ProgramCache::Default().Store(
+          cache_key, program,
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compile_start).count());
     }
+    return program;
   }
 
+  UniformTable uniforms_;
 };
 
 #endif //SHADER_H_
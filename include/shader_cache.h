@@ -0,0 +1,48 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Persistent cache of linked GL programs (glGetProgramBinary / glProgramBinary).
+//
+// Entries are keyed by a hash of both shader sources and the GL vendor,
+// renderer and version strings, so editing a shader or updating the driver
+// simply misses. A binary the driver rejects is deleted and the program is
+// rebuilt from source. GL thread only.
+class ProgramCache
+{
+ public:
+  static ProgramCache& Default();
+
+  [[nodiscard]] std::uint64_t Key(std::string_view vertex_source, std::string_view fragment_source) const;
+  // Linked program restored from the cache, or 0 on a miss.
+  unsigned int Load(std::uint64_t key);
+  // Saves a freshly linked program. It must have been linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+  void Store(std::uint64_t key, unsigned int program, double compile_milliseconds);
+
+  void set_directory(std::string directory) { directory_ = std::move(directory); }
+  [[nodiscard]] const std::string& directory() const { return directory_; }
+  [[nodiscard]] bool enabled() const;
+
+  [[nodiscard]] std::size_t hits() const { return hits_; }
+  [[nodiscard]] std::size_t misses() const { return misses_; }
+  [[nodiscard]] std::size_t rejected() const { return rejected_; }
+  // Compile and link time of the cached programs minus the time spent restoring them
+  [[nodiscard]] double saved_milliseconds() const { return saved_milliseconds_; }
+
+ private:
+  [[nodiscard]] std::string EntryPath(std::uint64_t key) const;
+
+  std::string directory_ = "shader_cache";
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+  std::size_t rejected_ = 0;
+  double saved_milliseconds_ = 0.0;
+};
+
+#endif // SHADER_CACHE_H
@@ -0,0 +1,20 @@
+#ifndef SHADER_INCLUDE_H
+#define SHADER_INCLUDE_H
+
+#include <string>
+#include <string_view>
+
+// GLSL has no #include in core profile, so shaders sharing declarations (see
+// data/shaders/common/) are expanded on load. A shader writes
+//
+//   #extension GL_GOOGLE_include_directive : require
+//   #include "../common/uniforms.glsl"
+//
+// The extension line keeps glslangValidator happy at build time and is
+// dropped here; the include path is relative to the including file.
+//
+// Returns source itself when it has no #include, otherwise the expanded text
+// held in storage. Missing files are reported and left out.
+std::string_view ExpandShaderIncludes(const std::string& path, std::string_view source, std::string& storage);
+
+#endif // SHADER_INCLUDE_H
@@ -0,0 +1,101 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <GL/glew.h>
+
+// Ring allocator for data rewritten every frame (instance transforms, uniform
+// blocks, indirect commands).
+//
+// One buffer is created with immutable storage and mapped once, persistent
+// and coherent, then split into kRingSize frame segments. Allocate bumps an
+// offset in the current segment and returns a pointer into the mapping:
+// writing there is the upload, with no glBufferSubData copy in the driver.
+// EndFrame fences the segment; BeginFrame, kRingSize - 1 frames later, waits
+// on that fence before the segment is written again, which only blocks if the
+// GPU is that many frames behind.
+//
+// Engine::Run calls BeginFrame and EndFrame around every frame. Allocations
+// stay valid until the end of the frame. Every call must happen on the thread
+// owning the GL context.
+class StreamBuffer
+{
+ public:
+  static constexpr std::size_t kRingSize = 3;
+  static constexpr std::size_t kDefaultFrameCapacity = 4u << 20;
+
+  // A range of the current frame's segment
+  template <typename T>
+  struct Slice
+  {
+    std::span<T> data;      // Mapped memory, write only
+    std::size_t offset = 0; // In bytes, from the start of buffer()
+
+    [[nodiscard]] explicit operator bool() const { return data.data() != nullptr; }
+    [[nodiscard]] std::size_t size_bytes() const { return data.size_bytes(); }
+  };
+
+  explicit StreamBuffer(std::size_t frame_capacity = kDefaultFrameCapacity);
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer&) = delete;
+  StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+  // Shared ring, created on first use (the GL context must exist by then) and
+  // never destroyed, like GeometryArena::Default().
+  static StreamBuffer& Default();
+
+  void BeginFrame();
+  void EndFrame();
+
+  // count elements aligned to alignment bytes (at least alignof(T)). An empty
+  // slice, and an error, if the frame segment is full.
+  template <typename T>
+  [[nodiscard]] Slice<T> Allocate(const std::size_t count, const std::size_t alignment = alignof(T))
+  {
+    std::byte* data = AllocateBytes(count * sizeof(T), alignment < alignof(T) ? alignof(T) : alignment);
+    if (data == nullptr)
+    {
+      return {};
+    }
+    return {{reinterpret_cast<T*>(data), count}, static_cast<std::size_t>(data - mapped_)};
+  }
+  // Copies block into a slice aligned for glBindBufferRange(GL_UNIFORM_BUFFER)
+  template <typename T>
+  [[nodiscard]] Slice<T> PushUniform(const T& block)
+  {
+    Slice<T> slice = Allocate<T>(1, uniform_alignment_);
+    if (slice)
+    {
+      slice.data[0] = block;
+    }
+    return slice;
+  }
+
+  [[nodiscard]] unsigned int buffer() const { return buffer_; }
+  [[nodiscard]] std::size_t uniform_alignment() const { return uniform_alignment_; }
+  [[nodiscard]] std::size_t storage_alignment() const { return storage_alignment_; }
+  [[nodiscard]] std::size_t frame_capacity() const { return frame_capacity_; }
+  // Bytes handed out during the last complete frame
+  [[nodiscard]] std::size_t last_frame_bytes() const { return last_frame_bytes_; }
+  // Frames for which BeginFrame had to wait for the GPU
+  [[nodiscard]] std::size_t stall_count() const { return stall_count_; }
+
+ private:
+  [[nodiscard]] std::byte* AllocateBytes(std::size_t size, std::size_t alignment);
+
+  GLuint buffer_ = 0;
+  std::byte* mapped_ = nullptr;
+  std::size_t frame_capacity_ = 0;
+  std::size_t uniform_alignment_ = 256;
+  std::size_t storage_alignment_ = 256;
+  std::array<GLsync, kRingSize> fences_ = {};
+  std::size_t current_ = 0;
+  std::size_t offset_ = 0; // In the current segment
+  std::size_t last_frame_bytes_ = 0;
+  std::size_t stall_count_ = 0;
+  bool overflow_reported_ = false;
+};
+
+#endif // STREAM_BUFFER_H
@@ -0,0 +1,82 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Image;
+
+// Block-compressed (BCn) textures baked offline next to their source image.
+//
+// The baker (main/texture_baker.cc) encodes every image into BC1, BC3, BC5 or
+// BC7 with its full mip chain and writes it as "<source>.dds" (DX10 header).
+// At run time the loaders (DecodeTexturePixels in texture_loader.h) call
+// LoadBakedTexture() first and upload the compressed levels as they are,
+// falling back to stb_image decoding when no up-to-date baked file exists.
+//
+// Normal maps are stored as BC5 (X and Y only): shaders sampling them must
+// rebuild Z as sqrt(1 - x^2 - y^2).
+
+inline constexpr std::string_view kBakedTextureExtension = ".dds";
+
+enum class BlockFormat : std::uint32_t
+{
+  kBC1, // RGB, 8 bytes per block
+  kBC3, // RGBA (BC1 colour + BC4 alpha), 16 bytes per block
+  kBC5, // RG, two BC4 channels, 16 bytes per block
+  kBC7, // RGBA, mode 6 only, 16 bytes per block
+};
+
+struct CompressedImage
+{
+  struct Level
+  {
+    std::size_t offset = 0;
+    std::size_t size = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  BlockFormat format = BlockFormat::kBC1;
+  bool has_alpha = false;
+  // Colour stored as sRGB: read from the *_UNORM_SRGB DXGI formats, and written
+  // back as them. Uploads use the sRGB internal format when either this or the
+  // caller's gamma flag is set.
+  bool srgb = false;
+  std::vector<Level> levels;
+  std::vector<std::byte> data; // Every level, largest first, blocks in row order
+
+  [[nodiscard]] bool valid() const { return !levels.empty(); }
+  [[nodiscard]] int width() const { return levels.empty() ? 0 : levels.front().width; }
+  [[nodiscard]] int height() const { return levels.empty() ? 0 : levels.front().height; }
+};
+
+[[nodiscard]] std::size_t BlockBytes(BlockFormat format);
+[[nodiscard]] std::string_view BlockFormatName(BlockFormat format);
+// glCompressedTex* internal format. gamma selects the sRGB variant where one exists.
+[[nodiscard]] unsigned int CompressedInternalFormat(BlockFormat format, bool gamma);
+
+// Picks the format the baker uses for an image: BC5 for "*_normal" files, BC3
+// (or BC7 when high_quality) when any texel is translucent, BC1 (or BC7) otherwise.
+[[nodiscard]] BlockFormat ChooseBlockFormat(std::string_view path, const Image& image, bool high_quality);
+// Encodes the image and a box-filtered mip chain down to 1x1. CPU only.
+[[nodiscard]] CompressedImage CompressImage(const Image& image, BlockFormat format);
+
+bool WriteDds(const std::string& path, const CompressedImage& image);
+[[nodiscard]] CompressedImage ReadDds(const std::string& path);
+
+[[nodiscard]] std::string BakedTexturePath(const std::string& source_path);
+// The baked version of source_path, or an invalid image if there is none or it
+// is older than the source.
+[[nodiscard]] CompressedImage LoadBakedTexture(const std::string& source_path);
+
+// Immutable storage for every level, with the loaders' sampler state. gamma
+// (or image.srgb) selects the sRGB internal format. GL thread only.
+unsigned int AllocateCompressedTexture(const CompressedImage& image, bool gamma = false);
+// Allocates and uploads every level. Returns 0 if the image is invalid.
+unsigned int UploadCompressedTexture(const CompressedImage& image, bool gamma = false);
+
+#endif // TEXTURE_COMPRESSION_H
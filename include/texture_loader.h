@@ -1,16 +1,120 @@
 #ifndef SAMPLES_OPENGL_TEXTURE_LOADER_H
 #define SAMPLES_OPENGL_TEXTURE_LOADER_H
 
+#include <cstdint>
+#include <future>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
+#include "texture_compression.h"
+#include "texture_registry.h"
+
+namespace gpr5300
+{
+class ThreadPool;
+}
+
+// Decoded image in CPU memory. Owns its pixels (allocated by stb_image).
 struct Image
 {
   void* pixel = nullptr;
   int width = 0;
   int height = 0;
   int comp = 0; //stat that depends on the format -> .jpeg has 3 I think and stuff....
+
+  Image() = default;
+  ~Image();
+  Image(Image&& other) noexcept;
+  Image& operator=(Image&& other) noexcept;
+  Image(const Image&) = delete;
+  Image& operator=(const Image&) = delete;
+
+  [[nodiscard]] bool valid() const { return pixel != nullptr; }
+};
+
+// Texture loading is split in two phases so that scenes can decode on worker
+// threads and keep the GL thread for uploads only:
+//  - DecodeImage / DecodeImages: CPU only, safe on any thread.
+//  - UploadTexture: GL only, must run on the thread owning the context.
+
+// desired_channels = 0 keeps the file's channel count.
+Image DecodeImage(const std::string& path, int desired_channels = 0);
+// Decodes every path in parallel on the given pool (ThreadPool::Default() if
+// null). The result is in the same order as paths; failed entries are invalid.
+std::vector<Image> DecodeImages(std::span<const std::string> paths, int desired_channels = 0,
+                                gpr5300::ThreadPool* pool = nullptr);
+// Creates a mipmapped 2D texture from a decoded image. Returns 0 if the image is invalid.
+// Blocks the GL thread for the whole copy; streaming code goes through TextureUploader.
+unsigned int UploadTexture(const Image& image, bool gamma = false);
+
+// Creates a cubemap from six decoded faces (+X, -X, +Y, -Y, +Z, -Z).
+unsigned int UploadCubemap(std::span<const Image> faces);
+
+// Immutable storage (glTexStorage2D) sized for the image, with a full mip chain
+// and the loaders' sampler state. The contents are left undefined.
+unsigned int AllocateTexture(const Image& image, bool gamma = false);
+// Single level RGB cubemap storage, contents left undefined.
+unsigned int AllocateCubemap(int width, int height);
+// Pixel transfer format (GL_RED, GL_RG, GL_RGB or GL_RGBA) of the image's channels.
+unsigned int ImageDataFormat(const Image& image);
+int MipLevelCount(int width, int height);
+// Shared 1x1 white texture bound in place of textures that are still loading.
+unsigned int FallbackTexture();
+
+// Pixels of a texture file as the loaders get them: baked BCn levels when an
+// up-to-date "<path>.dds" exists (or path is itself a .dds), decoded RGB(A) otherwise.
+struct TexturePixels
+{
+  Image image;
+  CompressedImage compressed;
+
+  [[nodiscard]] bool valid() const { return compressed.valid() || image.valid(); }
 };
 
+TexturePixels DecodeTexturePixels(const std::string& path);
+std::vector<TexturePixels> DecodeTexturePixels(std::span<const std::string> paths,
+                                               gpr5300::ThreadPool* pool = nullptr);
+// Uploads either representation. Returns 0 if pixels is invalid.
+unsigned int UploadTexturePixels(const TexturePixels& pixels, bool gamma = false);
+
+// Texture decoded on a worker thread and streamed by TextureUploader::Default(),
+// shared through TextureRegistry::Default() with every other user of the same
+// image. id() is the fallback texture until the real pixels are resident.
+class AsyncTexture
+{
+ public:
+  void Load(std::string path, bool gamma = false, gpr5300::ThreadPool* pool = nullptr);
+  // Call once per frame on the GL thread. Returns true once the texture is resident.
+  bool Update();
+  // Drops this reference; the texture is deleted once nothing else uses it.
+  void Delete();
+
+  [[nodiscard]] unsigned int id() const { return resident_ ? handle_.id() : FallbackTexture(); }
+  [[nodiscard]] bool resident() const { return resident_; }
+
+ private:
+  struct Decoded
+  {
+    std::uint64_t content_hash = 0;
+    TexturePixels pixels; // Left empty when the registry already had the image
+  };
+
+  std::future<Decoded> pending_;
+  std::string path_;
+  std::string canonical_path_;
+  TextureHandle handle_;
+  bool gamma_ = false;
+  bool resident_ = false;
+};
+
+// Fonction utilitaire pour charger une texture depuis un fichier
+unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
+
+// Génération d'un cubemap à partir d'un ensemble de chemins vers les images
+unsigned int GenerateCubemap(std::span<const std::string_view> faces_paths);
+
 
 class TextureManager
 {
@@ -26,4 +130,4 @@ class TextureManager
 
 
 
-#endif //SAMPLES_OPENGL_TEXTURE_LOADER_H
\ No newline at end of file
+#endif //SAMPLES_OPENGL_TEXTURE_LOADER_H
@@ -0,0 +1,87 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Counted reference to a texture owned by TextureRegistry. Copies add a
+// reference; the texture is deleted when the last handle goes away. Handles
+// must be created, copied and destroyed on the GL thread.
+class TextureHandle
+{
+ public:
+  TextureHandle() = default;
+  ~TextureHandle();
+  TextureHandle(const TextureHandle& other);
+  TextureHandle& operator=(const TextureHandle& other);
+  TextureHandle(TextureHandle&& other) noexcept;
+  TextureHandle& operator=(TextureHandle&& other) noexcept;
+
+  [[nodiscard]] unsigned int id() const { return id_; }
+  explicit operator bool() const { return id_ != 0; }
+
+ private:
+  friend class TextureRegistry;
+  // Takes over a reference already counted by the registry
+  explicit TextureHandle(unsigned int id) : id_(id) {}
+
+  unsigned int id_ = 0;
+};
+
+// Process-wide set of loaded textures, shared by every Model and scene.
+//
+// A texture is found either by its canonical path or by a hash of its file
+// contents, so the same image referenced from two glTF files (or copied
+// under another name) is uploaded once. Lookups are hash map lookups.
+//
+// Find/Insert/Load run on the GL thread; Contains may be called from loader
+// threads to skip decoding images that are already resident.
+class TextureRegistry
+{
+ public:
+  static TextureRegistry& Default();
+
+  // Any thread
+  [[nodiscard]] static std::string CanonicalPath(const std::string& path);
+  [[nodiscard]] bool Contains(const std::string& canonical_path, std::uint64_t content_hash, bool gamma) const;
+
+  // Looks up by path, then by content (content_hash 0 skips that step). A
+  // content match also registers the new path. Empty handle if not found.
+  TextureHandle Find(const std::string& canonical_path, std::uint64_t content_hash, bool gamma);
+  // Registers a freshly created texture, which the registry now owns.
+  TextureHandle Insert(const std::string& canonical_path, std::uint64_t content_hash, bool gamma,
+                       unsigned int texture);
+  // Synchronous load: Find, or decode, upload and Insert. Empty handle if the
+  // image cannot be read.
+  TextureHandle Load(const std::string& path, bool gamma = false);
+
+  [[nodiscard]] std::size_t texture_count() const;
+  [[nodiscard]] std::size_t path_hits() const { return path_hits_; }
+  [[nodiscard]] std::size_t content_hits() const { return content_hits_; }
+
+ private:
+  friend class TextureHandle;
+
+  struct Entry
+  {
+    int references = 0;
+    std::uint64_t content_key = 0;
+    std::vector<std::string> path_keys;
+  };
+
+  void AddReference(unsigned int texture);
+  void Release(unsigned int texture);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, unsigned int> by_path_;
+  std::unordered_map<std::uint64_t, unsigned int> by_content_;
+  std::unordered_map<unsigned int, Entry> entries_;
+  std::size_t path_hits_ = 0;
+  std::size_t content_hits_ = 0;
+};
+
+#endif // TEXTURE_REGISTRY_H
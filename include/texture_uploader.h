@@ -0,0 +1,106 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+
+#include "texture_compression.h"
+#include "texture_loader.h"
+
+// Streams decoded images to the GPU without stalling the frame.
+//
+// Enqueue() allocates immutable storage (glTexStorage2D) right away and
+// returns the texture name; the pixels are copied later by Flush(), once per
+// frame, through a ring of persistently mapped pixel buffer objects. Each
+// frame stages at most frame_budget_bytes (large images are split into row
+// strips, or rows of 4x4 blocks for BCn levels, spread over several frames)
+// and fences its PBO, which is written again only once the GPU has consumed
+// it. If that is not the case yet the frame simply uploads nothing.
+//
+// Every call must happen on the thread owning the GL context.
+class TextureUploader
+{
+ public:
+  static constexpr std::size_t kRingSize = 3;
+  static constexpr std::size_t kDefaultFrameBudget = 8u << 20;
+
+  explicit TextureUploader(std::size_t frame_budget_bytes = kDefaultFrameBudget);
+  ~TextureUploader();
+  TextureUploader(const TextureUploader&) = delete;
+  TextureUploader& operator=(const TextureUploader&) = delete;
+
+  // Shared uploader, created on first use (the GL context must exist by then).
+  static TextureUploader& Default();
+
+  // Returns the new texture, or 0 if the image is invalid. Its contents are
+  // undefined until pending() turns false.
+  unsigned int Enqueue(Image image, bool gamma = false);
+  // Every level of a block-compressed image, uploaded as is.
+  unsigned int Enqueue(CompressedImage image, bool gamma = false);
+  unsigned int Enqueue(TexturePixels pixels, bool gamma = false);
+  // Six faces (+X, -X, +Y, -Y, +Z, -Z) of the same size, stored as RGB.
+  unsigned int EnqueueCubemap(std::vector<Image> faces);
+  // Drops the queued strips of a texture about to be deleted.
+  void Cancel(unsigned int texture);
+
+  // Stages and submits up to the frame budget. Call once per frame.
+  void Flush();
+
+  [[nodiscard]] bool pending(unsigned int texture) const { return remaining_.contains(texture); }
+  [[nodiscard]] bool idle() const { return queue_.empty(); }
+  [[nodiscard]] std::size_t queued_bytes() const { return queued_bytes_; }
+  [[nodiscard]] std::size_t last_frame_bytes() const { return last_frame_bytes_; }
+  [[nodiscard]] std::size_t frame_budget() const { return frame_budget_; }
+
+ private:
+  // One level of one texture (or cubemap face)
+  struct Request
+  {
+    std::shared_ptr<const void> owner; // Keeps pixels alive
+    const std::byte* pixels = nullptr;
+    std::size_t row_bytes = 0;         // One row of texels, or of 4x4 blocks
+    int rows = 0;
+    int row_height = 1;                // Texels per row: 4 for block compressed data
+    int width = 0;
+    int height = 0;
+    int level = 0;
+    int next_row = 0;
+    GLuint texture = 0;
+    GLenum target = GL_TEXTURE_2D;     // Or the cubemap face
+    GLenum format = GL_RGBA;           // Transfer format, or compressed internal format
+    bool compressed = false;
+    bool mipmaps = false;              // Generate the other levels once this one is done
+  };
+
+  struct Segment
+  {
+    GLuint buffer = 0;
+    std::byte* mapped = nullptr;
+    GLsync fence = nullptr;
+  };
+
+  // Queues the request, or uploads it from client memory when a single row
+  // does not fit in a staging buffer.
+  void Push(Request request);
+  // Copies rows [first_row, first_row + row_count) from data, a client pointer
+  // or an offset into the bound unpack buffer.
+  static void Submit(const Request& request, int first_row, int row_count, const void* data);
+  void Finish(const Request& request);
+
+  std::array<Segment, kRingSize> ring_{};
+  std::size_t current_ = 0;
+  std::size_t frame_budget_;
+
+  std::deque<Request> queue_;
+  // Requests left per texture; a texture leaves the map when fully uploaded.
+  std::unordered_map<GLuint, int> remaining_;
+  std::size_t queued_bytes_ = 0;
+  std::size_t last_frame_bytes_ = 0;
+};
+
+#endif // TEXTURE_UPLOADER_H
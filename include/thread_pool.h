@@ -0,0 +1,91 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gpr5300
+{
+
+// Fixed-size worker pool for CPU-side loading work (image decoding, mesh
+// processing). Jobs must not touch the GL context.
+class ThreadPool
+{
+ public:
+  // 0 picks hardware_concurrency() - 1 workers, keeping one core for the GL thread.
+  explicit ThreadPool(std::size_t worker_count = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Shared pool used by the loaders when no pool is given explicitly.
+  static ThreadPool& Default();
+
+  [[nodiscard]] std::size_t worker_count() const { return workers_.size(); }
+
+  template <typename F>
+  auto Submit(F&& job) -> std::future<std::invoke_result_t<F>>
+  {
+    using Result = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+    std::future<Result> result = task->get_future();
+    Enqueue([task]() { (*task)(); });
+    return result;
+  }
+
+  // Runs body(i) for every i in [0, count) and blocks until all are done. The
+  // calling thread takes part in the work. Never allocates, so the render
+  // thread can fork work every frame.
+  template <typename Body>
+  void ParallelFor(const std::size_t count, Body&& body)
+  {
+    using BodyType = std::remove_reference_t<Body>;
+    Fork fork;
+    fork.count = count;
+    fork.body = const_cast<void*>(static_cast<const void*>(std::addressof(body)));
+    fork.invoke = [](void* context, const std::size_t i) { (*static_cast<BodyType*>(context))(i); };
+    RunFork(fork);
+  }
+
+ private:
+  // One ParallelFor in flight, on its caller's stack. Idle workers join the
+  // forks linked from forks_; the caller unlinks its fork once every index is
+  // handed out, then waits for the workers still inside it.
+  struct Fork
+  {
+    std::atomic<std::size_t> next_index{0};
+    std::size_t count = 0;
+    void* body = nullptr;
+    void (*invoke)(void*, std::size_t) = nullptr;
+    std::size_t helpers = 0; // Guarded by mutex_
+    Fork* next = nullptr;    // Guarded by mutex_
+  };
+
+  void Enqueue(std::function<void()> job);
+  void WorkerLoop();
+  void RunFork(Fork& fork);
+  static void Drain(Fork& fork);
+  // First fork with indices left, nullptr if none. mutex_ must be held.
+  [[nodiscard]] Fork* FindFork() const;
+
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  Fork* forks_ = nullptr;
+  std::condition_variable fork_finished_;
+  bool stopping_ = false;
+};
+
+} // namespace gpr5300
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,44 @@
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Locations of every active uniform of a linked program, gathered once with
+// glGetActiveUniform. Lookups hash the name in place (no allocation, no GL
+// call) and probe a flat open-addressing table.
+//
+// Arrays are reachable both by their base name ("samples") and per element
+// ("samples[3]"). Uniform block members have no location and are skipped.
+class UniformTable
+{
+ public:
+  // Replaces the table with the uniforms of program. GL thread only.
+  void Build(unsigned int program);
+  void Clear();
+
+  // -1 when the program has no such active uniform, like glGetUniformLocation
+  [[nodiscard]] int Find(std::string_view name) const;
+  [[nodiscard]] std::size_t size() const { return count_; }
+
+ private:
+  struct Slot
+  {
+    std::uint64_t hash = 0; // 0 marks an empty slot
+    int location = -1;
+    std::uint32_t name_offset = 0;
+    std::uint32_t name_length = 0;
+  };
+
+  [[nodiscard]] static std::uint64_t Hash(std::string_view name);
+  void Insert(std::string_view name, int location);
+
+  std::vector<Slot> slots_; // Power of two size, at most half full
+  std::string names_;
+  std::size_t count_ = 0;
+};
+
+#endif // UNIFORM_TABLE_H
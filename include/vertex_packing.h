@@ -0,0 +1,64 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/vec3.hpp>
+
+struct Vertex;
+
+// Vertex layouts stored in GeometryArena
+enum class VertexFormat : std::uint8_t
+{
+  kFloat,  // Vertex, 44 bytes of floats
+  kPacked, // PackedVertex, 20 bytes
+};
+inline constexpr std::size_t kVertexFormatCount = 2;
+
+// Compact Vertex: half float position and UV, normal and tangent as signed
+// normalized 10:10:10:2 (GL_INT_2_10_10_10_REV). Every attribute is expanded
+// to floats by the vertex fetch, so shaders read both formats unchanged.
+struct PackedVertex
+{
+  std::uint16_t position[4]; // Half floats, w = 1
+  std::uint32_t normal;
+  std::uint32_t tangent;
+  std::uint16_t tex_coords[2]; // Half floats
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex is read by the vertex fetch");
+
+// Largest error accepted when packing a mesh
+struct VertexPackingTolerance
+{
+  float position = 1.0f / 2048.0f; // Fraction of the largest AABB extent
+  float direction_degrees = 0.5f;  // Normals and tangents
+  float tex_coords = 1.0f / 4096.0f;
+};
+
+// Largest error measured while packing
+struct VertexPackingError
+{
+  float position = 0.0f; // Same unit as VertexPackingTolerance::position
+  float direction_degrees = 0.0f;
+  float tex_coords = 0.0f;
+
+  [[nodiscard]] bool Within(const VertexPackingTolerance& tolerance) const
+  {
+    return position <= tolerance.position && direction_degrees <= tolerance.direction_degrees &&
+           tex_coords <= tolerance.tex_coords;
+  }
+};
+
+[[nodiscard]] PackedVertex PackVertex(const Vertex& vertex);
+[[nodiscard]] Vertex UnpackVertex(const PackedVertex& vertex);
+
+// Packs every vertex into packed and measures the round-trip error against
+// the mesh bounds. Returns false, leaving packed empty, when the error is
+// above tolerance: half floats lose too much on meshes that are small
+// compared to their distance from the origin, or on heavily tiled UVs.
+bool PackVertices(std::span<const Vertex> vertices, const glm::vec3& aabb_min, const glm::vec3& aabb_max,
+                  std::vector<PackedVertex>& packed, const VertexPackingTolerance& tolerance = {},
+                  VertexPackingError* error = nullptr);
+
+#endif // VERTEX_PACKING_H
@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bounds.h"
+#include "bvh.h"
+#include "free_camera.h"
+#include "frustum_culling.h"
+#include "model.h"
+
+// Bounding volume hierarchy build and query times, CPU only (no GL context
+// needed). Imports the meshes of a model (the roman baths by default) and
+// builds two trees:
+//  - a scene tree over the mesh boxes of copies of the model laid on a grid,
+//    timed for the SAH build, a refit after moving a quarter of the copies,
+//    frustum and sphere queries against culling every box (CullAabbs), and
+//    ray casts against testing every box;
+//  - a mesh tree over the model's triangles, timed for the build and for ray
+//    casts against testing every triangle.
+// Usage: bvh_bench [model] [min_seconds]
+//   fails if a query finds other items than testing them all
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Best seconds of one call to run() over calls lasting min_seconds in total
+template <typename Run>
+double BestSeconds(const double min_seconds, Run&& run)
+{
+  double best = std::numeric_limits<double>::infinity();
+  double total = 0.0;
+  do
+  {
+    const auto start = Clock::now();
+    run();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = std::min(best, seconds);
+    total += seconds;
+  } while (total < min_seconds);
+  return best;
+}
+
+// Same items, whatever the order they were found in
+bool SameItems(std::span<std::uint32_t> a, std::span<std::uint32_t> b)
+{
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+  return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+// Nearest entry distance along the ray into box, infinity if it misses
+float RayBoxDistance(const glm::vec3& origin, const glm::vec3& direction, const BoundingBox& box)
+{
+  float t_near = 0.0f;
+  float t_far = std::numeric_limits<float>::infinity();
+  for (int axis = 0; axis < 3; axis++)
+  {
+    const float inverse = 1.0f / (direction[axis] == 0.0f ? 1e-30f : direction[axis]);
+    const float t0 = (box.min[axis] - origin[axis]) * inverse;
+    const float t1 = (box.max[axis] - origin[axis]) * inverse;
+    t_near = std::fmax(t_near, std::min(t0, t1));
+    t_far = std::fmin(t_far, std::max(t0, t1));
+  }
+  return t_near <= t_far ? t_near : std::numeric_limits<float>::infinity();
+}
+
+struct Camera
+{
+  const char* name;
+  glm::vec3 position;
+  glm::vec3 target;
+};
+
+int BenchSceneTree(std::span<const MeshData> meshes, const int grid_side, const double min_seconds)
+{
+  BoundingBox model_box;
+  for (const MeshData& mesh : meshes)
+  {
+    model_box.min = glm::min(model_box.min, mesh.aabb_min);
+    model_box.max = glm::max(model_box.max, mesh.aabb_max);
+  }
+  const glm::vec3 model_extent = model_box.max - model_box.min;
+  const float spacing = 1.25f * std::max(model_extent.x, model_extent.z);
+  const float grid_extent = spacing * static_cast<float>(grid_side);
+
+  // Copy c of the model sits at the grid cell (c % side, c / side)
+  const auto copy_count = static_cast<std::size_t>(grid_side * grid_side);
+  std::vector<glm::mat4> transforms(copy_count);
+  for (std::size_t c = 0; c < copy_count; c++)
+  {
+    const glm::vec3 cell(static_cast<float>(c % grid_side), 0.0f, static_cast<float>(c / grid_side));
+    transforms[c] = glm::translate(glm::mat4(1.0f), cell * spacing - model_box.min);
+  }
+  std::vector<BoundingBox> boxes;
+  boxes.reserve(copy_count * meshes.size());
+  for (const glm::mat4& transform : transforms)
+  {
+    for (const MeshData& mesh : meshes)
+    {
+      BoundingBox& box = boxes.emplace_back();
+      TransformAabb(transform, mesh.aabb_min, mesh.aabb_max, box.min, box.max);
+    }
+  }
+  const std::size_t count = boxes.size();
+  AabbSoa soa;
+  soa.Reserve(count);
+  for (const BoundingBox& box : boxes)
+  {
+    soa.Add(box.min, box.max);
+  }
+
+  Bvh bvh;
+  const double build = BestSeconds(min_seconds, [&]() { bvh.Build(boxes); });
+  std::printf("scene tree, %d x %d copies, %zu meshes\n", grid_side, grid_side, count);
+  std::printf("  build %10.3f ms  %8.2f M items/s  %zu nodes  SAH cost %.1f\n", build * 1e3, count / build / 1e6,
+              bvh.nodes().size(), bvh.build_cost());
+
+  int status = EXIT_SUCCESS;
+  std::vector<std::uint32_t> found(count);
+  std::vector<std::uint32_t> expected(count);
+  const glm::vec3 center(grid_extent * 0.5f, model_extent.y * 0.5f, grid_extent * 0.5f);
+  const float far_plane = 2.0f * grid_extent + spacing;
+  const Camera cameras[] = {
+      {"center, level", center, center + glm::vec3(1.0f, 0.0f, 0.0f)},
+      {"above, down", center + glm::vec3(0.0f, grid_extent * 0.6f, 0.01f), center},
+      {"outside, across", center + glm::vec3(-grid_extent, grid_extent * 0.25f, -grid_extent), center},
+  };
+  std::printf("  %-18s %9s %14s %12s %12s\n", "frustum", "visible", "accepted whole", "CullAabbs us", "Bvh us");
+  for (const Camera& camera : cameras)
+  {
+    Frustum frustum;
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, far_plane);
+    const glm::mat4 view = glm::lookAt(camera.position, camera.target, glm::vec3(0.0f, 1.0f, 0.0f));
+    frustum.Update(projection * view);
+    std::size_t expected_count = 0;
+    std::size_t found_count = 0;
+    Bvh::QueryStats stats;
+    const double brute = BestSeconds(min_seconds, [&]() { expected_count = CullAabbs(frustum, soa, expected); });
+    const double tree =
+        BestSeconds(min_seconds, [&]() { found_count = bvh.QueryFrustum(frustum, found, &stats); });
+    std::printf("  %-18s %8.1f%% %13.1f%% %12.1f %12.1f\n", camera.name, 100.0 * expected_count / count,
+                100.0 * stats.items_accepted / std::max<std::size_t>(found_count, 1), brute * 1e6, tree * 1e6);
+    if (!SameItems(std::span(found).first(found_count), std::span(expected).first(expected_count)))
+    {
+      std::fprintf(stderr, "ERROR::BVH_BENCH::FRUSTUM_MISMATCH %s: %zu brute force, %zu tree\n", camera.name,
+                   expected_count, found_count);
+      status = EXIT_FAILURE;
+    }
+  }
+
+  // Light-sized spheres and picking rays over the grid
+  constexpr std::size_t kQueryCount = 256;
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> across(0.0f, grid_extent);
+  std::uniform_real_distribution<float> height(0.0f, model_extent.y);
+  std::vector<glm::vec3> points(kQueryCount);
+  std::vector<glm::vec3> directions(kQueryCount);
+  for (std::size_t i = 0; i < kQueryCount; i++)
+  {
+    points[i] = glm::vec3(across(random), height(random), across(random));
+    directions[i] = glm::normalize(glm::vec3(across(random), height(random), across(random)) - points[i]);
+  }
+  const float radius = spacing * 0.5f;
+  std::size_t overlaps = 0;
+  const double sphere_brute = BestSeconds(min_seconds, [&]() {
+    overlaps = 0;
+    for (const glm::vec3& point : points)
+    {
+      for (const BoundingBox& box : boxes)
+      {
+        const glm::vec3 offset = glm::clamp(point, box.min, box.max) - point;
+        overlaps += glm::dot(offset, offset) <= radius * radius;
+      }
+    }
+  });
+  const double sphere_tree = BestSeconds(min_seconds, [&]() {
+    for (const glm::vec3& point : points)
+    {
+      static_cast<void>(bvh.QuerySphere(point, radius, found));
+    }
+  });
+  for (const glm::vec3& point : points)
+  {
+    const std::size_t found_count = bvh.QuerySphere(point, radius, found);
+    std::size_t expected_count = 0;
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+      const glm::vec3 offset = glm::clamp(point, boxes[i].min, boxes[i].max) - point;
+      if (glm::dot(offset, offset) <= radius * radius)
+      {
+        expected[expected_count++] = i;
+      }
+    }
+    if (!SameItems(std::span(found).first(found_count), std::span(expected).first(expected_count)))
+    {
+      std::fprintf(stderr, "ERROR::BVH_BENCH::SPHERE_MISMATCH %zu brute force, %zu tree\n", expected_count,
+                   found_count);
+      status = EXIT_FAILURE;
+      break;
+    }
+  }
+  std::printf("  %zu spheres      %8.1f hits/query %12.1f us %9.1f us\n", kQueryCount,
+              static_cast<double>(overlaps) / kQueryCount, sphere_brute * 1e6, sphere_tree * 1e6);
+
+  std::vector<float> nearest(kQueryCount);
+  const double ray_brute = BestSeconds(min_seconds, [&]() {
+    for (std::size_t r = 0; r < kQueryCount; r++)
+    {
+      nearest[r] = std::numeric_limits<float>::infinity();
+      for (const BoundingBox& box : boxes)
+      {
+        nearest[r] = std::min(nearest[r], RayBoxDistance(points[r], directions[r], box));
+      }
+    }
+  });
+  std::vector<Bvh::RayHit> hits(kQueryCount);
+  const double ray_tree = BestSeconds(min_seconds, [&]() {
+    for (std::size_t r = 0; r < kQueryCount; r++)
+    {
+      hits[r] = bvh.Raycast(points[r], directions[r]);
+    }
+  });
+  for (std::size_t r = 0; r < kQueryCount; r++)
+  {
+    if (hits[r].distance != nearest[r])
+    {
+      std::fprintf(stderr, "ERROR::BVH_BENCH::RAY_MISMATCH ray %zu: %g brute force, %g tree\n", r, nearest[r],
+                   hits[r].distance);
+      status = EXIT_FAILURE;
+      break;
+    }
+  }
+  std::printf("  %zu rays         %25.1f us %9.1f us\n", kQueryCount, ray_brute * 1e6, ray_tree * 1e6);
+
+  // A quarter of the copies go up and down by half their height: only their
+  // meshes are updated, then refitted
+  const std::size_t mesh_count = meshes.size();
+  float lift = model_extent.y * 0.5f;
+  std::size_t changed = 0;
+  const double refit = BestSeconds(min_seconds, [&]() {
+    lift = -lift;
+    for (std::size_t c = 0; c < copy_count; c += 4)
+    {
+      const glm::mat4 transform = glm::translate(transforms[c], glm::vec3(0.0f, lift, 0.0f));
+      for (std::size_t m = 0; m < mesh_count; m++)
+      {
+        BoundingBox box;
+        TransformAabb(transform, meshes[m].aabb_min, meshes[m].aabb_max, box.min, box.max);
+        bvh.Update(static_cast<std::uint32_t>(c * mesh_count + m), box);
+      }
+    }
+    changed = bvh.Refit();
+  });
+  std::printf("  refit %10.3f ms  %zu node updates, SAH cost %.1f (x%.2f of the build)\n", refit * 1e3, changed,
+              bvh.SahCost(), bvh.SahCost() / bvh.build_cost());
+  return status;
+}
+
+int BenchMeshTree(std::span<const MeshData> meshes, const double min_seconds)
+{
+  // Triangles of every mesh, in the model's space
+  std::vector<glm::vec3> corners;
+  for (const MeshData& mesh : meshes)
+  {
+    for (const unsigned int index : mesh.indices)
+    {
+      corners.push_back(mesh.vertices[index].Position);
+    }
+  }
+  const std::size_t count = corners.size() / 3;
+  std::vector<BoundingBox> boxes(count);
+  BoundingBox model_box;
+  for (std::size_t t = 0; t < count; t++)
+  {
+    for (std::size_t k = 0; k < 3; k++)
+    {
+      boxes[t].min = glm::min(boxes[t].min, corners[3 * t + k]);
+      boxes[t].max = glm::max(boxes[t].max, corners[3 * t + k]);
+    }
+    model_box.min = glm::min(model_box.min, boxes[t].min);
+    model_box.max = glm::max(model_box.max, boxes[t].max);
+  }
+
+  Bvh bvh;
+  const double build = BestSeconds(min_seconds, [&]() { bvh.Build(boxes); });
+  std::printf("mesh tree, %zu triangles\n", count);
+  std::printf("  build %10.3f ms  %8.2f M tris/s  %zu nodes  SAH cost %.1f\n", build * 1e3, count / build / 1e6,
+              bvh.nodes().size(), bvh.build_cost());
+
+  // Rays from a sphere around the model towards points inside its box
+  constexpr std::size_t kRayCount = 1024;
+  constexpr std::size_t kCheckedRays = 32;
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const glm::vec3 center = (model_box.min + model_box.max) * 0.5f;
+  const float outside = glm::length(model_box.max - model_box.min);
+  std::vector<glm::vec3> origins(kRayCount);
+  std::vector<glm::vec3> directions(kRayCount);
+  for (std::size_t r = 0; r < kRayCount; r++)
+  {
+    const glm::vec3 target =
+        model_box.min + (model_box.max - model_box.min) * glm::vec3(unit(random), unit(random), unit(random));
+    const glm::vec3 away = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) - 0.5f + 1e-3f);
+    origins[r] = center + away * outside;
+    directions[r] = glm::normalize(target - origins[r]);
+  }
+  const auto intersect = [&](const std::size_t r, const std::uint32_t t) {
+    return IntersectRayTriangle(origins[r], directions[r], corners[3 * t], corners[3 * t + 1], corners[3 * t + 2]);
+  };
+
+  std::vector<float> nearest(kCheckedRays);
+  const double brute = BestSeconds(min_seconds, [&]() {
+    for (std::size_t r = 0; r < kCheckedRays; r++)
+    {
+      nearest[r] = std::numeric_limits<float>::infinity();
+      for (std::uint32_t t = 0; t < count; t++)
+      {
+        nearest[r] = std::min(nearest[r], intersect(r, t));
+      }
+    }
+  });
+  std::vector<Bvh::RayHit> hits(kRayCount);
+  const double tree = BestSeconds(min_seconds, [&]() {
+    for (std::size_t r = 0; r < kRayCount; r++)
+    {
+      hits[r] = bvh.Raycast(origins[r], directions[r], std::numeric_limits<float>::infinity(),
+                            [&](const std::uint32_t t, float) { return intersect(r, t); });
+    }
+  });
+  std::size_t hit_count = 0;
+  for (const Bvh::RayHit& hit : hits)
+  {
+    hit_count += static_cast<bool>(hit);
+  }
+  std::printf("  rays  %10.1f k/s brute force  %10.1f k/s tree  %zu / %zu hit\n", kCheckedRays / brute / 1e3,
+              kRayCount / tree / 1e3, hit_count, kRayCount);
+  for (std::size_t r = 0; r < kCheckedRays; r++)
+  {
+    if (hits[r].distance != nearest[r])
+    {
+      std::fprintf(stderr, "ERROR::BVH_BENCH::TRIANGLE_MISMATCH ray %zu: %g brute force, %g tree\n", r, nearest[r],
+                   hits[r].distance);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string path = argc > 1 ? argv[1] : "data/roman_baths/scene.gltf";
+  const double min_seconds = argc > 2 ? std::max(0.01, std::atof(argv[2])) : 0.25;
+
+  // The meshes scene3d would draw: optimized and split like at import
+  std::vector<MeshData> meshes;
+  if (!Model::ImportWithAssimp(path, meshes))
+  {
+    return EXIT_FAILURE;
+  }
+  std::printf("%s: %zu meshes\n", path.c_str(), meshes.size());
+
+  int status = BenchMeshTree(meshes, min_seconds);
+  for (const int grid_side : {1, 8, 32, 96})
+  {
+    if (BenchSceneTree(meshes, grid_side, min_seconds) != EXIT_SUCCESS)
+    {
+      status = EXIT_FAILURE;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "free_camera.h"
+#include "frustum_culling.h"
+
+// Frustum culling throughput, CPU only (no GL context needed).
+// Scatters random boxes and spheres around a camera, then culls them one at a
+// time through Frustum::IsAABBInFrustum / IsSphereInFrustum and in batches
+// through CullAabbs / CullSpheres (bitmask and index list), and prints the
+// volumes tested per second of each path.
+// Usage: frustum_culling_bench [min_seconds]
+//   fails if a batch keeps a different set of volumes than the scalar path
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Best volumes per second of cull() over runs lasting min_seconds in total
+template <typename Cull>
+double Throughput(const std::size_t count, const double min_seconds, Cull&& cull)
+{
+  double best = 0.0;
+  double total = 0.0;
+  do
+  {
+    const auto start = Clock::now();
+    cull();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = std::max(best, static_cast<double>(count) / std::max(seconds, 1e-9));
+    total += seconds;
+  } while (total < min_seconds);
+  return best;
+}
+
+void PrintRow(const char* name, const double rate, const double scalar_rate)
+{
+  std::printf("  %-20s %10.1f M/s  x%.1f\n", name, rate / 1e6, rate / scalar_rate);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const double min_seconds = argc > 1 ? std::max(0.01, std::atof(argv[1])) : 0.25;
+
+  // Camera at the origin looking down -z over a cube of volumes: about a tenth are kept
+  Frustum frustum;
+  const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+  const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  frustum.Update(projection * view);
+
+  std::printf("frustum culling, %s batches\n", FrustumCullingIsa());
+  int status = EXIT_SUCCESS;
+  for (const std::size_t count : {std::size_t{10'000}, std::size_t{100'000}, std::size_t{1'000'000}})
+  {
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-400.0f, 400.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 4.0f);
+    std::vector<glm::vec3> aabb_min(count), aabb_max(count);
+    AabbSoa boxes;
+    SphereSoa spheres;
+    boxes.Reserve(count);
+    spheres.Reserve(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+      const glm::vec3 center(position(random), position(random), position(random));
+      const glm::vec3 half(extent(random), extent(random), extent(random));
+      aabb_min[i] = center - half;
+      aabb_max[i] = center + half;
+      boxes.Add(aabb_min[i], aabb_max[i]);
+      spheres.Add(center, glm::length(half));
+    }
+
+    std::vector<std::uint64_t> mask(VisibilityMaskWords(count));
+    std::vector<std::uint32_t> indices(count);
+    std::vector<std::uint32_t> expected;
+    expected.reserve(count);
+    std::size_t kept = 0;
+
+    std::printf("%zu volumes\n", count);
+    const double aabb_scalar = Throughput(count, min_seconds, [&]() {
+      expected.clear();
+      for (std::size_t i = 0; i < count; i++)
+      {
+        if (frustum.IsAABBInFrustum(aabb_min[i], aabb_max[i]))
+        {
+          expected.push_back(static_cast<std::uint32_t>(i));
+        }
+      }
+    });
+    PrintRow("AABB, one by one", aabb_scalar, aabb_scalar);
+    PrintRow("AABB, bitmask", Throughput(count, min_seconds, [&]() { CullAabbs(frustum, boxes, std::span(mask)); }),
+             aabb_scalar);
+    PrintRow("AABB, index list",
+             Throughput(count, min_seconds, [&]() { kept = CullAabbs(frustum, boxes, std::span(indices)); }),
+             aabb_scalar);
+    std::size_t mask_kept = 0;
+    for (const std::uint64_t word : mask)
+    {
+      mask_kept += static_cast<std::size_t>(std::popcount(word));
+    }
+    if (kept != expected.size() || mask_kept != kept || !std::equal(expected.begin(), expected.end(), indices.begin()))
+    {
+      std::fprintf(stderr, "ERROR::FRUSTUM_CULLING_BENCH::AABB_MISMATCH %zu/%zu/%zu kept\n", expected.size(), kept,
+                   mask_kept);
+      status = EXIT_FAILURE;
+    }
+
+    const double sphere_scalar = Throughput(count, min_seconds, [&]() {
+      expected.clear();
+      for (std::size_t i = 0; i < count; i++)
+      {
+        if (frustum.IsSphereInFrustum(
+                Sphere(glm::vec3(spheres.center_x[i], spheres.center_y[i], spheres.center_z[i]), spheres.radius[i])))
+        {
+          expected.push_back(static_cast<std::uint32_t>(i));
+        }
+      }
+    });
+    PrintRow("sphere, one by one", sphere_scalar, sphere_scalar);
+    PrintRow("sphere, bitmask",
+             Throughput(count, min_seconds, [&]() { CullSpheres(frustum, spheres, std::span(mask)); }), sphere_scalar);
+    PrintRow("sphere, index list",
+             Throughput(count, min_seconds, [&]() { kept = CullSpheres(frustum, spheres, std::span(indices)); }),
+             sphere_scalar);
+    if (kept != expected.size() || !std::equal(expected.begin(), expected.end(), indices.begin()))
+    {
+      std::fprintf(stderr, "ERROR::FRUSTUM_CULLING_BENCH::SPHERE_MISMATCH %zu/%zu kept\n", expected.size(), kept);
+      status = EXIT_FAILURE;
+    }
+    std::printf("  kept %zu / %zu\n", kept, count);
+  }
+  return status;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "free_camera.h"
+#include "instance_culling.h"
+#include "thread_pool.h"
+
+// Per-instance culling cost, CPU only (no GL context needed).
+// Scatters instances over a ring like scene3d's asteroid belt, then for
+// several camera poses culls them with InstanceCuller on the calling thread
+// and on the default thread pool, and compacts the visible transforms. Prints
+// the visible fraction, the cull and compaction times, and the instances
+// culled per second.
+// Usage: instance_culling_bench [min_seconds]
+//   fails if the parallel path keeps different instances than the serial one
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Best time of run(), in microseconds, over runs lasting min_seconds in total
+template <typename Run>
+double BestMicroseconds(const double min_seconds, Run&& run)
+{
+  double best = 1e30;
+  double total = 0.0;
+  do
+  {
+    const auto start = Clock::now();
+    run();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = std::min(best, seconds * 1e6);
+    total += seconds;
+  } while (total < min_seconds);
+  return best;
+}
+
+struct CameraPose
+{
+  const char* name;
+  glm::vec3 position;
+  glm::vec3 target;
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const double min_seconds = argc > 1 ? std::max(0.01, std::atof(argv[1])) : 0.2;
+  constexpr float kRingRadius = 100.0f;
+  constexpr float kRingWidth = 10.0f;
+  const BoundingSphere asteroid{glm::vec3(0.0f), 1.0f};
+  const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  const CameraPose poses[] = {
+      {"along the ring", glm::vec3(kRingRadius, 2.0f, 0.0f), glm::vec3(kRingRadius, 2.0f, -50.0f)},
+      {"outside, facing", glm::vec3(0.0f, 20.0f, 2.5f * kRingRadius), glm::vec3(0.0f)},
+      {"above, down", glm::vec3(0.0f, 2.5f * kRingRadius, 0.01f), glm::vec3(0.0f)},
+      {"center, outward", glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)},
+      {"away", glm::vec3(0.0f, 0.0f, 3.0f * kRingRadius), glm::vec3(0.0f, 0.0f, 4.0f * kRingRadius)},
+  };
+
+  gpr5300::ThreadPool& pool = gpr5300::ThreadPool::Default();
+  std::printf("instance culling, %zu workers + caller\n", pool.worker_count());
+  int status = EXIT_SUCCESS;
+  for (const std::size_t count : {std::size_t{1'000}, std::size_t{10'000}, std::size_t{100'000}, std::size_t{1'000'000}})
+  {
+    std::mt19937 random(15678);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::mat4> transforms(count);
+    for (glm::mat4& transform : transforms)
+    {
+      const float angle = unit(random) * 2.0f * std::numbers::pi_v<float>;
+      const float radius = kRingRadius + (unit(random) - 0.5f) * kRingWidth;
+      const glm::vec3 position(std::sin(angle) * radius, (unit(random) - 0.5f) * 2.0f, std::cos(angle) * radius);
+      transform = glm::translate(glm::mat4(1.0f), position) *
+                  glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) *
+                  glm::scale(glm::mat4(1.0f), glm::vec3(0.05f + 0.2f * unit(random)));
+    }
+    std::vector<glm::mat4> compacted(count);
+
+    std::printf("%zu instances\n", count);
+    std::printf("  %-18s %8s %12s %12s %12s %14s\n", "camera", "visible", "serial us", "parallel us",
+                "compact us", "parallel M/s");
+    for (const CameraPose& pose : poses)
+    {
+      Frustum frustum;
+      frustum.Update(projection * glm::lookAt(pose.position, pose.target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+      InstanceCuller serial;
+      InstanceCuller parallel;
+      const double serial_us =
+          BestMicroseconds(min_seconds, [&]() { serial.Cull(frustum, transforms, asteroid); });
+      const double parallel_us =
+          BestMicroseconds(min_seconds, [&]() { parallel.Cull(frustum, transforms, asteroid, &pool); });
+      const double compact_us =
+          BestMicroseconds(min_seconds, [&]() { parallel.Compact(transforms, compacted, &pool); });
+
+      if (!std::ranges::equal(serial.visible(), parallel.visible()))
+      {
+        std::fprintf(stderr, "ERROR::INSTANCE_CULLING_BENCH::MISMATCH %s: %zu serial, %zu parallel\n", pose.name,
+                     serial.visible().size(), parallel.visible().size());
+        status = EXIT_FAILURE;
+      }
+      for (std::size_t i = 0; i < parallel.visible().size(); i++)
+      {
+        if (compacted[i] != transforms[parallel.visible()[i]])
+        {
+          std::fprintf(stderr, "ERROR::INSTANCE_CULLING_BENCH::COMPACTION %s at %zu\n", pose.name, i);
+          status = EXIT_FAILURE;
+          break;
+        }
+      }
+      std::printf("  %-18s %7.1f%% %12.1f %12.1f %12.1f %14.1f\n", pose.name,
+                  100.0 * static_cast<double>(parallel.visible().size()) / static_cast<double>(count), serial_us,
+                  parallel_us, compact_us, static_cast<double>(count) / parallel_us);
+    }
+  }
+  return status;
+}
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+#include "meshlet.h"
+#include "model.h"
+
+// Import-time mesh optimization report, CPU only (no GL context needed).
+// Imports each model with Assimp, then prints the simulated post-transform
+// cache efficiency (ACMR, ATVR) of every mesh before and after OptimizeMesh,
+// then the triangle count and error of the levels of detail of each mesh, and
+// the cache efficiency left once its triangles are grouped into meshlets.
+// Usage: mesh_optimizer_report [model...]
+//   defaults to the models bundled under data/
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+void PrintRow(const char* name, const MeshOptimizationReport& report)
+{
+  std::printf("  %-12s %8zu tris  %8zu -> %8zu verts  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", name,
+              report.before.triangle_count, report.before.vertex_count, report.after.vertex_count,
+              report.before.acmr(), report.after.acmr(), report.before.atvr(), report.after.atvr());
+}
+
+void PrintLods(const MeshData& mesh)
+{
+  std::printf("  %-12s %8zu tris", "", mesh.indices.size() / 3);
+  for (const MeshLodData& lod : mesh.lods)
+  {
+    std::printf(" -> %zu (%.4g)", lod.indices.size() / 3, lod.error);
+  }
+  std::printf("\n");
+}
+
+void PrintMeshlets(const MeshData& mesh)
+{
+  const VertexCacheStats stats = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+  std::printf("  %-12s %8zu meshlets  ACMR %.3f\n", "", mesh.meshlets.size(), stats.acmr());
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++)
+  {
+    paths.emplace_back(argv[i]);
+  }
+  if (paths.empty())
+  {
+    paths = {"data/14/scene.gltf", "data/15/scene.gltf", "data/17/scene.gltf", "data/roman_baths/scene.gltf"};
+  }
+
+  int failures = 0;
+  for (const std::string& path : paths)
+  {
+    std::vector<MeshData> meshes;
+    if (!Model::ImportWithAssimp(path, meshes, false))
+    {
+      failures++;
+      continue;
+    }
+
+    std::cout << path << ": " << meshes.size() << " meshes\n";
+    MeshOptimizationReport total;
+    double milliseconds = 0.0;
+    double lod_milliseconds = 0.0;
+    double meshlet_milliseconds = 0.0;
+    for (std::size_t i = 0; i < meshes.size(); i++)
+    {
+      const auto start = Clock::now();
+      const MeshOptimizationReport report = OptimizeMesh(meshes[i].vertices, meshes[i].indices);
+      milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+      PrintRow(("mesh " + std::to_string(i)).c_str(), report);
+      const auto lod_start = Clock::now();
+      GenerateLods(meshes[i]);
+      lod_milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - lod_start).count();
+      PrintLods(meshes[i]);
+      const auto meshlet_start = Clock::now();
+      meshes[i].meshlets = BuildMeshlets(meshes[i].vertices, meshes[i].indices);
+      meshlet_milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - meshlet_start).count();
+      PrintMeshlets(meshes[i]);
+      total.before.triangle_count += report.before.triangle_count;
+      total.before.vertex_count += report.before.vertex_count;
+      total.before.transformed_count += report.before.transformed_count;
+      total.after.triangle_count += report.after.triangle_count;
+      total.after.vertex_count += report.after.vertex_count;
+      total.after.transformed_count += report.after.transformed_count;
+      total.duplicates_removed += report.duplicates_removed;
+    }
+    PrintRow("total", total);
+    std::cout << "  " << total.duplicates_removed << " duplicate vertices merged, " << milliseconds << " ms\n";
+    std::cout << "  levels of detail generated in " << lod_milliseconds << " ms\n";
+    std::cout << "  meshlets built in " << meshlet_milliseconds << " ms\n";
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+
+#include "allocation_tracker.h"
+#include "model.h"
+
+// Per-frame allocation benchmark of the Model/Mesh accessors.
+// Loads a model in a hidden GL window, then replays the accesses scene3d makes
+// every frame (meshes, textures, bounds, levels of detail) through the views
+// returned by Model and Mesh, and through the by-value copies they used to
+// return. Prints the heap allocations per frame of both, and the CPU-side
+// geometry kept with and without Model::set_keep_cpu_data.
+// Usage: model_memory_bench [model] [frames]
+//   fails if the view path allocates in steady state
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Allocations made by frame() over frames calls
+template <typename Frame>
+gpr5300::AllocationCounters MeasureFrames(const int frames, Frame&& frame)
+{
+  const gpr5300::AllocationCounters start = gpr5300::AllocationTracker::thread_total();
+  for (int i = 0; i < frames; i++)
+  {
+    frame();
+  }
+  const gpr5300::AllocationCounters end = gpr5300::AllocationTracker::thread_total();
+  return {end.count - start.count, end.bytes - start.bytes};
+}
+
+std::size_t CpuGeometryBytes(const Model& model)
+{
+  std::size_t bytes = 0;
+  for (const Mesh& mesh : model.meshes())
+  {
+    bytes += mesh.vertices().size_bytes() + mesh.indices().size_bytes();
+  }
+  return bytes;
+}
+
+// What scene3d reads every frame, through views only
+unsigned int ViewFrame(const Model& model)
+{
+  unsigned int checksum = 0;
+  if (!model.get_textures_loaded().empty())
+  {
+    checksum += model.get_textures_loaded()[0].id;
+  }
+  glm::vec3 aabb_min, aabb_max;
+  model.GetBoundingBox(aabb_min, aabb_max);
+  checksum += static_cast<unsigned int>(model.lod_errors()[1] > 0.0f);
+  for (const Mesh& mesh : model.meshes())
+  {
+    checksum += static_cast<unsigned int>(mesh.geometry().index_count() + mesh.lod_errors().size());
+    for (const Texture& texture : mesh.textures())
+    {
+      checksum += texture.id;
+    }
+  }
+  return checksum;
+}
+
+// The same reads through the former by-value accessors
+unsigned int CopyFrame(const Model& model)
+{
+  unsigned int checksum = 0;
+  const std::span<const Texture> loaded = model.get_textures_loaded();
+  if (!std::vector<Texture>(loaded.begin(), loaded.end()).empty())
+  {
+    checksum += std::vector<Texture>(loaded.begin(), loaded.end())[0].id;
+  }
+  for (const Mesh& mesh : model.meshes())
+  {
+    const std::vector<Vertex> vertices(mesh.vertices().begin(), mesh.vertices().end());
+    const std::vector<unsigned int> indices(mesh.indices().begin(), mesh.indices().end());
+    const std::vector<Texture> textures(mesh.textures().begin(), mesh.textures().end());
+    checksum += static_cast<unsigned int>(vertices.size() + indices.size() + textures.size());
+  }
+  return checksum;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string path = argc > 1 ? argv[1] : "data/14/scene.gltf";
+  const int frames = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1000;
+
+  SDL_Init(SDL_INIT_VIDEO);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
+  SDL_Window* window = SDL_CreateWindow("model_memory_bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64,
+                                        64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  SDL_GLContext context = window ? SDL_GL_CreateContext(window) : nullptr;
+  if (context == nullptr || glewInit() != GLEW_OK)
+  {
+    std::cerr << "ERROR::MODEL_MEMORY_BENCH::NO_GL_CONTEXT " << SDL_GetError() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+  for (const bool keep_cpu_data : {true, false})
+  {
+    Model model;
+    model.set_keep_cpu_data(keep_cpu_data);
+    const auto start = Clock::now();
+    model.LoadModel(path);
+    const double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (model.meshes().empty())
+    {
+      std::cerr << "ERROR::MODEL_MEMORY_BENCH::LOAD_FAILED " << path << "\n";
+      status = EXIT_FAILURE;
+      break;
+    }
+
+    std::cout << path << (keep_cpu_data ? ", CPU copies kept" : ", CPU copies released") << ": "
+              << model.meshes().size() << " meshes, " << CpuGeometryBytes(model) / 1024 << " KiB of CPU geometry, "
+              << load_ms << " ms to load\n";
+
+    volatile unsigned int sink = 0;
+    ViewFrame(model); // Warm-up: lazily created statics
+    const gpr5300::AllocationCounters views = MeasureFrames(frames, [&]() { sink = sink + ViewFrame(model); });
+    const gpr5300::AllocationCounters copies = MeasureFrames(frames, [&]() { sink = sink + CopyFrame(model); });
+    std::cout << "  views:  " << static_cast<double>(views.count) / frames << " allocations/frame, "
+              << views.bytes / frames << " bytes/frame\n";
+    std::cout << "  copies: " << static_cast<double>(copies.count) / frames << " allocations/frame, "
+              << copies.bytes / frames << " bytes/frame\n";
+    if (views.count != 0)
+    {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return status;
+}
@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bounds.h"
+#include "model.h"
+#include "occlusion_culling.h"
+#include "thread_pool.h"
+
+// Software occlusion culling cost and correctness, CPU only (no GL context
+// needed). Checks OcclusionCuller on a wall with boxes around it, then imports
+// the meshes of a model (the roman baths by default), registers the largest
+// ones as occluders like scene3d does and, for several camera poses,
+// rasterizes them on the calling thread and on the default thread pool and
+// tests the box of every mesh against the buffer. Prints the triangles drawn,
+// the raster and test times, and the meshes found hidden.
+// Usage: occlusion_culling_bench [model] [min_seconds]
+//   fails if the wall check fails, if the pool fills another buffer than the
+//   calling thread, if the buffer differs from a per-pixel rasterizer in
+//   double precision or is nearer than it beyond a few edge pixels, or if the
+//   tile test disagrees with reading every pixel
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Triangle budget of the occluders, as in scene3d
+constexpr std::size_t kOccluderTriangleBudget = 32768;
+// Pixels allowed to differ from the reference: float edges may move a few
+// pixels whose center is on a triangle's edge, and nothing else
+constexpr std::size_t kMaxMismatchedPixels = OcclusionCuller::kWidth * OcclusionCuller::kHeight / 1000;
+// Guard band of OcclusionCuller, in NDC units
+constexpr double kGuardBand = 64.0;
+
+// Best seconds of one call to run() over calls lasting min_seconds in total
+template <typename Run>
+double BestSeconds(const double min_seconds, Run&& run)
+{
+  double best = std::numeric_limits<double>::infinity();
+  double total = 0.0;
+  do
+  {
+    const auto start = Clock::now();
+    run();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = std::min(best, seconds);
+    total += seconds;
+  } while (total < min_seconds);
+  return best;
+}
+
+struct PlacedOccluder
+{
+  std::span<const glm::vec3> positions;
+  std::span<const unsigned int> indices;
+  glm::mat4 transform;
+};
+
+struct Camera
+{
+  const char* name;
+  glm::vec3 position;
+  glm::vec3 target;
+};
+
+// The same triangles, one pixel at a time in double precision, from their
+// clip-space vertices: window positions, pixel-center coverage and
+// barycentric depth
+std::vector<double> ReferenceDepth(const glm::mat4& view_projection, std::span<const PlacedOccluder> occluders)
+{
+  struct WindowVertex
+  {
+    double x;
+    double y;
+    double z;
+  };
+  std::vector<double> depth(OcclusionCuller::kWidth * OcclusionCuller::kHeight, 1.0);
+  for (const PlacedOccluder& occluder : occluders)
+  {
+    const glm::mat4 clip_from_local = view_projection * occluder.transform;
+    for (std::size_t t = 0; t + 2 < occluder.indices.size(); t += 3)
+    {
+      WindowVertex vertices[3];
+      bool kept = true;
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const glm::vec4 clip = clip_from_local * glm::vec4(occluder.positions[occluder.indices[t + corner]], 1.0f);
+        // Dropped like OcclusionCuller does: behind the near plane or past its guard band
+        const double guard = kGuardBand * static_cast<double>(clip.w);
+        kept = kept && clip.w > 0.0f && clip.z >= -clip.w && std::abs(clip.x) <= guard && std::abs(clip.y) <= guard;
+        const double inverse_w = 1.0 / static_cast<double>(clip.w);
+        vertices[corner] = {(clip.x * inverse_w * 0.5 + 0.5) * OcclusionCuller::kWidth,
+                            (clip.y * inverse_w * 0.5 + 0.5) * OcclusionCuller::kHeight, clip.z * inverse_w * 0.5 + 0.5};
+      }
+      const WindowVertex& a = vertices[0];
+      const WindowVertex& b = vertices[1];
+      const WindowVertex& c = vertices[2];
+      const double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+      if (!kept || area == 0.0)
+      {
+        continue;
+      }
+      const int min_x = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+      const int max_x = std::min(OcclusionCuller::kWidth - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+      const int min_y = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+      const int max_y = std::min(OcclusionCuller::kHeight - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+      for (int y = min_y; y <= max_y; y++)
+      {
+        const double center_y = y + 0.5;
+        for (int x = min_x; x <= max_x; x++)
+        {
+          const double center_x = x + 0.5;
+          // Weights of b and c, then of a; all of the area's sign inside
+          const double weight_b = ((center_x - a.x) * (c.y - a.y) - (center_y - a.y) * (c.x - a.x)) / area;
+          const double weight_c = ((b.x - a.x) * (center_y - a.y) - (b.y - a.y) * (center_x - a.x)) / area;
+          if (weight_b >= 0.0 && weight_c >= 0.0 && weight_b + weight_c <= 1.0)
+          {
+            double& pixel = depth[y * OcclusionCuller::kWidth + x];
+            pixel = std::min(pixel, a.z + weight_b * (b.z - a.z) + weight_c * (c.z - a.z));
+          }
+        }
+      }
+    }
+  }
+  return depth;
+}
+
+// Pixels differing from the reference, and those of them nearer than it
+struct DepthMismatch
+{
+  std::size_t mismatched = 0;
+  std::size_t nearer = 0;
+};
+
+DepthMismatch CompareDepth(std::span<const double> expected, std::span<const float> found)
+{
+  DepthMismatch mismatch;
+  for (std::size_t i = 0; i < expected.size(); i++)
+  {
+    mismatch.mismatched += std::abs(expected[i] - found[i]) > 1e-5;
+    mismatch.nearer += found[i] < expected[i];
+  }
+  return mismatch;
+}
+
+bool CheckDepth(const char* name, const OcclusionCuller& culler, std::span<const PlacedOccluder> occluders)
+{
+  const DepthMismatch mismatch = CompareDepth(ReferenceDepth(culler.view_projection(), occluders), culler.depth());
+  if (mismatch.mismatched > kMaxMismatchedPixels || mismatch.nearer > kMaxMismatchedPixels)
+  {
+    std::fprintf(stderr, "ERROR::OCCLUSION_CULLING_BENCH::RASTER_MISMATCH %s: %zu pixels, %zu nearer\n", name,
+                 mismatch.mismatched, mismatch.nearer);
+    return false;
+  }
+  return true;
+}
+
+// IsRectVisible against reading every pixel of random rectangles
+bool CheckRects(const OcclusionCuller& culler, std::mt19937& random)
+{
+  std::uniform_int_distribution<int> x_coordinate(-8, OcclusionCuller::kWidth + 8);
+  std::uniform_int_distribution<int> y_coordinate(-8, OcclusionCuller::kHeight + 8);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const std::span<const float> depth = culler.depth();
+  for (int i = 0; i < 4096; i++)
+  {
+    int min_x = x_coordinate(random);
+    int max_x = x_coordinate(random);
+    int min_y = y_coordinate(random);
+    int max_y = y_coordinate(random);
+    if (min_x > max_x)
+    {
+      std::swap(min_x, max_x);
+    }
+    if (min_y > max_y)
+    {
+      std::swap(min_y, max_y);
+    }
+    // Near the depths of the scene as well as anywhere
+    const float object_depth = i % 2 == 0 ? unit(random) : depth[random() % depth.size()] + (unit(random) - 0.5f) * 1e-3f;
+    bool expected = max_x < 0 || max_y < 0 || min_x >= OcclusionCuller::kWidth || min_y >= OcclusionCuller::kHeight;
+    for (int y = std::max(min_y, 0); y <= std::min(max_y, OcclusionCuller::kHeight - 1) && !expected; y++)
+    {
+      for (int x = std::max(min_x, 0); x <= std::min(max_x, OcclusionCuller::kWidth - 1) && !expected; x++)
+      {
+        expected = depth[y * OcclusionCuller::kWidth + x] >= object_depth;
+      }
+    }
+    if (culler.IsRectVisible(min_x, min_y, max_x, max_y, object_depth) != expected)
+    {
+      std::fprintf(stderr, "ERROR::OCCLUSION_CULLING_BENCH::RECT_MISMATCH [%d, %d] x [%d, %d] at %f: expected %s\n",
+                   min_x, max_x, min_y, max_y, object_depth, expected ? "visible" : "hidden");
+      return false;
+    }
+  }
+  return true;
+}
+
+// A 20 x 20 wall 20 units ahead of the camera, boxes around it. The wall is
+// drawn as two triangles, then tessellated into triangles of about a pixel,
+// where float depth planes are the least precise.
+int CheckWall(gpr5300::ThreadPool& pool)
+{
+  constexpr int kCells = 80;
+  const std::vector<glm::vec3> quad_positions = {{-10.0f, -10.0f, 0.0f}, {10.0f, -10.0f, 0.0f},
+                                                 {10.0f, 10.0f, 0.0f}, {-10.0f, 10.0f, 0.0f}};
+  const std::vector<unsigned int> quad_indices = {0, 1, 2, 0, 2, 3};
+  std::vector<glm::vec3> grid_positions;
+  std::vector<unsigned int> grid_indices;
+  for (int y = 0; y <= kCells; y++)
+  {
+    for (int x = 0; x <= kCells; x++)
+    {
+      grid_positions.emplace_back(-10.0f + 20.0f * static_cast<float>(x) / kCells,
+                                  -10.0f + 20.0f * static_cast<float>(y) / kCells, 0.0f);
+    }
+  }
+  for (unsigned int y = 0; y < kCells; y++)
+  {
+    for (unsigned int x = 0; x < kCells; x++)
+    {
+      const unsigned int corner = y * (kCells + 1) + x;
+      grid_indices.insert(grid_indices.end(), {corner, corner + 1, corner + kCells + 2, corner, corner + kCells + 2,
+                                               corner + kCells + 1});
+    }
+  }
+  const glm::mat4 wall = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -20.0f));
+  const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+  const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+  struct WallCase
+  {
+    const char* name;
+    glm::vec3 center;
+    float half_size;
+    bool visible;
+  };
+  const WallCase cases[] = {
+      {"behind", {0.0f, 0.0f, -30.0f}, 1.0f, false},
+      {"far behind, wide", {0.0f, 0.0f, -60.0f}, 15.0f, false},
+      {"behind, inside the edge", {10.0f, 0.0f, -40.0f}, 1.0f, false},
+      {"just behind", {0.0f, 0.0f, -20.05f}, 0.02f, false},
+      {"in front", {0.0f, 0.0f, -10.0f}, 1.0f, true},
+      {"just in front", {0.0f, 0.0f, -19.95f}, 0.02f, true},
+      {"just in front, off center", {3.1f, -2.7f, -19.95f}, 0.02f, true},
+      {"just in front, near a corner", {-8.3f, 7.4f, -19.95f}, 0.02f, true},
+      {"through the wall", {0.0f, 0.0f, -20.0f}, 1.0f, true},
+      {"behind, past the edge", {30.0f, 0.0f, -30.0f}, 1.0f, true},
+      {"behind, across the edge", {20.0f, 0.0f, -40.0f}, 3.0f, true},
+      {"across the near plane", {0.0f, 0.0f, 0.0f}, 1.0f, true},
+      {"behind the camera", {0.0f, 0.0f, 30.0f}, 1.0f, true},
+  };
+  const std::pair<const char*, PlacedOccluder> walls[] = {
+      {"wall", {quad_positions, quad_indices, wall}},
+      {"tessellated wall", {grid_positions, grid_indices, wall}},
+  };
+
+  int status = EXIT_SUCCESS;
+  for (const auto& [wall_name, placed] : walls)
+  {
+    OcclusionCuller culler;
+    const std::uint32_t occluder = culler.AddOccluder(placed.positions, placed.indices);
+    for (gpr5300::ThreadPool* const rasterize_pool : {static_cast<gpr5300::ThreadPool*>(nullptr), &pool})
+    {
+      culler.Begin(projection * view);
+      culler.Add(occluder, placed.transform);
+      culler.Rasterize(rasterize_pool);
+      if (!CheckDepth(wall_name, culler, std::span(&placed, 1)))
+      {
+        status = EXIT_FAILURE;
+      }
+      for (const WallCase& wall_case : cases)
+      {
+        const bool box_visible = culler.IsBoxVisible(wall_case.center - glm::vec3(wall_case.half_size),
+                                                     wall_case.center + glm::vec3(wall_case.half_size));
+        const bool sphere_visible = culler.IsSphereVisible({wall_case.center, wall_case.half_size});
+        if (box_visible != wall_case.visible || sphere_visible != wall_case.visible)
+        {
+          std::fprintf(stderr, "ERROR::OCCLUSION_CULLING_BENCH::WALL %s, %s: box %s, sphere %s, expected %s\n",
+                       wall_name, wall_case.name, box_visible ? "visible" : "hidden",
+                       sphere_visible ? "visible" : "hidden", wall_case.visible ? "visible" : "hidden");
+          status = EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  std::printf("wall: %zu cases on %zu walls %s\n", std::size(cases), std::size(walls),
+              status == EXIT_SUCCESS ? "ok" : "FAILED");
+  return status;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string path = argc > 1 ? argv[1] : "data/roman_baths/scene.gltf";
+  const double min_seconds = argc > 2 ? std::max(0.01, std::atof(argv[2])) : 0.25;
+
+  gpr5300::ThreadPool& pool = gpr5300::ThreadPool::Default();
+  std::printf("occlusion culling, %s, %d x %d, %zu workers + caller\n", OcclusionCullingIsa(),
+              OcclusionCuller::kWidth, OcclusionCuller::kHeight, pool.worker_count());
+  int status = CheckWall(pool);
+
+  // The meshes scene3d would draw: optimized and split like at import
+  std::vector<MeshData> meshes;
+  if (!Model::ImportWithAssimp(path, meshes))
+  {
+    return EXIT_FAILURE;
+  }
+  std::vector<std::vector<glm::vec3>> positions(meshes.size());
+  std::vector<BoundingBox> boxes(meshes.size());
+  BoundingBox model_box;
+  for (std::size_t i = 0; i < meshes.size(); i++)
+  {
+    for (const Vertex& vertex : meshes[i].vertices)
+    {
+      positions[i].push_back(vertex.Position);
+    }
+    boxes[i] = {meshes[i].aabb_min, meshes[i].aabb_max};
+    model_box.min = glm::min(model_box.min, meshes[i].aabb_min);
+    model_box.max = glm::max(model_box.max, meshes[i].aabb_max);
+  }
+
+  // Largest meshes first, within the triangle budget
+  std::vector<std::size_t> by_size(meshes.size());
+  std::iota(by_size.begin(), by_size.end(), std::size_t{0});
+  std::stable_sort(by_size.begin(), by_size.end(), [&](const std::size_t a, const std::size_t b) {
+    return meshes[a].bounding_sphere.radius > meshes[b].bounding_sphere.radius;
+  });
+  OcclusionCuller culler;
+  std::vector<PlacedOccluder> placed;
+  std::vector<std::uint32_t> occluder_ids;
+  std::size_t occluder_triangles = 0;
+  for (const std::size_t i : by_size)
+  {
+    const std::size_t triangles = meshes[i].indices.size() / 3;
+    if (occluder_triangles + triangles > kOccluderTriangleBudget)
+    {
+      continue;
+    }
+    occluder_ids.push_back(culler.AddOccluder(positions[i], meshes[i].indices));
+    placed.push_back({positions[i], meshes[i].indices, glm::mat4(1.0f)});
+    occluder_triangles += triangles;
+  }
+  std::printf("%s: %zu meshes, %zu occluders, %zu triangles\n", path.c_str(), meshes.size(), placed.size(),
+              occluder_triangles);
+
+  const glm::vec3 center = (model_box.min + model_box.max) * 0.5f;
+  const glm::vec3 extent = model_box.max - model_box.min;
+  const float far_plane = 4.0f * glm::length(extent);
+  const Camera cameras[] = {
+      {"center, level", center, center + glm::vec3(1.0f, 0.0f, 0.0f)},
+      {"center, turned", center, center + glm::vec3(0.0f, 0.0f, 1.0f)},
+      {"above, down", center + glm::vec3(0.0f, extent.y * 2.0f, 0.01f), center},
+      {"outside, across", center + glm::vec3(-extent.x, extent.y * 0.25f, -extent.z), center},
+  };
+  std::mt19937 random(15678);
+  std::vector<float> serial_depth;
+  std::printf("  %-16s %10s %10s %10s %10s %14s\n", "camera", "drawn", "caller ms", "pool ms", "tests us", "hidden");
+  for (const Camera& camera : cameras)
+  {
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, far_plane);
+    const glm::mat4 view = glm::lookAt(camera.position, camera.target, glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 view_projection = projection * view;
+    culler.Begin(view_projection);
+    for (const std::uint32_t id : occluder_ids)
+    {
+      culler.Add(id, glm::mat4(1.0f));
+    }
+
+    const double serial = BestSeconds(min_seconds, [&]() { culler.Rasterize(); });
+    serial_depth.assign(culler.depth().begin(), culler.depth().end());
+    const double parallel = BestSeconds(min_seconds, [&]() { culler.Rasterize(&pool); });
+    if (!std::equal(serial_depth.begin(), serial_depth.end(), culler.depth().begin()))
+    {
+      std::fprintf(stderr, "ERROR::OCCLUSION_CULLING_BENCH::POOL_MISMATCH %s\n", camera.name);
+      status = EXIT_FAILURE;
+    }
+    if (!CheckDepth(camera.name, culler, placed))
+    {
+      status = EXIT_FAILURE;
+    }
+    if (!CheckRects(culler, random))
+    {
+      status = EXIT_FAILURE;
+    }
+
+    std::size_t hidden = 0;
+    const double tests = BestSeconds(min_seconds, [&]() {
+      hidden = 0;
+      for (const BoundingBox& box : boxes)
+      {
+        hidden += !culler.IsBoxVisible(box.min, box.max);
+      }
+    });
+    std::printf("  %-16s %10zu %10.3f %10.3f %10.1f %7zu / %zu\n", camera.name, culler.drawn_triangle_count(),
+                serial * 1e3, parallel * 1e3, tests * 1e6, hidden, boxes.size());
+  }
+  return status;
+}
@@ -1,6 +1,7 @@
 ﻿#include <fstream>
 #include <map>
 #include <array>
+#include <chrono>
 #include <imgui.h>
 #include <iostream>
 #include <sstream>
@@ -9,16 +10,29 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "allocation_tracker.h"
+#include "bvh.h"
 #include "engine.h"
 #include "file_utility.h"
+#include "frame_arena.h"
+#include "frame_uniforms.h"
 #include "free_camera.h"
 #include "global_utility.h"
+#include "indirect_renderer.h"
+#include "instance_culling.h"
+#include "mesh_lod.h"
 #include "model.h"
+#include "occlusion_culling.h"
 #include "scene3d.h"
 #include "shader.h"
+#include "stream_buffer.h"
 #include <numbers>
+#include <numeric>
 #include <random>
 #include "texture_loader.h"
+#include "texture_registry.h"
+#include "texture_uploader.h"
+#include "thread_pool.h"
 
 
 #ifdef TRACY_ENABLE
@@ -39,8 +53,29 @@ class Scene3D final : public Scene
   void OnEvent(const SDL_Event& event) override;
   void DrawImGui() override;
   void UpdateCamera(const float dt) override;
+  // Plus aucun chargement en cours : les frames ne doivent plus allouer
+  [[nodiscard]] bool IsSteadyState() const override;
 
  private:
+  // Envoie au GPU ce que les threads de chargement ont terminé depuis la dernière frame
+  void UpdateLoading();
+  // Fait tourner l'anneau, choisit un niveau de détail par astéroïde et écrit leurs
+  // matrices, triées par niveau, dans le StreamBuffer de la frame
+  void UpdateInstanceLods(const LodSelector& selector, float dt);
+  // Un glDrawElementsInstanced par niveau de détail utilisé
+  void DrawInstances(const Mesh& mesh) const;
+  // Met à jour le BVH des meshes de model_ et model_2_ placés par model et model2
+  // (reconstruit après un chargement, réajusté si un modèle bouge) et garde ceux
+  // qui touchent le frustum
+  void UpdateSceneBvh(const glm::mat4& model, const glm::mat4& model2);
+  // Prend comme occulteurs les plus gros meshes de la scène, dans la limite de
+  // kOccluderTriangleBudget triangles (après chaque changement de la liste des meshes)
+  void SelectOccluders();
+  // Rastérise les occulteurs dans le frustum et retire de visible_meshes_ les meshes
+  // qu'ils cachent
+  void UpdateOcclusion(const glm::mat4& view_projection);
+  // Tampon de profondeur de l'occlusion en niveaux de gris dans occlusion_texture_
+  void UpdateOcclusionTexture();
 
   static constexpr float Lerp(float f) {
     return 0.1f + f * (1.0f - 0.1f);
@@ -67,6 +102,13 @@ class Scene3D final : public Scene
   Shader lighting_shader_ = {};
   Shader ssao_shader_ = {};
   Shader ssao_blur_shader_ = {};
+  // Uniformes mis à jour plusieurs fois par frame, résolus une fois dans Begin
+  Uniform<glm::mat4> geometry_model_;
+  Uniform<glm::vec3> ssao_samples_;
+  Uniform<glm::mat4> light_model_;
+  // Blocs FrameData et LightData partagés par tous les shaders
+  FrameUniforms frame_uniforms_;
+  Uniform<glm::vec3> light_color_;
 
 
 
@@ -95,6 +137,38 @@ class Scene3D final : public Scene
   Shader shader_model_ = {};
   Model model_;
   Model model_2_;
+  // Les deux modèles en un glMultiDrawElementsIndirect par matériau
+  Shader shader_model_indirect_ = {};
+  IndirectRenderer indirect_renderer_;
+  bool indirect_state_ = true;
+  // Culling des meshlets hors du frustum ou tournés vers l'arrière (chemin indirect)
+  bool meshlet_culling_state_ = true;
+  std::size_t model_draw_calls_ = 0;
+  // BVH de scène, une entrée par mesh des deux modèles : le chemin indirect ne
+  // soumet que les meshes gardés par QueryFrustum puis par l'occlusion
+  struct SceneMesh {
+    const Mesh* mesh;
+    glm::mat4 transform;
+  };
+  std::vector<SceneMesh> scene_meshes_;
+  std::vector<BoundingBox> scene_mesh_boxes_;
+  std::vector<std::uint32_t> visible_meshes_;
+  std::size_t visible_mesh_count_ = 0;
+  Bvh scene_bvh_;
+  std::size_t scene_bvh_builds_ = 0;
+  // Occlusion culling : les plus gros meshes des deux modèles, rastérisés sur le CPU
+  // dans un petit tampon de profondeur, cachent meshes et astéroïdes avant tout envoi à GL
+  static constexpr std::size_t kOccluderTriangleBudget = 32768;
+  static constexpr std::uint8_t kOccludedInstance = 0xFF;
+  OcclusionCuller occlusion_culler_;
+  std::vector<std::uint32_t> scene_mesh_occluders_; // Par mesh de scène, kNoOccluder sinon
+  bool occlusion_state_ = true;
+  bool occlusion_overlay_ = false;
+  std::size_t occluded_mesh_count_ = 0;
+  std::size_t occluded_instance_count_ = 0;
+  float occlusion_us_ = 0.0f;
+  GLuint occlusion_texture_ = 0;
+  std::array<std::uint8_t, OcclusionCuller::kWidth * OcclusionCuller::kHeight> occlusion_pixels_ = {};
 
   //skybox
   Shader skybox_program_ = {};
@@ -102,7 +176,9 @@ class Scene3D final : public Scene
   GLuint skybox_vao_ = 0;
   GLuint skybox_vbo_ = 0;
 
-  unsigned int skybox_texture_ = -1;
+  unsigned int skybox_texture_ = 0;
+  // Faces du skybox décodées sur un thread de chargement, envoyées au GPU dès qu'elles sont prêtes
+  std::future<std::vector<Image>> skybox_faces_;
 
   float skybox_vertices_[108] = {};
 
@@ -129,14 +205,33 @@ class Scene3D final : public Scene
 
   Shader Instancing_shader_;
 
-  unsigned int Instancing_buffer_;
+  // Matrices de départ ; l'anneau tourne autour de l'axe Y de ring_angle_ radians
   glm::mat4* modelMatrices {};
+  float ring_angle_ = 0.0f;
+  float ring_speed_ = 0.05f; // rad/s
   Model Instancing_Model_;
+  // Format instancié de GeometryArena : sommets partagés + une matrice par instance lue
+  // dans le StreamBuffer, un VAO par format de sommet
+  unsigned int instancing_vaos_[kVertexFormatCount] = {};
   unsigned int Instancing_amout;
+  // Matrices de la frame, dans l'ordre de modelMatrices
+  std::vector<glm::mat4> instance_matrices_;
+  // Dans le StreamBuffer, les matrices sont regroupées par niveau de détail : le niveau l
+  // occupe les instances [instance_lod_offsets_[l], instance_lod_offsets_[l] + instance_lod_counts_[l])
+  // à partir de instance_base_
+  GLuint instance_base_ = 0;
+  // Instances dans le frustum à cette frame
+  InstanceCuller instance_culler_;
+  float instance_cull_us_ = 0.0f;
+  std::vector<std::uint8_t> instance_lods_;
+  std::array<GLuint, kMaxMeshLods> instance_lod_offsets_ = {};
+  std::array<GLuint, kMaxMeshLods> instance_lod_counts_ = {};
+  // Erreur de simplification tolérée à l'écran, en pixels
+  float lod_pixel_error_ = 1.0f;
   Shader Normal_Map;
 
-  unsigned int ground_text_ = 0;
-  unsigned int ground_text_normal_ = 0;
+  AsyncTexture ground_text_;
+  AsyncTexture ground_text_normal_;
 
 
   glm::vec3 lightPos0 = glm::vec3(0.0f, 0.5f, 10.5f);
@@ -178,19 +273,44 @@ void Scene3D::Begin()
   shader_blur_ = Shader("data/shaders/bloom/blur.vert", "data/shaders/bloom/blur.frag");
   shader_bloom_final_ = Shader("data/shaders/bloom/bloom_final.vert", "data/shaders/bloom/bloom_final.frag");
   shader_model_ = Shader("data/shaders/scene3d/model.vert", "data/shaders/scene3d/model.frag");
+  shader_model_indirect_ = Shader("data/shaders/scene3d/model_indirect.vert", "data/shaders/scene3d/model_indirect.frag");
   skybox_program_ = Shader("data/shaders/scene3d/cubemaps.vert", "data/shaders/scene3d/cubemaps.frag");
   geometry_shader_ = Shader("data/shaders/ssao/geometry_pass.vert","data/shaders/ssao/geometry_pass.frag");
   lighting_shader_ = Shader("data/shaders/ssao/lightning_pass.vert","data/shaders/ssao/lightning_pass.frag");
   ssao_shader_ = Shader("data/shaders/ssao/ssao.vert","data/shaders/ssao/ssao.frag");
   ssao_blur_shader_ = Shader("data/shaders/ssao/ssao_blur.vert","data/shaders/ssao/ssao_blur.frag");
-
-
-  model_ = Model("data/15/scene.gltf");
-  model_2_ = Model("data/17/scene.gltf");
-  Instancing_Model_ = Model("data/14/scene.gltf");
-
-  ground_text_ = TextureFromFile("brickwall.jpg", "data/textures");
-  ground_text_normal_ = TextureFromFile("brickwall_normal.jpg", "data/textures");
+  geometry_model_ = geometry_shader_.GetUniform<glm::mat4>("model");
+  ssao_samples_ = ssao_shader_.GetUniform<glm::vec3>("samples");
+  light_model_ = shader_light_.GetUniform<glm::mat4>("model");
+  indirect_renderer_.Create();
+  light_color_ = shader_light_.GetUniform<glm::vec3>("lightColor");
+
+
+  // Les modèles et textures sont chargés en arrière-plan : la scène s'affiche tout de suite
+  // et se complète au fil des frames (voir UpdateLoading)
+  // Sommets compactés (20 octets au lieu de 44) : l'anneau d'astéroïdes est limité par la lecture des sommets
+  model_.set_vertex_format(VertexFormat::kPacked);
+  model_2_.set_vertex_format(VertexFormat::kPacked);
+  Instancing_Model_.set_vertex_format(VertexFormat::kPacked);
+  // Les astéroïdes libèrent leurs sommets après l'upload. model_ et model_2_ gardent
+  // leur copie CPU le temps du chargement, pour SelectOccluders (voir UpdateSceneBvh)
+  Instancing_Model_.set_keep_cpu_data(false);
+  model_.LoadAsync("data/15/scene.gltf");
+  model_2_.LoadAsync("data/17/scene.gltf");
+  Instancing_Model_.LoadAsync("data/14/scene.gltf");
+
+  ground_text_.Load("data/textures/brickwall.jpg");
+  ground_text_normal_.Load("data/textures/brickwall_normal.jpg");
+
+  // Aperçu du tampon d'occlusion dans ImGui : un canal, affiché en gris
+  glGenTextures(1, &occlusion_texture_);
+  glBindTexture(GL_TEXTURE_2D, occlusion_texture_);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, OcclusionCuller::kWidth, OcclusionCuller::kHeight, 0, GL_RED,
+               GL_UNSIGNED_BYTE, nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  const GLint occlusion_swizzle[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+  glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, occlusion_swizzle);
 
   //Configure FBO
   glGenFramebuffers(1, &hdr_fbo_);
@@ -360,7 +480,7 @@ void Scene3D::Begin()
     std::uniform_real_distribution<GLfloat> random_floats(0.0, 1.0); // generates random floats between 0.0 and 1.0
     std::default_random_engine generator;
 
-    ssao_kernel_.resize(kKernelSize);
+    ssao_kernel_.reserve(kKernelSize);
     for (std::int32_t i = 0; i < kKernelSize; ++i) {
       glm::vec3 sample(random_floats(generator) * 2.0 - 1.0, random_floats(generator) * 2.0 - 1.0,
                        random_floats(generator));
@@ -394,17 +514,17 @@ void Scene3D::Begin()
 
     // shader configuration
     // --------------------
-    glUseProgram(lighting_shader_.id_);
-    glUniform1i(glGetUniformLocation(lighting_shader_.id_, "gPosition"), 0);
-    glUniform1i(glGetUniformLocation(lighting_shader_.id_, "gNormal"), 1);
-    glUniform1i(glGetUniformLocation(lighting_shader_.id_, "gAlbedo"), 2);
-    glUniform1i(glGetUniformLocation(lighting_shader_.id_, "ssao"), 3);
-    glUseProgram(ssao_shader_.id_);
-    glUniform1i(glGetUniformLocation(ssao_shader_.id_, "gPosition"), 0);
-    glUniform1i(glGetUniformLocation(ssao_shader_.id_, "gNormal"), 1);
-    glUniform1i(glGetUniformLocation(ssao_shader_.id_, "texNoise"), 2);
-    glUseProgram(ssao_blur_shader_.id_);
-    glUniform1i(glGetUniformLocation(ssao_blur_shader_.id_, "ssaoInput"), 0);
+    lighting_shader_.Use();
+    lighting_shader_.SetInt("gPosition", 0);
+    lighting_shader_.SetInt("gNormal", 1);
+    lighting_shader_.SetInt("gAlbedo", 2);
+    lighting_shader_.SetInt("ssao", 3);
+    ssao_shader_.Use();
+    ssao_shader_.SetInt("gPosition", 0);
+    ssao_shader_.SetInt("gNormal", 1);
+    ssao_shader_.SetInt("texNoise", 2);
+    ssao_blur_shader_.Use();
+    ssao_blur_shader_.SetInt("ssaoInput", 0);
 
 
 
@@ -413,30 +533,13 @@ void Scene3D::Begin()
 
 
 
-  glGenBuffers(1, &Instancing_buffer_);
-  glBindBuffer(GL_ARRAY_BUFFER, Instancing_buffer_);
-  glBufferData(GL_ARRAY_BUFFER, Instancing_amout * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-  for(unsigned int i = 0; i < Instancing_Model_.meshes().size(); i++)
-  {
-    unsigned int VAO = Instancing_Model_.meshes()[i].VAO();
-    glBindVertexArray(VAO);
-    // vertex attributes
-    std::size_t vec4Size = sizeof(glm::vec4);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)0);
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(1 * vec4Size));
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(2 * vec4Size));
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(3 * vec4Size));
-
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-    glVertexAttribDivisor(6, 1);
-
-    glBindVertexArray(0);
+  instance_matrices_.resize(Instancing_amout);
+  instance_lods_.resize(Instancing_amout);
+  // Les matrices sont réécrites à chaque frame dans le StreamBuffer (UpdateInstanceLods) ;
+  // le VAO le lit depuis le début et baseInstance saute jusqu'à la tranche de la frame
+  for (std::size_t i = 0; i < kVertexFormatCount; i++) {
+    instancing_vaos_[i] = GeometryArena::Default().CreateInstancedVao(StreamBuffer::Default().buffer(),
+                                                                      static_cast<VertexFormat>(i));
   }
 
   static constexpr std::array skyboxVertices {
@@ -497,17 +600,18 @@ void Scene3D::Begin()
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
 
-  std::vector<std::string_view> faces
-      {
-          "data/cubemaps/right.jpg",
-          "data/cubemaps/left.jpg",
-          "data/cubemaps/top.jpg",
-          "data/cubemaps/bottom.jpg",
-          "data/cubemaps/front.jpg",
-          "data/cubemaps/back.jpg"
-      };
-
-  skybox_texture_ = GenerateCubemap(faces);
+  skybox_faces_ = ThreadPool::Default().Submit([] {
+    const std::array<std::string, 6> faces
+        {
+            "data/cubemaps/right.jpg",
+            "data/cubemaps/left.jpg",
+            "data/cubemaps/top.jpg",
+            "data/cubemaps/bottom.jpg",
+            "data/cubemaps/front.jpg",
+            "data/cubemaps/back.jpg"
+        };
+    return DecodeImages(faces, STBI_rgb);
+  });
 
 
 
@@ -547,6 +651,7 @@ void Scene3D::End()
   Instancing_shader_.Delete();
   Normal_Map.Delete();
   shader_model_.Delete();
+  shader_model_indirect_.Delete();
   geometry_shader_.Delete();
   lighting_shader_.Delete();
   ssao_shader_.Delete();
@@ -568,15 +673,24 @@ void Scene3D::End()
   glDeleteTextures(1, &ssao_color_buffer_);
   glDeleteTextures(1, &ssao_color_buffer_blur_);
   glDeleteTextures(2, pingpong_color_buffer_);
+  TextureUploader::Default().Cancel(skybox_texture_);
   glDeleteTextures(1, &skybox_texture_);
-  glDeleteTextures(1, &ground_text_);
-  glDeleteTextures(1, &ground_text_normal_);
+  glDeleteTextures(1, &occlusion_texture_);
+  ground_text_.Delete();
+  ground_text_normal_.Delete();
+  indirect_renderer_.Delete();
+  // Rend les références du registre de textures tant que le contexte GL existe
+  model_ = Model();
+  model_2_ = Model();
+  Instancing_Model_ = Model();
 
 
   glDeleteRenderbuffers(1, &rbo_depth_);
 
 
-  glDeleteBuffers(1, &Instancing_buffer_);
+  for (const unsigned int vao : instancing_vaos_) {
+    GeometryArena::Default().DeleteVao(vao);
+  }
 
 
   glDeleteVertexArrays(1, &skybox_vao_);
@@ -593,6 +707,228 @@ void Scene3D::End()
 
 }
 
+bool Scene3D::IsSteadyState() const
+{
+  return !model_.loading() && !model_2_.loading() && !Instancing_Model_.loading() && ground_text_.resident() &&
+         ground_text_normal_.resident() && skybox_texture_ != 0 && TextureUploader::Default().idle();
+}
+
+void Scene3D::UpdateLoading()
+{
+  model_.UpdateAsyncLoad();
+  model_2_.UpdateAsyncLoad();
+  Instancing_Model_.UpdateAsyncLoad();
+  ground_text_.Update();
+  ground_text_normal_.Update();
+
+  if (skybox_faces_.valid() && skybox_faces_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+  {
+    std::vector<Image> faces = skybox_faces_.get();
+    for (const Image& face : faces)
+    {
+      if (!face.valid())
+        std::cout << "Cubemap texture failed to load" << std::endl;
+    }
+    skybox_texture_ = TextureUploader::Default().EnqueueCubemap(std::move(faces));
+  }
+
+  // Au plus TextureUploader::frame_budget() octets de pixels copiés par frame
+  TextureUploader::Default().Flush();
+}
+
+void Scene3D::UpdateInstanceLods(const LodSelector& selector, const float dt)
+{
+  ring_angle_ = std::fmod(ring_angle_ + ring_speed_ * dt, 2.0f * std::numbers::pi_v<float>);
+  const glm::mat4 ring_rotation = glm::rotate(glm::mat4(1.0f), ring_angle_, glm::vec3(0.0f, 1.0f, 0.0f));
+  for (unsigned int i = 0; i < Instancing_amout; i++) {
+    instance_matrices_[i] = ring_rotation * modelMatrices[i];
+  }
+
+  // Culling des astéroïdes : sphère du modèle (calculée à l'import) placée par instance,
+  // testée par lots SIMD, réparti sur les threads du pool
+  const auto cull_start = std::chrono::steady_clock::now();
+  const std::span<const std::uint32_t> visible = instance_culler_.Cull(
+      frustum_, instance_matrices_, Instancing_Model_.bounding_sphere(), &gpr5300::ThreadPool::Default());
+  instance_cull_us_ =
+      std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - cull_start).count();
+
+  // Un seul niveau pour tous les meshes d'un astéroïde, choisi sur l'erreur du pire d'entre eux
+  const std::array<float, kMaxMeshLods> errors = Instancing_Model_.lod_errors();
+  const std::span<const float> lod_errors(errors.data(), Instancing_Model_.lod_count());
+  glm::vec3 aabb_min;
+  glm::vec3 aabb_max;
+  Instancing_Model_.GetBoundingBox(aabb_min, aabb_max);
+
+  // Tri par comptage : histogramme, décalages, puis placement. Les astéroïdes cachés
+  // par un occulteur sont marqués kOccludedInstance et ne sont pas placés
+  instance_lod_counts_.fill(0);
+  occluded_instance_count_ = 0;
+  for (const std::uint32_t i : visible) {
+    if (occlusion_state_ &&
+        !occlusion_culler_.IsSphereVisible(TransformSphere(instance_matrices_[i], Instancing_Model_.bounding_sphere()))) {
+      instance_lods_[i] = kOccludedInstance;
+      occluded_instance_count_++;
+      continue;
+    }
+    instance_lods_[i] = static_cast<std::uint8_t>(
+        selector.Select(lod_errors, instance_matrices_[i], aabb_min, aabb_max, camera_.camera_position_));
+    instance_lod_counts_[instance_lods_[i]]++;
+  }
+  GLuint first = 0;
+  for (std::size_t lod = 0; lod < kMaxMeshLods; lod++) {
+    instance_lod_offsets_[lod] = first;
+    first += instance_lod_counts_[lod];
+  }
+
+  // Placement direct dans la mémoire mappée : aucune copie par le pilote. Alignée sur une
+  // matrice pour que la tranche commence sur un numéro d'instance entier
+  const StreamBuffer::Slice<glm::mat4> slice =
+      StreamBuffer::Default().Allocate<glm::mat4>(first, sizeof(glm::mat4));
+  if (!slice) {
+    instance_lod_counts_.fill(0);
+    return;
+  }
+  instance_base_ = static_cast<GLuint>(slice.offset / sizeof(glm::mat4));
+  std::array<GLuint, kMaxMeshLods> cursors = instance_lod_offsets_;
+  for (const std::uint32_t i : visible) {
+    if (instance_lods_[i] != kOccludedInstance)
+      slice.data[cursors[instance_lods_[i]]++] = instance_matrices_[i];
+  }
+}
+
+void Scene3D::UpdateSceneBvh(const glm::mat4& model, const glm::mat4& model2)
+{
+  const std::array<const Model*, 2> sources = {&model_, &model_2_};
+  const std::array<glm::mat4, 2> transforms = {model, model2};
+
+  // Les meshes ne changent qu'à la fin d'un chargement
+  std::size_t count = 0;
+  bool rebuild = false;
+  for (const Model* source : sources) {
+    for (const Mesh& mesh : source->meshes()) {
+      rebuild = rebuild || count >= scene_meshes_.size() || scene_meshes_[count].mesh != &mesh;
+      count++;
+    }
+  }
+  rebuild = rebuild || count != scene_meshes_.size();
+  if (rebuild) {
+    scene_meshes_.clear();
+    scene_mesh_boxes_.clear();
+  }
+
+  std::uint32_t item = 0;
+  for (std::size_t s = 0; s < sources.size(); s++) {
+    for (const Mesh& mesh : sources[s]->meshes()) {
+      BoundingBox box;
+      TransformAabb(transforms[s], mesh.aabb_min_, mesh.aabb_max_, box.min, box.max);
+      if (rebuild) {
+        scene_meshes_.push_back({&mesh, transforms[s]});
+        scene_mesh_boxes_.push_back(box);
+      } else if (scene_meshes_[item].transform != transforms[s]) {
+        scene_meshes_[item].transform = transforms[s];
+        scene_mesh_boxes_[item] = box;
+        scene_bvh_.Update(item, box);
+      }
+      item++;
+    }
+  }
+  if (rebuild)
+    SelectOccluders();
+  // Les occulteurs sont copiés et la liste des meshes ne change plus une fois les
+  // deux modèles chargés : plus rien ne relit leurs sommets côté CPU
+  if (model_.keep_cpu_data() && !model_.loading() && !model_2_.loading()) {
+    model_.ReleaseCpuData();
+    model_2_.ReleaseCpuData();
+  }
+
+  // Un réajustement garde la forme de l'arbre : reconstruit s'il s'est trop dégradé
+  if (rebuild || (scene_bvh_.Refit() > 0 && scene_bvh_.SahCost() > 2.0f * scene_bvh_.build_cost())) {
+    scene_bvh_.Build(scene_mesh_boxes_);
+    visible_meshes_.resize(scene_mesh_boxes_.size());
+    scene_bvh_builds_++;
+  }
+  visible_mesh_count_ = scene_bvh_.QueryFrustum(frustum_, visible_meshes_);
+}
+
+void Scene3D::SelectOccluders()
+{
+  occlusion_culler_.ClearOccluders();
+  scene_mesh_occluders_.assign(scene_meshes_.size(), OcclusionCuller::kNoOccluder);
+
+  // Les plus gros d'abord, sur le rayon de leur sphère placée dans la scène
+  std::vector<std::uint32_t> by_size(scene_meshes_.size());
+  std::iota(by_size.begin(), by_size.end(), 0u);
+  const auto world_radius = [this](const std::uint32_t i) {
+    return scene_meshes_[i].mesh->bounding_sphere().radius * MaxScale(scene_meshes_[i].transform);
+  };
+  std::stable_sort(by_size.begin(), by_size.end(),
+                   [&](const std::uint32_t a, const std::uint32_t b) { return world_radius(a) > world_radius(b); });
+  std::size_t triangles = 0;
+  for (const std::uint32_t i : by_size) {
+    const Mesh& mesh = *scene_meshes_[i].mesh;
+    const std::size_t mesh_triangles = mesh.indices().size() / 3;
+    if (triangles + mesh_triangles > kOccluderTriangleBudget)
+      continue;
+    scene_mesh_occluders_[i] = occlusion_culler_.AddOccluder(mesh);
+    if (scene_mesh_occluders_[i] != OcclusionCuller::kNoOccluder)
+      triangles += mesh_triangles;
+  }
+}
+
+void Scene3D::UpdateOcclusion(const glm::mat4& view_projection)
+{
+  occluded_mesh_count_ = 0;
+  if (!occlusion_state_)
+    return;
+  const auto start = std::chrono::steady_clock::now();
+
+  // Un occulteur hors du frustum ne cache rien de ce qui y est
+  occlusion_culler_.Begin(view_projection);
+  const std::span<const std::uint32_t> visible(visible_meshes_.data(), visible_mesh_count_);
+  for (const std::uint32_t i : visible) {
+    if (scene_mesh_occluders_[i] != OcclusionCuller::kNoOccluder)
+      occlusion_culler_.Add(scene_mesh_occluders_[i], scene_meshes_[i].transform);
+  }
+  occlusion_culler_.Rasterize(&gpr5300::ThreadPool::Default());
+
+  // Compactage sur place ; un occulteur n'est jamais plus loin que sa propre profondeur
+  std::size_t kept = 0;
+  for (const std::uint32_t i : visible) {
+    if (occlusion_culler_.IsBoxVisible(scene_mesh_boxes_[i].min, scene_mesh_boxes_[i].max))
+      visible_meshes_[kept++] = i;
+  }
+  occluded_mesh_count_ = visible_mesh_count_ - kept;
+  visible_mesh_count_ = kept;
+  occlusion_us_ = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Scene3D::UpdateOcclusionTexture()
+{
+  // Distance à la caméra, du blanc (proche) au noir (kRange et au-delà, ou aucun occulteur)
+  constexpr float kRange = 100.0f;
+  const std::span<const float> depth = occlusion_culler_.depth();
+  for (std::size_t i = 0; i < depth.size(); i++) {
+    const float ndc = depth[i] * 2.0f - 1.0f;
+    const float distance = 2.0f * zNear * zFar / (zFar + zNear - ndc * (zFar - zNear));
+    occlusion_pixels_[i] = static_cast<std::uint8_t>(255.0f * (1.0f - std::min(distance / kRange, 1.0f)));
+  }
+  glBindTexture(GL_TEXTURE_2D, occlusion_texture_);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, OcclusionCuller::kWidth, OcclusionCuller::kHeight, GL_RED,
+                  GL_UNSIGNED_BYTE, occlusion_pixels_.data());
+}
+
+void Scene3D::DrawInstances(const Mesh& mesh) const
+{
+  glBindVertexArray(instancing_vaos_[static_cast<std::size_t>(mesh.vertex_format())]);
+  for (std::size_t lod = 0; lod < kMaxMeshLods; lod++) {
+    if (instance_lod_counts_[lod] == 0)
+      continue;
+    // Un mesh avec moins de niveaux que le modèle reste à son plus grossier
+    mesh.DrawElementsInstanced(static_cast<GLsizei>(instance_lod_counts_[lod]), std::min(lod, mesh.lod_count() - 1),
+                               instance_base_ + instance_lod_offsets_[lod]);
+  }
+}
+
 void Scene3D::Update(const float dt) {
 #ifdef TRACY_ENABLE
   TracyCZoneN(const Update, "Update", true)
@@ -614,6 +950,7 @@ void Scene3D::Update(const float dt) {
 
 
   UpdateCamera(dt);
+  UpdateLoading();
   elapsedTime_ += dt;
 
 
@@ -629,6 +966,10 @@ void Scene3D::Update(const float dt) {
   auto view = camera_.view();
   auto model = glm::mat4(1.0f);
 
+  // Caméra et lumières envoyées une seule fois pour tous les shaders (data/shaders/common/uniforms.glsl)
+  frame_uniforms_.Update(FrameUniforms::MakeFrameData(view, projection, camera_.camera_position_, elapsedTime_),
+                         FrameUniforms::MakeLightData(light_positions_, light_colors_));
+
 
   glActiveTexture(GL_TEXTURE0);
 
@@ -638,16 +979,13 @@ void Scene3D::Update(const float dt) {
 
   skybox_program_.Use();
 
-
-  glm::mat4 viewS = glm::mat4(glm::mat3(view));
-  skybox_program_.SetMat4("view", viewS);
-  skybox_program_.SetMat4("projection", projection);
-
-  glBindVertexArray(skybox_vao_);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_texture_);
-  glDrawArrays(GL_TRIANGLES, 0, 36);
-  glBindVertexArray(0);
+  if (skybox_texture_ != 0 && !TextureUploader::Default().pending(skybox_texture_)) {
+    glBindVertexArray(skybox_vao_);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_texture_);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+  }
 
   glDepthMask(GL_TRUE);
   glDepthFunc(GL_LESS);
@@ -655,52 +993,62 @@ void Scene3D::Update(const float dt) {
 
 
 
-  shader_model_.Use();
-  shader_model_.SetMat4("projection", projection);
-  shader_model_.SetMat4("view", view);
-
-
   frustum_.CreateFrustumFromCamera(camera_, aspect, fovY, zNear, zFar);
   glm::mat4 projView = projection * camera_.GetViewMatrix();
   frustum_.Update(projView);
-  shader_model_.SetVec3Array("lightPos", light_positions_, light_positions_.size());
-  shader_model_.SetVec3Array("lightColor", light_colors_, light_colors_.size());
-  shader_model_.SetVec3("viewPos", camera_.camera_position_);
 
 
   model = glm::mat4(1.0f);
   model = glm::translate(model, glm::vec3(1.0f, 0.0f, 0.0f));
   model = glm::scale(model, model_scale_ * glm::vec3(1.0f));
-  shader_model_.SetMat4("model", model);
-  model_.Draw(shader_model_.id_);
-
 
   glm::mat4 model2 = glm::mat4(1.0f);
   model2 = glm::translate(model2, glm::vec3(0.0f, 0.0f, 25.0f));
   model2 = glm::rotate(model2, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
   model2 = glm::scale(model2, glm::vec3(model_scale_2_));
-  shader_model_.SetMat4("model", model2);
-  model_2_.Draw(shader_model_.id_);
+
+  // Meshes visibles et occlusion avant les astéroïdes, que les occulteurs cachent aussi
+  UpdateSceneBvh(model, model2);
+  UpdateOcclusion(projView);
+
+  // Niveaux de détail choisis sur l'erreur projetée à l'écran (fovY, hauteur du viewport)
+  const LodSelector lod_selector = LodSelector::FromCamera(fovY, aspect_v, lod_pixel_error_);
+  UpdateInstanceLods(lod_selector, dt);
+
+  if (indirect_state_) {
+    shader_model_indirect_.Use();
+    indirect_renderer_.Clear();
+    indirect_renderer_.SetLodSelection(lod_selector, camera_.camera_position_);
+    indirect_renderer_.SetMeshletCulling(meshlet_culling_state_ ? &frustum_ : nullptr, camera_.camera_position_);
+    for (const std::uint32_t i : std::span(visible_meshes_).first(visible_mesh_count_)) {
+      indirect_renderer_.Add(*scene_meshes_[i].mesh, scene_meshes_[i].transform);
+    }
+    indirect_renderer_.Submit(shader_model_indirect_);
+    model_draw_calls_ = indirect_renderer_.draw_calls();
+  } else {
+    shader_model_.Use();
+    shader_model_.SetMat4("model", model);
+    model_.Draw(shader_model_, lod_selector, model, camera_.camera_position_);
+    shader_model_.SetMat4("model", model2);
+    model_2_.Draw(shader_model_, lod_selector, model2, camera_.camera_position_);
+    model_draw_calls_ = model_.meshes().size() + model_2_.meshes().size();
+  }
 
   glDisable((GL_CULL_FACE));
   if(Normal_state_){
 
   //-----------------------------------------------------------------------------------------
   Normal_Map.Use();
-  Normal_Map.SetMat4("projection", projection);
-  Normal_Map.SetMat4("view", view);
 
   // render wall
   auto model_4 = glm::mat4(1.0f);
   model_4 = glm::translate(model_4, glm::vec3(Normal_x, Normal_y, Normal_z));
   model_4 = glm::rotate(model_4, glm::radians(Normal_Rotation_angle), glm::normalize(glm::vec3(1.0, 0.0, 0.0)));
   Normal_Map.SetMat4("model", model_4);
-  Normal_Map.SetVec3("viewPos", camera_.camera_position_);
-  Normal_Map.SetVec3("lightPos", light_positions_[0].x, light_positions_[0].y, light_positions_[0].z);
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, ground_text_);
+  glBindTexture(GL_TEXTURE_2D, ground_text_.id());
   glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, ground_text_normal_);
+  glBindTexture(GL_TEXTURE_2D, ground_text_normal_.id());
   normal_renderQuad();
   }
   //glEnable(GL_CULL_FACE);
@@ -708,47 +1056,33 @@ void Scene3D::Update(const float dt) {
 
 
   Instancing_shader_.Use();
-  Instancing_shader_.SetMat4("projection", projection);
-  Instancing_shader_.SetMat4("view", view);
   Instancing_shader_.SetInt("texture_diffuse1", 0);
+  glActiveTexture(GL_TEXTURE0);
   if (!Instancing_Model_.get_textures_loaded().empty()) {
-    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, Instancing_Model_.get_textures_loaded()[0].id);
   } else {
-    std::cerr << "Erreur : Aucune texture chargée !" << std::endl;
+    // Encore en cours de chargement
+    glBindTexture(GL_TEXTURE_2D, FallbackTexture());
   }
-  for (unsigned int i = 0; i < Instancing_Model_.meshes().size(); i++) {
-    glBindVertexArray(Instancing_Model_.meshes()[i].VAO());
-    if (!Instancing_Model_.meshes()[i].indices_.empty()) {
-      glDrawElementsInstanced(
-          GL_TRIANGLES,
-          static_cast<unsigned int>(Instancing_Model_.meshes()[i].indices_.size()),
-          GL_UNSIGNED_INT,
-          0,
-          Instancing_amout
-      );
-    }
+  for (const Mesh& mesh : Instancing_Model_.meshes()) {
+    DrawInstances(mesh);
   }
+  glBindVertexArray(0);
 
 
   if(ssao_state_) {
 
     glBindFramebuffer(GL_FRAMEBUFFER, g_buffer_);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(geometry_shader_.id_);
-    geometry_shader_.SetMat4("projection", projection);
-    geometry_shader_.SetMat4("view", view);
+    geometry_shader_.Use();
 
-    glUniform1i(glGetUniformLocation(geometry_shader_.id_, "invertedNormals"), 0);
+    geometry_shader_.SetInt("invertedNormals", 0);
     model = glm::mat4(1.0f);
     for (int i = 0; i < Instancing_Model_.meshes_.size(); i++) {
-      glUniformMatrix4fv(glGetUniformLocation(geometry_shader_.id_, "model"), 1, GL_FALSE,
-                         glm::value_ptr(modelMatrices[i]));
-      glBindVertexArray(Instancing_Model_.meshes_[i].VAO_);
-      glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(Instancing_Model_.meshes_[i].indices_.size()),
-                              GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(Instancing_amout));
-      glBindVertexArray(0);
+      geometry_shader_.Set(geometry_model_, modelMatrices[i]);
+      DrawInstances(Instancing_Model_.meshes_[i]);
     }
+    glBindVertexArray(0);
 
     glDisable(GL_CULL_FACE);
     glFrontFace(GL_CW);
@@ -756,28 +1090,23 @@ void Scene3D::Update(const float dt) {
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(1.0f, 0.0f, 0.0f));
     model = glm::scale(model, model_scale_ * glm::vec3(1.0f));
-    glUniformMatrix4fv(glGetUniformLocation(geometry_shader_.id_, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    model_.Draw(shader_model_.id_);
+    geometry_shader_.Set(geometry_model_, model);
+    model_.Draw(geometry_shader_);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.0f, 0.0f, 25.0f));
     model = glm::rotate(model, glm::radians(270.0f), glm::vec3(1.0f, 0.0f, 0.0f));
     model = glm::scale(model, glm::vec3(model_scale_2_));
-    glUniformMatrix4fv(glGetUniformLocation(geometry_shader_.id_, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    model_2_.Draw(shader_model_.id_);
+    geometry_shader_.Set(geometry_model_, model);
+    model_2_.Draw(geometry_shader_);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     glBindFramebuffer(GL_FRAMEBUFFER, ssao_fbo_);
     glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(ssao_shader_.id_);
+    ssao_shader_.Use();
     // Send kernel + rotation
-    for (unsigned int i = 0; i < kKernelSize; ++i) {
-      std::string path = "samples[" + std::to_string(i) + "]";
-      glUniform3f(glGetUniformLocation(ssao_shader_.id_, path.c_str()), ssao_kernel_[i].x, ssao_kernel_[i].y,
-                  ssao_kernel_[i].z);
-    }
-    glUniformMatrix4fv(glGetUniformLocation(ssao_shader_.id_, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    ssao_shader_.Set(ssao_samples_, std::span<const glm::vec3>(ssao_kernel_).first(kKernelSize));
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, g_position_);
     glActiveTexture(GL_TEXTURE1);
@@ -789,29 +1118,27 @@ void Scene3D::Update(const float dt) {
 
     glBindFramebuffer(GL_FRAMEBUFFER, ssao_blur_fbo_);
     glClear(GL_COLOR_BUFFER_BIT);
-    glUseProgram(ssao_blur_shader_.id_);
+    ssao_blur_shader_.Use();
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, ssao_color_buffer_);
     renderQuad();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(lighting_shader_.id_);
+    lighting_shader_.Use();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     // send light relevant uniforms
     glm::vec3 lightPosView = glm::vec3(camera_.view_ * glm::vec4(light_positions_[0], 1.0));
 
-    glUniform3f(glGetUniformLocation(lighting_shader_.id_, "light.Position"), light_positions_[0].x,
-                light_positions_[0].y, light_positions_[0].z);
-    glUniform3f(glGetUniformLocation(lighting_shader_.id_, "light.Color"), light_positions_[0].x,
-                light_positions_[0].y, light_positions_[0].z);
+    lighting_shader_.SetVec3("light.Position", light_positions_[0]);
+    lighting_shader_.SetVec3("light.Color", light_positions_[0]);
 
     // Update attenuation parameters
     const float linear = 0.09f;
     const float quadratic = 0.032f;
 
-    glUniform1f(glGetUniformLocation(lighting_shader_.id_, "light.Linear"), linear);
-    glUniform1f(glGetUniformLocation(lighting_shader_.id_, "light.Quadratic"), quadratic);
+    lighting_shader_.SetFloat("light.Linear", linear);
+    lighting_shader_.SetFloat("light.Quadratic", quadratic);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, g_position_);
     glActiveTexture(GL_TEXTURE1);
@@ -826,14 +1153,12 @@ void Scene3D::Update(const float dt) {
   }
 
   shader_light_.Use();
-  shader_light_.SetMat4("projection", projection);
-  shader_light_.SetMat4("view", view);
   for (unsigned int i = 0; i < light_positions_.size(); i++) {
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(light_positions_[i]));
     model = glm::scale(model, glm::vec3(0.25f));
-    shader_light_.SetMat4("model", model);
-    shader_light_.SetVec3("lightColor", light_colors_[i]);
+    shader_light_.Set(light_model_, model);
+    shader_light_.Set(light_color_, light_colors_[i]);
     renderCube();
   }
   glBindVertexArray(0);
@@ -944,6 +1269,99 @@ void Scene3D::DrawImGui()
 
   ImGui::Begin("My Window"); // Start a new window
 
+  const std::pair<const char*, const Model*> loading_models[] = {
+      {"data/15", &model_}, {"data/17", &model_2_}, {"data/14", &Instancing_Model_}};
+  for (const auto& [name, loading_model] : loading_models) {
+    if (!loading_model->loading())
+      continue;
+    const ModelLoadProgress& progress = loading_model->load_progress();
+    // Texte temporaire : dans l'arène de la frame plutôt que dans des std::string
+    const std::string_view overlay = progress.importing
+        ? std::string_view("import...")
+        : gpr5300::FrameArena::Default().Format("%zu/%zu meshes, %zu/%zu textures", progress.meshes_ready,
+                                                progress.meshes_total, progress.textures_ready,
+                                                progress.textures_total);
+    ImGui::ProgressBar(progress.fraction(), ImVec2(-1.0f, 0.0f), overlay.data());
+    ImGui::SameLine();
+    ImGui::Text("%s", name);
+  }
+  if (!TextureUploader::Default().idle()) {
+    const TextureUploader& uploader = TextureUploader::Default();
+    ImGui::Text("Texture upload: %.1f MiB queued, %.1f/%.1f MiB this frame",
+                static_cast<float>(uploader.queued_bytes()) / (1024.0f * 1024.0f),
+                static_cast<float>(uploader.last_frame_bytes()) / (1024.0f * 1024.0f),
+                static_cast<float>(uploader.frame_budget()) / (1024.0f * 1024.0f));
+  }
+  const gpr5300::AllocationTracker& allocations = gpr5300::AllocationTracker::Default();
+  const gpr5300::FrameArena& frame_arena = gpr5300::FrameArena::Default();
+  ImGui::Text("Heap allocations: %zu (%.1f KiB) render thread, %zu all threads%s",
+              allocations.last_frame().count, static_cast<float>(allocations.last_frame().bytes) / 1024.0f,
+              allocations.last_frame_all_threads().count, IsSteadyState() ? "" : " (loading)");
+  ImGui::Text("Frame arena: %.1f / %.1f KiB", static_cast<float>(frame_arena.used()) / 1024.0f,
+              static_cast<float>(frame_arena.capacity()) / 1024.0f);
+  const StreamBuffer& stream = StreamBuffer::Default();
+  ImGui::Text("Stream buffer: %.1f / %.1f KiB, %zu stalls", static_cast<float>(stream.last_frame_bytes()) / 1024.0f,
+              static_cast<float>(stream.frame_capacity()) / 1024.0f, stream.stall_count());
+  const TextureRegistry& registry = TextureRegistry::Default();
+  ImGui::Text("Textures: %zu resident, %zu shared by path, %zu by content", registry.texture_count(),
+              registry.path_hits(), registry.content_hits());
+  const GeometryArena& arena = GeometryArena::Default();
+  ImGui::Text("Geometry arena: %.1f / %.1f MiB", static_cast<float>(arena.used_bytes()) / (1024.0f * 1024.0f),
+              static_cast<float>(arena.capacity_bytes()) / (1024.0f * 1024.0f));
+  std::size_t packed_meshes = 0;
+  std::size_t total_meshes = 0;
+  for (const Model* model : {&model_, &model_2_, &Instancing_Model_}) {
+    for (const Mesh& mesh : model->meshes()) {
+      packed_meshes += mesh.vertex_format() == VertexFormat::kPacked;
+      total_meshes++;
+    }
+  }
+  ImGui::Text("Packed vertices: %zu / %zu meshes", packed_meshes, total_meshes);
+  const ProgramCache& program_cache = ProgramCache::Default();
+  ImGui::Text("Shader cache: %zu hits, %zu misses (%zu rejected), %.1f ms saved", program_cache.hits(),
+              program_cache.misses(), program_cache.rejected(), program_cache.saved_milliseconds());
+
+  ImGui::Checkbox("Multi-draw indirect", &indirect_state_);
+  if (indirect_state_) {
+    ImGui::Text("Model draw calls: %zu (%zu commands, %zu materials)", model_draw_calls_,
+                indirect_renderer_.draw_count(), indirect_renderer_.material_count());
+    ImGui::Text("Scene BVH: %zu / %zu meshes visible, %zu nodes, %zu builds",
+                visible_mesh_count_ + occluded_mesh_count_, scene_meshes_.size(), scene_bvh_.nodes().size(),
+                scene_bvh_builds_);
+    ImGui::Checkbox("Meshlet culling", &meshlet_culling_state_);
+    if (meshlet_culling_state_) {
+      const MeshletCullStats& cull_stats = indirect_renderer_.cull_stats();
+      ImGui::Text("Meshlets: %zu / %zu, triangles: %zu / %zu", cull_stats.visible_meshlet_count,
+                  cull_stats.meshlet_count, cull_stats.visible_triangle_count, cull_stats.triangle_count);
+    }
+  } else {
+    ImGui::Text("Model draw calls: %zu", model_draw_calls_);
+  }
+  ImGui::SliderFloat("LOD pixel error", &lod_pixel_error_, 0.0f, 8.0f);
+  ImGui::SliderFloat("Model scale", &model_scale_, 0.01f, 0.2f, "%.3f");
+  ImGui::SliderFloat("Model 2 scale", &model_scale_2_, 0.01f, 0.5f, "%.3f");
+  ImGui::SliderFloat("Asteroid ring speed", &ring_speed_, -1.0f, 1.0f, "%.2f rad/s");
+  ImGui::Text("Asteroid LODs: %zu levels, %u / %u / %u / %u instances", Instancing_Model_.lod_count(),
+              instance_lod_counts_[0], instance_lod_counts_[1], instance_lod_counts_[2], instance_lod_counts_[3]);
+  ImGui::Text("Asteroid culling: %zu / %u visible, %.1f us", instance_culler_.visible().size(), Instancing_amout,
+              instance_cull_us_);
+  ImGui::Checkbox("Occlusion culling", &occlusion_state_);
+  if (occlusion_state_) {
+    ImGui::Text("Occluders: %zu / %zu drawn, %zu / %zu triangles (%s), %.1f us", occlusion_culler_.instance_count(),
+                occlusion_culler_.occluder_count(), occlusion_culler_.drawn_triangle_count(),
+                occlusion_culler_.triangle_count(), OcclusionCullingIsa(), occlusion_us_);
+    ImGui::Text("Occluded: %zu meshes, %zu asteroids", occluded_mesh_count_, occluded_instance_count_);
+    ImGui::Checkbox("Show occlusion buffer", &occlusion_overlay_);
+    if (occlusion_overlay_) {
+      UpdateOcclusionTexture();
+      // Ligne 0 du tampon en bas de l'écran, comme dans GL : image retournée. Cast à la C :
+      // ImTextureID est un pointeur ou un entier selon la version d'ImGui
+      ImGui::Image((ImTextureID)(std::intptr_t)occlusion_texture_,
+                   ImVec2(2.0f * OcclusionCuller::kWidth, 2.0f * OcclusionCuller::kHeight), ImVec2(0.0f, 1.0f),
+                   ImVec2(1.0f, 0.0f));
+    }
+  }
+
   //ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
 
   if (ImGui::Checkbox("Enable bloom", &bloom_state_)) {
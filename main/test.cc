@@ -10,7 +10,9 @@
 
 #include "engine.h"
 #include "file_utility.h"
+#include "frame_uniforms.h"
 #include "free_camera.h"
+#include "indirect_renderer.h"
 #include "model.h"
 #include "scene3d.h"
 #include "shader.h"
@@ -31,6 +33,11 @@ class Scene3D final : public Scene
  private:
   Shader program_ = {};
   Shader skybox_program_ = {};
+  Shader indirect_program_ = {};
+  FrameUniforms frame_uniforms_;
+  IndirectRenderer indirect_renderer_;
+  bool indirect_state_ = true;
+  std::size_t model_draw_calls_ = 0;
 
   GLuint skybox_vao_ = 0;
   GLuint skybox_vbo_ = 0;
@@ -56,6 +63,8 @@ void Scene3D::Begin()
 
   program_ = Shader("data/shaders/scene3d/model.vert", "data/shaders/scene3d/model.frag");
   skybox_program_ = Shader("data/shaders/scene3d/cubemaps.vert", "data/shaders/scene3d/cubemaps.frag");
+  indirect_program_ = Shader("data/shaders/scene3d/model_indirect.vert", "data/shaders/scene3d/model_indirect.frag");
+  indirect_renderer_.Create();
 
   glEnable(GL_DEPTH_TEST);
   glDepthFunc(GL_LESS);
@@ -120,7 +129,7 @@ void Scene3D::Begin()
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
 
-  std::vector<std::string> faces
+  const std::string_view faces[]
       {
           "data/textures/skybox/right.jpg",
           "data/textures/skybox/left.jpg",
@@ -148,7 +157,10 @@ void Scene3D::End()
   //Unload program/pipeline
   program_.Delete();
   skybox_program_.Delete();
-
+  indirect_program_.Delete();
+  indirect_renderer_.Delete();
+  // Releases the model's texture references while the GL context still exists
+  model_ = Model();
 }
 
 
@@ -165,19 +177,32 @@ void Scene3D::Update(const float dt)
   auto projection = glm::perspective(glm::radians(45.0f), (float)1280 / (float)720, 0.1f, 10000.0f);
   auto view = camera_->view();
 
-  program_.SetMat4("projection", projection);
-  program_.SetMat4("view", view);
-
+  // A single white light carried by the camera
   const glm::vec3 view_pos = camera_->camera_position_;
-  program_.SetVec3("viewPos", glm::vec3(view_pos.x, view_pos.y, view_pos.z));
+  const glm::vec3 light_color(1.0f);
+  frame_uniforms_.Update(FrameUniforms::MakeFrameData(view, projection, view_pos, elapsedTime_),
+                         FrameUniforms::MakeLightData({&view_pos, 1}, {&light_color, 1}));
 
   //Draw model
   auto model = glm::mat4(1.0f);
   model = glm::translate(model, glm::vec3(1.0f, 0.0f, 0.0f));
   model = glm::scale(model, model_scale_ * glm::vec3(1.0f, 1.0f, 1.0f));
 
-  program_.SetMat4("model", model);
-  model_.Draw(program_.id_);
+  // One glMultiDrawElementsIndirect per material, or one draw per mesh
+  if (indirect_state_)
+  {
+    indirect_program_.Use();
+    indirect_renderer_.Clear();
+    indirect_renderer_.Add(model_, model);
+    indirect_renderer_.Submit(indirect_program_);
+    model_draw_calls_ = indirect_renderer_.draw_calls();
+  }
+  else
+  {
+    program_.SetMat4("model", model);
+    model_.Draw(program_);
+    model_draw_calls_ = model_.meshes().size();
+  }
 
   glBindVertexArray(0);
 
@@ -185,9 +210,6 @@ void Scene3D::Update(const float dt)
   //Draw skybox
   glDepthFunc(GL_LEQUAL);
   skybox_program_.Use();
-  view = glm::mat4(glm::mat3(camera_->view()));
-  skybox_program_.SetMat4("view", view);
-  skybox_program_.SetMat4("projection", projection);
   //Skybox cube
   glBindVertexArray(skybox_vao_);
   glActiveTexture(GL_TEXTURE0);
@@ -258,6 +280,16 @@ void Scene3D::DrawImGui()
   //ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
   //ImGui::SliderFloat("Model Size", &model_scale_, 10.0f, 100.0f, "%.1f");
   static ImVec4 LightColour = ImVec4(1.0f, 1.0f, 1.0f, 1.0f); // Default color
+  ImGui::Checkbox("Multi-draw indirect", &indirect_state_);
+  if (indirect_state_)
+  {
+    ImGui::Text("Model draw calls: %zu (%zu commands, %zu materials)", model_draw_calls_,
+                indirect_renderer_.draw_count(), indirect_renderer_.material_count());
+  }
+  else
+  {
+    ImGui::Text("Model draw calls: %zu", model_draw_calls_);
+  }
   ImGui::End(); // End the window
 }
 }
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "texture_compression.h"
+#include "texture_loader.h"
+#include "thread_pool.h"
+
+// Offline texture baker: encodes every image under the given directories (data/
+// by default) into BCn with a full mip chain and writes "<image>.dds" next to
+// it. The loaders pick the baked file up automatically while it is newer than
+// its source.
+// Usage: texture_baker [--bc7] [--force] [dir_or_file...]
+//   --bc7    BC7 instead of BC1/BC3 for colour maps (slower, higher quality)
+//   --force  rebake files that are already up to date
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct BakeResult
+{
+  BlockFormat format = BlockFormat::kBC1;
+  bool baked = false;
+  std::size_t source_bytes = 0; // RGBA8 with mips, what the uncompressed path keeps in VRAM
+  std::size_t baked_bytes = 0;
+  double milliseconds = 0.0;
+};
+
+bool IsImage(const std::filesystem::path& path)
+{
+  std::string extension = path.extension().string();
+  std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+  return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" ||
+         extension == ".bmp";
+}
+
+std::size_t Rgba8MipChainBytes(int width, int height)
+{
+  std::size_t bytes = 0;
+  for (int level = 0; level < MipLevelCount(width, height); level++)
+  {
+    bytes += static_cast<std::size_t>(width) * height * 4;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return bytes;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  bool high_quality = false;
+  bool force = false;
+  std::vector<std::filesystem::path> roots;
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string_view argument = argv[i];
+    if (argument == "--bc7")
+      high_quality = true;
+    else if (argument == "--force")
+      force = true;
+    else
+      roots.emplace_back(argument);
+  }
+  if (roots.empty())
+  {
+    roots.emplace_back("data");
+  }
+
+  std::vector<std::string> paths;
+  for (const auto& root : roots)
+  {
+    if (std::filesystem::is_regular_file(root))
+    {
+      paths.push_back(root.string());
+      continue;
+    }
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root, error))
+    {
+      if (entry.is_regular_file() && IsImage(entry.path()))
+      {
+        paths.push_back(entry.path().string());
+      }
+    }
+  }
+  std::ranges::sort(paths);
+  if (paths.empty())
+  {
+    std::cerr << "No images found\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<BakeResult> results(paths.size());
+  const auto start = Clock::now();
+  gpr5300::ThreadPool::Default().ParallelFor(paths.size(), [&](const std::size_t i) {
+    if (!force && LoadBakedTexture(paths[i]).valid())
+    {
+      return;
+    }
+    const auto bake_start = Clock::now();
+    const Image image = DecodeImage(paths[i]);
+    if (!image.valid())
+    {
+      return;
+    }
+    BakeResult& result = results[i];
+    result.format = ChooseBlockFormat(paths[i], image, high_quality);
+    const CompressedImage compressed = CompressImage(image, result.format);
+    result.baked = WriteDds(BakedTexturePath(paths[i]), compressed);
+    result.source_bytes = Rgba8MipChainBytes(image.width, image.height);
+    result.baked_bytes = compressed.data.size();
+    result.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - bake_start).count();
+  });
+
+  std::size_t baked_count = 0;
+  std::size_t source_total = 0;
+  std::size_t baked_total = 0;
+  for (std::size_t i = 0; i < paths.size(); i++)
+  {
+    const BakeResult& result = results[i];
+    if (!result.baked)
+    {
+      continue;
+    }
+    baked_count++;
+    source_total += result.source_bytes;
+    baked_total += result.baked_bytes;
+    std::cout << BlockFormatName(result.format) << "  " << paths[i] << "  " << result.baked_bytes / 1024
+              << " KiB (" << result.milliseconds << " ms)\n";
+  }
+
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << baked_count << " baked, " << paths.size() - baked_count << " up to date or unreadable, " << seconds
+            << " s\n";
+  if (baked_total > 0)
+  {
+    std::cout << "VRAM: " << source_total / (1024 * 1024) << " MiB as RGBA8 -> " << baked_total / (1024 * 1024)
+              << " MiB as BCn (" << static_cast<double>(source_total) / static_cast<double>(baked_total) << "x)\n";
+  }
+  return EXIT_SUCCESS;
+}
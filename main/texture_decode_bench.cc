@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "texture_loader.h"
+#include "thread_pool.h"
+
+// Load-time benchmark: decodes every image under data/ serially, then in
+// parallel on the loader thread pool, and prints both timings.
+// Usage: texture_decode_bench [data_dir] [repetitions]
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double ElapsedMs(const Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::filesystem::path root = argc > 1 ? argv[1] : "data";
+  const int repetitions = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(root, error))
+  {
+    std::string extension = entry.path().extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg"))
+    {
+      paths.push_back(entry.path().string());
+    }
+  }
+  if (paths.empty())
+  {
+    std::cerr << "No images found under " << root << "\n";
+    return EXIT_FAILURE;
+  }
+
+  gpr5300::ThreadPool& pool = gpr5300::ThreadPool::Default();
+  std::cout << paths.size() << " images, " << pool.worker_count() + 1 << " decoding threads, "
+            << repetitions << " repetitions\n";
+
+  double best_serial = 1e30;
+  double best_parallel = 1e30;
+  std::size_t pixel_bytes = 0;
+  for (int run = 0; run < repetitions; run++)
+  {
+    auto start = Clock::now();
+    pixel_bytes = 0;
+    for (const std::string& path : paths)
+    {
+      const Image image = DecodeImage(path);
+      pixel_bytes += static_cast<std::size_t>(image.width) * image.height * image.comp;
+    }
+    best_serial = std::min(best_serial, ElapsedMs(start));
+
+    start = Clock::now();
+    const std::vector<Image> images = DecodeImages(paths, 0, &pool);
+    best_parallel = std::min(best_parallel, ElapsedMs(start));
+  }
+
+  std::cout << "decoded " << pixel_bytes / (1024 * 1024) << " MiB of pixels\n";
+  std::cout << "serial   : " << best_serial << " ms\n";
+  std::cout << "parallel : " << best_parallel << " ms\n";
+  std::cout << "speedup  : " << best_serial / best_parallel << "x\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include "allocation_tracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace
+{
+// Plain globals, constant initialized: operator new may run before any dynamic
+// initialization and after thread_local destruction
+std::atomic<std::size_t> process_allocation_count = 0;
+std::atomic<std::size_t> process_allocated_bytes = 0;
+thread_local std::size_t thread_allocation_count = 0;
+thread_local std::size_t thread_allocated_bytes = 0;
+std::atomic<gpr5300::AllocationTracker::Hook> allocation_hook = nullptr;
+
+void CountAllocation(void* pointer, const std::size_t size)
+{
+  process_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  process_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  thread_allocation_count++;
+  thread_allocated_bytes += size;
+#ifdef TRACY_ENABLE
+  TracyAlloc(pointer, size);
+#else
+  (void)pointer;
+#endif
+  if (const gpr5300::AllocationTracker::Hook hook = allocation_hook.load(std::memory_order_acquire))
+  {
+    hook(size);
+  }
+}
+
+void* AllocateAligned(const std::size_t size, const std::size_t alignment)
+{
+#ifdef _MSC_VER
+  return _aligned_malloc(size, alignment);
+#else
+  // aligned_alloc wants a multiple of the alignment
+  return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+void FreeAligned(void* pointer)
+{
+#ifdef _MSC_VER
+  _aligned_free(pointer);
+#else
+  std::free(pointer);
+#endif
+}
+
+void CountFree(void* pointer)
+{
+#ifdef TRACY_ENABLE
+  if (pointer != nullptr)
+  {
+    TracyFree(pointer);
+  }
+#else
+  (void)pointer;
+#endif
+}
+} // namespace
+
+void* operator new(const std::size_t size)
+{
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  CountAllocation(pointer, size);
+  return pointer;
+}
+
+void* operator new(const std::size_t size, const std::align_val_t alignment)
+{
+  void* pointer = AllocateAligned(size == 0 ? 1 : size, static_cast<std::size_t>(alignment));
+  if (pointer == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  CountAllocation(pointer, size);
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+  CountFree(pointer);
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  CountFree(pointer);
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+  CountFree(pointer);
+  FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+  CountFree(pointer);
+  FreeAligned(pointer);
+}
+
+namespace gpr5300
+{
+
+AllocationTracker& AllocationTracker::Default()
+{
+  static AllocationTracker tracker;
+  return tracker;
+}
+
+void AllocationTracker::SetHook(const Hook hook)
+{
+  allocation_hook.store(hook, std::memory_order_release);
+}
+
+AllocationCounters AllocationTracker::thread_total()
+{
+  return {thread_allocation_count, thread_allocated_bytes};
+}
+
+AllocationCounters AllocationTracker::process_total()
+{
+  return {process_allocation_count.load(std::memory_order_relaxed),
+          process_allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+void AllocationTracker::EndFrame()
+{
+  const AllocationCounters thread = thread_total();
+  const AllocationCounters process = process_total();
+  last_frame_ = {thread.count - frame_start_.count, thread.bytes - frame_start_.bytes};
+  last_frame_all_threads_ = {process.count - frame_start_all_threads_.count,
+                             process.bytes - frame_start_all_threads_.bytes};
+  frame_start_ = thread;
+  frame_start_all_threads_ = process;
+}
+
+} // namespace gpr5300
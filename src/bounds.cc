@@ -0,0 +1,35 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+float MaxScale(const glm::mat4& transform)
+{
+  return std::sqrt(std::max({glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+                             glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+                             glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))}));
+}
+
+void TransformAabb(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max, glm::vec3& out_min,
+                   glm::vec3& out_max)
+{
+  // Start from the translation, then add column by column: transform[column][row]
+  out_min = glm::vec3(transform[3]);
+  out_max = out_min;
+  for (int column = 0; column < 3; column++)
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      const float a = transform[column][row] * min[column];
+      const float b = transform[column][row] * max[column];
+      out_min[row] += std::min(a, b);
+      out_max[row] += std::max(a, b);
+    }
+  }
+}
+
+BoundingSphere TransformSphere(const glm::mat4& transform, const BoundingSphere& sphere)
+{
+  return {glm::vec3(transform * glm::vec4(sphere.center, 1.0f)), sphere.radius * MaxScale(transform)};
+}
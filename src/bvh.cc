@@ -0,0 +1,508 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <glm/glm.hpp>
+
+#include "free_camera.h"
+
+namespace
+{
+// Relative cost of visiting a node, a box test against the ray or volume,
+// counted the same as testing one item
+constexpr float kBvhTraversalCost = 1.0f;
+// Depth after which nodes are split at the median item, so the deepest leaf
+// stays within Bvh::kMaxDepth for any item count that fits 32 bits
+constexpr auto kBvhMedianSplitDepth = static_cast<std::uint32_t>(Bvh::kMaxDepth - 1 - 32);
+
+struct BvhBin
+{
+  BoundingBox box;
+  std::uint32_t count = 0;
+};
+
+// Entry of the volume query stacks: the node and, for frustum queries, the
+// planes (one bit each) that cross its parent
+struct BvhQueryEntry
+{
+  std::uint32_t node;
+  std::uint32_t planes;
+};
+
+void BvhGrow(BoundingBox& box, const glm::vec3& min, const glm::vec3& max)
+{
+  box.min = glm::min(box.min, min);
+  box.max = glm::max(box.max, max);
+}
+
+float BvhArea(const glm::vec3& min, const glm::vec3& max)
+{
+  const glm::vec3 extent = max - min;
+  if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+  {
+    return 0.0f;
+  }
+  return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+// Bin of a centroid coordinate, clamped for the one at the top of the range
+std::size_t BvhBinIndex(const float centroid, const float min, const float scale)
+{
+  return std::min(Bvh::kSahBins - 1, static_cast<std::size_t>((centroid - min) * scale));
+}
+
+// Positive-vertex test of a box against one plane: outside if even its corner
+// furthest along the normal is behind, inside if its nearest corner is in front
+bool IsBoxBehindPlane(const Plane& plane, const glm::vec3& min, const glm::vec3& max)
+{
+  const glm::vec3 positive(plane.normal.x >= 0.0f ? max.x : min.x, plane.normal.y >= 0.0f ? max.y : min.y,
+                           plane.normal.z >= 0.0f ? max.z : min.z);
+  return glm::dot(plane.normal, positive) < plane.distance;
+}
+
+bool IsBoxInFrontOfPlane(const Plane& plane, const glm::vec3& min, const glm::vec3& max)
+{
+  const glm::vec3 negative(plane.normal.x >= 0.0f ? min.x : max.x, plane.normal.y >= 0.0f ? min.y : max.y,
+                           plane.normal.z >= 0.0f ? min.z : max.z);
+  return glm::dot(plane.normal, negative) >= plane.distance;
+}
+
+// Squared distances from center to the nearest and the farthest point of the box
+float BvhNearestDistance2(const glm::vec3& center, const glm::vec3& min, const glm::vec3& max)
+{
+  const glm::vec3 offset = glm::clamp(center, min, max) - center;
+  return glm::dot(offset, offset);
+}
+
+float BvhFarthestDistance2(const glm::vec3& center, const glm::vec3& min, const glm::vec3& max)
+{
+  const glm::vec3 offset = glm::max(glm::abs(min - center), glm::abs(max - center));
+  return glm::dot(offset, offset);
+}
+} // namespace
+
+void Bvh::Build(const std::span<const BoundingBox> items)
+{
+  Clear();
+  if (items.empty())
+  {
+    return;
+  }
+  const auto item_count = static_cast<std::uint32_t>(items.size());
+  boxes_.assign(items.begin(), items.end());
+  item_order_.resize(item_count);
+  item_leaf_.resize(item_count);
+  item_dirty_.assign(item_count, 0);
+  dirty_.reserve(item_count);
+  build_items_.resize(item_count);
+  for (std::uint32_t i = 0; i < item_count; i++)
+  {
+    build_items_[i] = {boxes_[i].min, i, boxes_[i].max, (boxes_[i].min + boxes_[i].max) * 0.5f};
+  }
+
+  // A binary tree with at least one item per leaf has at most 2n - 1 nodes
+  nodes_.reserve(2 * static_cast<std::size_t>(item_count) - 1);
+  parents_.reserve(nodes_.capacity());
+  nodes_.push_back({});
+  parents_.push_back(kNoItem);
+  // Depth first, one pending sibling per level at most
+  build_tasks_.reserve(kMaxDepth + 1);
+  build_tasks_.clear();
+  build_tasks_.push_back({0, 0, item_count, 0});
+  while (!build_tasks_.empty())
+  {
+    const BuildTask task = build_tasks_.back();
+    build_tasks_.pop_back();
+    const auto begin = build_items_.begin() + task.first;
+    const auto end = begin + task.count;
+
+    BoundingBox box;
+    BoundingBox centroid_box;
+    for (auto it = begin; it != end; ++it)
+    {
+      BvhGrow(box, it->min, it->max);
+      BvhGrow(centroid_box, it->centroid, it->centroid);
+    }
+    nodes_[task.node].min = box.min;
+    nodes_[task.node].max = box.max;
+    if (task.count <= kMaxLeafSize)
+    {
+      nodes_[task.node].first = task.first;
+      nodes_[task.node].count = task.count;
+      for (std::uint32_t i = task.first; i < task.first + task.count; i++)
+      {
+        item_order_[i] = build_items_[i].item;
+        item_leaf_[build_items_[i].item] = task.node;
+      }
+      continue;
+    }
+
+    // Cheapest plane among the bin boundaries of the three axes, binned in one pass
+    int best_axis = -1;
+    std::size_t best_plane = 0;
+    float best_cost = std::numeric_limits<float>::infinity();
+    const glm::vec3 centroid_extent = centroid_box.max - centroid_box.min;
+    if (task.depth < kBvhMedianSplitDepth)
+    {
+      glm::vec3 scale;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        // A flat axis puts every item in bin 0 and never yields a plane
+        scale[axis] = centroid_extent[axis] > 0.0f ? static_cast<float>(kSahBins) / centroid_extent[axis] : 0.0f;
+      }
+      std::array<std::array<BvhBin, kSahBins>, 3> bins{};
+      for (auto it = begin; it != end; ++it)
+      {
+        for (int axis = 0; axis < 3; axis++)
+        {
+          BvhBin& bin = bins[axis][BvhBinIndex(it->centroid[axis], centroid_box.min[axis], scale[axis])];
+          BvhGrow(bin.box, it->min, it->max);
+          bin.count++;
+        }
+      }
+      for (int axis = 0; axis < 3; axis++)
+      {
+        // Right side of every plane swept from the top, then the left side from the bottom
+        std::array<float, kSahBins - 1> right_cost{};
+        BoundingBox right;
+        std::uint32_t right_count = 0;
+        for (std::size_t plane = kSahBins - 1; plane > 0; plane--)
+        {
+          BvhGrow(right, bins[axis][plane].box.min, bins[axis][plane].box.max);
+          right_count += bins[axis][plane].count;
+          right_cost[plane - 1] = right_count == 0 ? std::numeric_limits<float>::infinity()
+                                                   : BvhArea(right.min, right.max) * right_count;
+        }
+        BoundingBox left;
+        std::uint32_t left_count = 0;
+        for (std::size_t plane = 0; plane < kSahBins - 1; plane++)
+        {
+          BvhGrow(left, bins[axis][plane].box.min, bins[axis][plane].box.max);
+          left_count += bins[axis][plane].count;
+          if (left_count == 0)
+          {
+            continue;
+          }
+          const float cost = BvhArea(left.min, left.max) * left_count + right_cost[plane];
+          if (cost < best_cost)
+          {
+            best_axis = axis;
+            best_plane = plane;
+            best_cost = cost;
+          }
+        }
+      }
+    }
+
+    std::uint32_t left_count = task.count / 2;
+    if (best_axis >= 0)
+    {
+      const float scale = static_cast<float>(kSahBins) / centroid_extent[best_axis];
+      const float min = centroid_box.min[best_axis];
+      const auto middle = std::partition(begin, end, [&](const BuildItem& item) {
+        return BvhBinIndex(item.centroid[best_axis], min, scale) <= best_plane;
+      });
+      left_count = static_cast<std::uint32_t>(middle - begin);
+    }
+    else if (task.depth >= kBvhMedianSplitDepth)
+    {
+      // Too deep: halve the items along the widest centroid axis
+      const int axis = centroid_extent.x >= centroid_extent.y && centroid_extent.x >= centroid_extent.z ? 0
+                       : centroid_extent.y >= centroid_extent.z                                         ? 1
+                                                                                                        : 2;
+      std::nth_element(begin, begin + left_count, end, [&](const BuildItem& a, const BuildItem& b) {
+        return a.centroid[axis] < b.centroid[axis];
+      });
+    }
+    // else every centroid is the same point: any halving will do
+
+    const auto left = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.push_back({});
+    nodes_.push_back({});
+    parents_.push_back(task.node);
+    parents_.push_back(task.node);
+    nodes_[task.node].first = left;
+    nodes_[task.node].count = 0;
+    // Left subtree built first, its nodes follow the pair
+    build_tasks_.push_back({left + 1, task.first + left_count, task.count - left_count, task.depth + 1});
+    build_tasks_.push_back({left, task.first, left_count, task.depth + 1});
+  }
+  build_cost_ = SahCost();
+}
+
+void Bvh::Clear()
+{
+  nodes_.clear();
+  boxes_.clear();
+  item_order_.clear();
+  item_leaf_.clear();
+  parents_.clear();
+  dirty_.clear();
+  item_dirty_.clear();
+  build_cost_ = 0.0f;
+}
+
+void Bvh::Update(const std::uint32_t item, const BoundingBox& box)
+{
+  boxes_[item] = box;
+  if (item_dirty_[item] == 0)
+  {
+    // Reserved for every item by Build, never reallocates
+    item_dirty_[item] = 1;
+    dirty_.push_back(item);
+  }
+}
+
+std::size_t Bvh::Refit()
+{
+  std::size_t changed = 0;
+  for (const std::uint32_t item : dirty_)
+  {
+    item_dirty_[item] = 0;
+    std::uint32_t index = item_leaf_[item];
+    Node& leaf = nodes_[index];
+    const glm::vec3 old_min = leaf.min;
+    const glm::vec3 old_max = leaf.max;
+    FitLeaf(leaf);
+    if (leaf.min == old_min && leaf.max == old_max)
+    {
+      continue;
+    }
+    changed++;
+    // Up to the first ancestor the change does not reach. Another item's walk
+    // may go over the same nodes again, always from the children's latest boxes.
+    for (index = parents_[index]; index != kNoItem; index = parents_[index])
+    {
+      Node& node = nodes_[index];
+      const Node& left = nodes_[node.first];
+      const Node& right = nodes_[node.first + 1];
+      const glm::vec3 min = glm::min(left.min, right.min);
+      const glm::vec3 max = glm::max(left.max, right.max);
+      if (min == node.min && max == node.max)
+      {
+        break;
+      }
+      node.min = min;
+      node.max = max;
+      changed++;
+    }
+  }
+  dirty_.clear();
+  return changed;
+}
+
+void Bvh::FitLeaf(Node& node) const
+{
+  BoundingBox box;
+  for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+  {
+    BvhGrow(box, boxes_[item_order_[i]].min, boxes_[item_order_[i]].max);
+  }
+  node.min = box.min;
+  node.max = box.max;
+}
+
+std::span<const std::uint32_t> Bvh::SubtreeItems(const std::uint32_t node) const
+{
+  std::uint32_t first_leaf = node;
+  while (!nodes_[first_leaf].is_leaf())
+  {
+    first_leaf = nodes_[first_leaf].first;
+  }
+  std::uint32_t last_leaf = node;
+  while (!nodes_[last_leaf].is_leaf())
+  {
+    last_leaf = nodes_[last_leaf].first + 1;
+  }
+  const std::uint32_t begin = nodes_[first_leaf].first;
+  const std::uint32_t end = nodes_[last_leaf].first + nodes_[last_leaf].count;
+  return std::span<const std::uint32_t>(item_order_).subspan(begin, end - begin);
+}
+
+std::size_t Bvh::QueryFrustum(const Frustum& frustum, const std::span<std::uint32_t> out, QueryStats* stats) const
+{
+  if (nodes_.empty())
+  {
+    return 0;
+  }
+  const std::array<Plane, 6>& planes = frustum.planes();
+  QueryStats counters;
+  std::size_t count = 0;
+  BvhQueryEntry stack[kMaxDepth + 1];
+  std::size_t size = 0;
+  stack[size++] = {0, (1u << planes.size()) - 1};
+  while (size > 0)
+  {
+    const BvhQueryEntry entry = stack[--size];
+    const Node& node = nodes_[entry.node];
+    counters.nodes_visited++;
+    // Planes the node is entirely in front of are dropped for its subtree
+    std::uint32_t crossing = entry.planes;
+    bool outside = false;
+    for (std::uint32_t bits = entry.planes; bits != 0; bits &= bits - 1)
+    {
+      const Plane& plane = planes[std::countr_zero(bits)];
+      if (IsBoxBehindPlane(plane, node.min, node.max))
+      {
+        outside = true;
+        break;
+      }
+      if (IsBoxInFrontOfPlane(plane, node.min, node.max))
+      {
+        crossing &= ~(bits & (0u - bits));
+      }
+    }
+    if (outside)
+    {
+      continue;
+    }
+    if (crossing == 0)
+    {
+      const std::span<const std::uint32_t> items = SubtreeItems(entry.node);
+      std::copy(items.begin(), items.end(), out.begin() + count);
+      count += items.size();
+      counters.items_accepted += items.size();
+    }
+    else if (node.is_leaf())
+    {
+      for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+      {
+        const BoundingBox& box = boxes_[item_order_[i]];
+        bool visible = true;
+        for (std::uint32_t bits = crossing; bits != 0 && visible; bits &= bits - 1)
+        {
+          visible = !IsBoxBehindPlane(planes[std::countr_zero(bits)], box.min, box.max);
+        }
+        if (visible)
+        {
+          out[count++] = item_order_[i];
+        }
+      }
+      counters.items_tested += node.count;
+    }
+    else
+    {
+      stack[size++] = {node.first + 1, crossing};
+      stack[size++] = {node.first, crossing};
+    }
+  }
+  if (stats != nullptr)
+  {
+    *stats = counters;
+  }
+  return count;
+}
+
+std::size_t Bvh::QuerySphere(const glm::vec3& center, const float radius, const std::span<std::uint32_t> out,
+                             QueryStats* stats) const
+{
+  if (nodes_.empty())
+  {
+    return 0;
+  }
+  const float radius2 = radius * radius;
+  QueryStats counters;
+  std::size_t count = 0;
+  BvhQueryEntry stack[kMaxDepth + 1];
+  std::size_t size = 0;
+  stack[size++] = {0, 0};
+  while (size > 0)
+  {
+    const std::uint32_t index = stack[--size].node;
+    const Node& node = nodes_[index];
+    counters.nodes_visited++;
+    if (BvhNearestDistance2(center, node.min, node.max) > radius2)
+    {
+      continue;
+    }
+    if (BvhFarthestDistance2(center, node.min, node.max) <= radius2)
+    {
+      const std::span<const std::uint32_t> items = SubtreeItems(index);
+      std::copy(items.begin(), items.end(), out.begin() + count);
+      count += items.size();
+      counters.items_accepted += items.size();
+    }
+    else if (node.is_leaf())
+    {
+      for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+      {
+        const BoundingBox& box = boxes_[item_order_[i]];
+        if (BvhNearestDistance2(center, box.min, box.max) <= radius2)
+        {
+          out[count++] = item_order_[i];
+        }
+      }
+      counters.items_tested += node.count;
+    }
+    else
+    {
+      stack[size++] = {node.first + 1, 0};
+      stack[size++] = {node.first, 0};
+    }
+  }
+  if (stats != nullptr)
+  {
+    *stats = counters;
+  }
+  return count;
+}
+
+Bvh::RayHit Bvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, const float max_distance) const
+{
+  const glm::vec3 inverse = InverseDirection(direction);
+  return Raycast(origin, direction, max_distance, [&](const std::uint32_t item, const float distance) {
+    float entry = 0.0f;
+    return IntersectRay(boxes_[item].min, boxes_[item].max, origin, inverse, distance, entry) ? entry : distance;
+  });
+}
+
+float Bvh::SahCost() const
+{
+  if (nodes_.empty())
+  {
+    return 0.0f;
+  }
+  const float root_area = BvhArea(nodes_[0].min, nodes_[0].max);
+  if (root_area <= 0.0f)
+  {
+    return static_cast<float>(boxes_.size());
+  }
+  float cost = 0.0f;
+  for (const Node& node : nodes_)
+  {
+    cost += BvhArea(node.min, node.max) * (node.is_leaf() ? static_cast<float>(node.count) : kBvhTraversalCost);
+  }
+  return cost / root_area;
+}
+
+float IntersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a,
+                           const glm::vec3& b, const glm::vec3& c)
+{
+  constexpr float kMiss = std::numeric_limits<float>::infinity();
+  const glm::vec3 edge1 = b - a;
+  const glm::vec3 edge2 = c - a;
+  const glm::vec3 p = glm::cross(direction, edge2);
+  const float determinant = glm::dot(edge1, p);
+  // Ray parallel to the triangle's plane, or degenerate triangle
+  if (determinant == 0.0f)
+  {
+    return kMiss;
+  }
+  const float inverse = 1.0f / determinant;
+  const glm::vec3 s = origin - a;
+  const float u = glm::dot(s, p) * inverse;
+  if (u < 0.0f || u > 1.0f)
+  {
+    return kMiss;
+  }
+  const glm::vec3 q = glm::cross(s, edge1);
+  const float v = glm::dot(direction, q) * inverse;
+  if (v < 0.0f || u + v > 1.0f)
+  {
+    return kMiss;
+  }
+  const float distance = glm::dot(edge2, q) * inverse;
+  return distance >= 0.0f ? distance : kMiss;
+}
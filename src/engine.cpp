@@ -8,6 +8,11 @@
 
 #include <cassert>
 #include <chrono>
+#include <iostream>
+
+#include "allocation_tracker.h"
+#include "frame_arena.h"
+#include "stream_buffer.h"
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
 #include <tracy/TracyC.h>
@@ -17,6 +22,13 @@
 
 namespace gpr5300
 {
+    namespace
+    {
+        // Frames of steady state before allocations are checked, so one-off
+        // growth (first draw of a new view, a toggled option) can settle
+        constexpr std::size_t kSteadyStateWarmupFrames = 120;
+    } // namespace
+
     Engine::Engine(Scene* scene) : scene_(scene)
     {
     }
@@ -33,6 +45,8 @@ namespace gpr5300
             using seconds = std::chrono::duration<float, std::ratio<1, 1>>;
             const auto dt = std::chrono::duration_cast<seconds>(start - clock);
             clock = start;
+            FrameArena::Default().Reset();
+            StreamBuffer::Default().BeginFrame();
 
             //Manage SDL event
             SDL_Event event;
@@ -103,11 +117,39 @@ namespace gpr5300
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+            StreamBuffer::Default().EndFrame();
             SDL_GL_SwapWindow(window_);
+            EndFrameAllocations();
         }
         End();
     }
 
+    void Engine::EndFrameAllocations()
+    {
+        AllocationTracker& tracker = AllocationTracker::Default();
+        tracker.EndFrame();
+        const AllocationCounters& frame = tracker.last_frame();
+#ifdef TRACY_ENABLE
+        TracyPlot("Heap allocations", static_cast<int64_t>(frame.count));
+        TracyPlot("Heap bytes", static_cast<int64_t>(frame.bytes));
+        TracyPlot("Frame arena bytes", static_cast<int64_t>(FrameArena::Default().used()));
+        TracyPlot("Stream buffer bytes", static_cast<int64_t>(StreamBuffer::Default().last_frame_bytes()));
+#endif
+        if (!scene_->IsSteadyState())
+        {
+            steady_frames_ = 0;
+            return;
+        }
+        if (++steady_frames_ <= kSteadyStateWarmupFrames || frame.count == 0)
+        {
+            return;
+        }
+        std::cerr << "ERROR::ENGINE::FRAME_ALLOCATIONS " << frame.count << " allocations (" << frame.bytes
+                  << " bytes) on the render thread in steady state\n";
+        assert(false && "Steady-state frames must not allocate from the general heap");
+        steady_frames_ = 0;
+    }
+
     void Engine::Begin()
     {
         SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER);
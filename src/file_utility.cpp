@@ -1,19 +1,139 @@
 #include "file_utility.h"
-#include <fstream>
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace gpr5300
 {
 std::string LoadFile(std::string_view path)
 {
-    std::string content;
-    std::ifstream t(path.data());
+    const MappedFile file{std::string(path)};
+    return std::string(file.text());
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
 
-    t.seekg(0, std::ios::end);
-    content.reserve(t.tellg());
-    t.seekg(0, std::ios::beg);
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
 
-    content.assign((std::istreambuf_iterator<char>(t)),
-        std::istreambuf_iterator<char>());
-    return content;
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(open_, other.open_);
+#ifdef _WIN32
+    std::swap(file_handle_, other.file_handle_);
+    std::swap(mapping_handle_, other.mapping_handle_);
+#endif
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    file_handle_ = file;
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        Close();
+        return false;
+    }
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+    if (size_ > 0)
+    {
+        // Windows refuses to map empty files
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            Close();
+            return false;
+        }
+        mapping_handle_ = mapping;
+        data_ = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!data_)
+        {
+            Close();
+            return false;
+        }
+    }
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    struct stat file_stat{};
+    if (fstat(file, &file_stat) != 0)
+    {
+        close(file);
+        return false;
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    if (size_ > 0)
+    {
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped == MAP_FAILED)
+        {
+            close(file);
+            size_ = 0;
+            return false;
+        }
+        data_ = static_cast<const std::byte*>(mapped);
+    }
+    close(file);
+#endif
+    open_ = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_handle_)
+    {
+        CloseHandle(mapping_handle_);
+    }
+    if (file_handle_)
+    {
+        CloseHandle(file_handle_);
+    }
+    file_handle_ = nullptr;
+    mapping_handle_ = nullptr;
+#else
+    if (data_)
+    {
+        munmap(const_cast<std::byte*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
 }
 } // namespace gpr5300
@@ -0,0 +1,80 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdint>
+
+namespace gpr5300
+{
+
+FrameArena::FrameArena(const std::size_t capacity)
+    : block_(std::make_unique<std::byte[]>(capacity)), capacity_(capacity)
+{
+}
+
+FrameArena::~FrameArena()
+{
+  Reset();
+}
+
+FrameArena& FrameArena::Default()
+{
+  static FrameArena arena;
+  return arena;
+}
+
+void* FrameArena::Allocate(const std::size_t size, const std::size_t alignment)
+{
+  const auto base = reinterpret_cast<std::uintptr_t>(block_.get());
+  const std::size_t aligned = (base + offset_ + alignment - 1) / alignment * alignment - base;
+  if (aligned + size <= capacity_)
+  {
+    offset_ = aligned + size;
+    return block_.get() + aligned;
+  }
+  // Out of room: heap block released by the next Reset, which grows the arena
+  const auto block_alignment = std::align_val_t(std::max(alignment, alignof(std::max_align_t)));
+  void* block = ::operator new(size, block_alignment);
+  overflow_blocks_.emplace_back(block, block_alignment);
+  overflow_bytes_ += size + alignment;
+  return block;
+}
+
+std::string_view FrameArena::Format(const char* format, ...)
+{
+  std::va_list args;
+  va_start(args, format);
+  std::va_list measure;
+  va_copy(measure, args);
+  const int length = std::vsnprintf(nullptr, 0, format, measure);
+  va_end(measure);
+  if (length < 0)
+  {
+    va_end(args);
+    return {};
+  }
+  auto* text = static_cast<char*>(Allocate(static_cast<std::size_t>(length) + 1, 1));
+  std::vsnprintf(text, static_cast<std::size_t>(length) + 1, format, args);
+  va_end(args);
+  return {text, static_cast<std::size_t>(length)};
+}
+
+void FrameArena::Reset()
+{
+  for (const auto& [block, alignment] : overflow_blocks_)
+  {
+    ::operator delete(block, alignment);
+  }
+  overflow_blocks_.clear();
+  if (overflow_bytes_ > 0)
+  {
+    capacity_ = std::max(capacity_ * 2, offset_ + overflow_bytes_);
+    block_ = std::make_unique<std::byte[]>(capacity_);
+  }
+  last_overflow_bytes_ = overflow_bytes_;
+  overflow_bytes_ = 0;
+  offset_ = 0;
+}
+
+} // namespace gpr5300
@@ -0,0 +1,58 @@
+#include "frame_uniforms.h"
+
+#include <algorithm>
+#include <GL/glew.h>
+
+#include "stream_buffer.h"
+
+void BindFrameUniformBlocks(const unsigned int program)
+{
+  if (const GLuint block = glGetUniformBlockIndex(program, "FrameData"); block != GL_INVALID_INDEX)
+  {
+    glUniformBlockBinding(program, block, kFrameDataBinding);
+  }
+  if (const GLuint block = glGetUniformBlockIndex(program, "LightData"); block != GL_INVALID_INDEX)
+  {
+    glUniformBlockBinding(program, block, kLightDataBinding);
+  }
+}
+
+void FrameUniforms::Update(const FrameData& frame, const LightData& lights)
+{
+  StreamBuffer& stream = StreamBuffer::Default();
+  const StreamBuffer::Slice<FrameData> frame_slice = stream.PushUniform(frame);
+  const StreamBuffer::Slice<LightData> light_slice = stream.PushUniform(lights);
+  if (!frame_slice || !light_slice)
+  {
+    return;
+  }
+  glBindBufferRange(GL_UNIFORM_BUFFER, kFrameDataBinding, stream.buffer(), static_cast<GLintptr>(frame_slice.offset),
+                    sizeof(FrameData));
+  glBindBufferRange(GL_UNIFORM_BUFFER, kLightDataBinding, stream.buffer(), static_cast<GLintptr>(light_slice.offset),
+                    sizeof(LightData));
+}
+
+FrameData FrameUniforms::MakeFrameData(const glm::mat4& view, const glm::mat4& projection,
+                                       const glm::vec3& camera_position, const float time)
+{
+  FrameData frame{};
+  frame.view = view;
+  frame.projection = projection;
+  frame.view_projection = projection * view;
+  frame.camera_position = glm::vec4(camera_position, 1.0f);
+  frame.time = time;
+  return frame;
+}
+
+LightData FrameUniforms::MakeLightData(const std::span<const glm::vec3> positions,
+                                       const std::span<const glm::vec3> colors)
+{
+  LightData lights{};
+  lights.count = static_cast<int>(std::min({positions.size(), colors.size(), std::size_t{kMaxLights}}));
+  for (int i = 0; i < lights.count; i++)
+  {
+    lights.positions[i] = glm::vec4(positions[i], 1.0f);
+    lights.colors[i] = glm::vec4(colors[i], 1.0f);
+  }
+  return lights;
+}
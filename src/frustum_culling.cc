@@ -0,0 +1,297 @@
+#include "frustum_culling.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include "free_camera.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Plane of the frustum, normal pointing inward, with the box corner to test
+struct CullPlane
+{
+  float x, y, z, distance;
+  bool positive_x, positive_y, positive_z; // Take max rather than min on that axis
+};
+
+std::array<CullPlane, 6> MakeCullPlanes(const Frustum& frustum)
+{
+  std::array<CullPlane, 6> planes{};
+  for (std::size_t p = 0; p < planes.size(); p++)
+  {
+    const Plane& plane = frustum.planes()[p];
+    planes[p] = {plane.normal.x, plane.normal.y, plane.normal.z, plane.distance,
+                 plane.normal.x >= 0.0f, plane.normal.y >= 0.0f, plane.normal.z >= 0.0f};
+  }
+  return planes;
+}
+
+// Same operation order as glm::dot in the SIMD loops, so every path agrees
+bool IsAabbVisible(const std::array<CullPlane, 6>& planes, const AabbSoa& boxes, const std::size_t i)
+{
+  for (const CullPlane& plane : planes)
+  {
+    const float x = plane.positive_x ? boxes.max_x[i] : boxes.min_x[i];
+    const float y = plane.positive_y ? boxes.max_y[i] : boxes.min_y[i];
+    const float z = plane.positive_z ? boxes.max_z[i] : boxes.min_z[i];
+    if (plane.x * x + plane.y * y + plane.z * z < plane.distance)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsSphereVisible(const std::array<CullPlane, 6>& planes, const SphereSoa& spheres, const std::size_t i)
+{
+  for (const CullPlane& plane : planes)
+  {
+    const float dot = plane.x * spheres.center_x[i] + plane.y * spheres.center_y[i] + plane.z * spheres.center_z[i];
+    if (dot - plane.distance < -spheres.radius[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Calls sink(first, bits) for consecutive blocks of volumes: bit j of bits is
+// set when volume first + j is visible. Blocks never straddle a 64-bit word.
+template <typename Sink>
+void VisitAabbs(const Frustum& frustum, const AabbSoa& boxes, Sink&& sink)
+{
+  const std::array<CullPlane, 6> planes = MakeCullPlanes(frustum);
+  const std::size_t count = boxes.size();
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m256 min_x = _mm256_loadu_ps(boxes.min_x.data() + i);
+    const __m256 min_y = _mm256_loadu_ps(boxes.min_y.data() + i);
+    const __m256 min_z = _mm256_loadu_ps(boxes.min_z.data() + i);
+    const __m256 max_x = _mm256_loadu_ps(boxes.max_x.data() + i);
+    const __m256 max_y = _mm256_loadu_ps(boxes.max_y.data() + i);
+    const __m256 max_z = _mm256_loadu_ps(boxes.max_z.data() + i);
+    __m256 outside = _mm256_setzero_ps();
+    for (const CullPlane& plane : planes)
+    {
+      const __m256 dot = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), plane.positive_x ? max_x : min_x),
+                        _mm256_mul_ps(_mm256_set1_ps(plane.y), plane.positive_y ? max_y : min_y)),
+          _mm256_mul_ps(_mm256_set1_ps(plane.z), plane.positive_z ? max_z : min_z));
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(dot, _mm256_set1_ps(plane.distance), _CMP_LT_OQ));
+    }
+    sink(i, static_cast<std::uint32_t>(~_mm256_movemask_ps(outside)) & 0xFFu);
+  }
+#elif defined(FRUSTUM_CULLING_SSE2)
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m128 min_x = _mm_loadu_ps(boxes.min_x.data() + i);
+    const __m128 min_y = _mm_loadu_ps(boxes.min_y.data() + i);
+    const __m128 min_z = _mm_loadu_ps(boxes.min_z.data() + i);
+    const __m128 max_x = _mm_loadu_ps(boxes.max_x.data() + i);
+    const __m128 max_y = _mm_loadu_ps(boxes.max_y.data() + i);
+    const __m128 max_z = _mm_loadu_ps(boxes.max_z.data() + i);
+    __m128 outside = _mm_setzero_ps();
+    for (const CullPlane& plane : planes)
+    {
+      const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), plane.positive_x ? max_x : min_x),
+                                               _mm_mul_ps(_mm_set1_ps(plane.y), plane.positive_y ? max_y : min_y)),
+                                    _mm_mul_ps(_mm_set1_ps(plane.z), plane.positive_z ? max_z : min_z));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(dot, _mm_set1_ps(plane.distance)));
+    }
+    sink(i, static_cast<std::uint32_t>(~_mm_movemask_ps(outside)) & 0xFu);
+  }
+#endif
+  for (; i < count; i++)
+  {
+    sink(i, IsAabbVisible(planes, boxes, i) ? 1u : 0u);
+  }
+}
+
+template <typename Sink>
+void VisitSpheres(const Frustum& frustum, const SphereSoa& spheres, Sink&& sink)
+{
+  const std::array<CullPlane, 6> planes = MakeCullPlanes(frustum);
+  const std::size_t count = spheres.size();
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m256 center_x = _mm256_loadu_ps(spheres.center_x.data() + i);
+    const __m256 center_y = _mm256_loadu_ps(spheres.center_y.data() + i);
+    const __m256 center_z = _mm256_loadu_ps(spheres.center_z.data() + i);
+    const __m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius.data() + i));
+    __m256 outside = _mm256_setzero_ps();
+    for (const CullPlane& plane : planes)
+    {
+      const __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), center_x),
+                                                     _mm256_mul_ps(_mm256_set1_ps(plane.y), center_y)),
+                                       _mm256_mul_ps(_mm256_set1_ps(plane.z), center_z));
+      const __m256 distance = _mm256_sub_ps(dot, _mm256_set1_ps(plane.distance));
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negative_radius, _CMP_LT_OQ));
+    }
+    sink(i, static_cast<std::uint32_t>(~_mm256_movemask_ps(outside)) & 0xFFu);
+  }
+#elif defined(FRUSTUM_CULLING_SSE2)
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m128 center_x = _mm_loadu_ps(spheres.center_x.data() + i);
+    const __m128 center_y = _mm_loadu_ps(spheres.center_y.data() + i);
+    const __m128 center_z = _mm_loadu_ps(spheres.center_z.data() + i);
+    const __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+    __m128 outside = _mm_setzero_ps();
+    for (const CullPlane& plane : planes)
+    {
+      const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), center_x),
+                                               _mm_mul_ps(_mm_set1_ps(plane.y), center_y)),
+                                    _mm_mul_ps(_mm_set1_ps(plane.z), center_z));
+      const __m128 distance = _mm_sub_ps(dot, _mm_set1_ps(plane.distance));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_radius));
+    }
+    sink(i, static_cast<std::uint32_t>(~_mm_movemask_ps(outside)) & 0xFu);
+  }
+#endif
+  for (; i < count; i++)
+  {
+    sink(i, IsSphereVisible(planes, spheres, i) ? 1u : 0u);
+  }
+}
+
+// Sinks of the two output forms
+struct CullMaskSink
+{
+  std::span<std::uint64_t> visible;
+
+  void operator()(const std::size_t first, const std::uint32_t bits) const
+  {
+    visible[first / 64] |= static_cast<std::uint64_t>(bits) << (first % 64);
+  }
+};
+
+struct CullIndexSink
+{
+  std::span<std::uint32_t> visible;
+  std::size_t count = 0;
+
+  void operator()(const std::size_t first, std::uint32_t bits)
+  {
+    while (bits != 0)
+    {
+      visible[count++] = static_cast<std::uint32_t>(first) + static_cast<std::uint32_t>(std::countr_zero(bits));
+      bits &= bits - 1;
+    }
+  }
+};
+} // namespace
+
+void AabbSoa::Add(const glm::vec3& min, const glm::vec3& max)
+{
+  min_x.push_back(min.x);
+  min_y.push_back(min.y);
+  min_z.push_back(min.z);
+  max_x.push_back(max.x);
+  max_y.push_back(max.y);
+  max_z.push_back(max.z);
+}
+
+void AabbSoa::Clear()
+{
+  for (std::vector<float>* component : {&min_x, &min_y, &min_z, &max_x, &max_y, &max_z})
+  {
+    component->clear();
+  }
+}
+
+void AabbSoa::Reserve(const std::size_t count)
+{
+  for (std::vector<float>* component : {&min_x, &min_y, &min_z, &max_x, &max_y, &max_z})
+  {
+    component->reserve(count);
+  }
+}
+
+void AabbSoa::Resize(const std::size_t count)
+{
+  for (std::vector<float>* component : {&min_x, &min_y, &min_z, &max_x, &max_y, &max_z})
+  {
+    component->resize(count);
+  }
+}
+
+void SphereSoa::Add(const glm::vec3& center, const float sphere_radius)
+{
+  center_x.push_back(center.x);
+  center_y.push_back(center.y);
+  center_z.push_back(center.z);
+  radius.push_back(sphere_radius);
+}
+
+void SphereSoa::Clear()
+{
+  for (std::vector<float>* component : {&center_x, &center_y, &center_z, &radius})
+  {
+    component->clear();
+  }
+}
+
+void SphereSoa::Reserve(const std::size_t count)
+{
+  for (std::vector<float>* component : {&center_x, &center_y, &center_z, &radius})
+  {
+    component->reserve(count);
+  }
+}
+
+void SphereSoa::Resize(const std::size_t count)
+{
+  for (std::vector<float>* component : {&center_x, &center_y, &center_z, &radius})
+  {
+    component->resize(count);
+  }
+}
+
+void CullAabbs(const Frustum& frustum, const AabbSoa& boxes, const std::span<std::uint64_t> visible)
+{
+  std::fill_n(visible.begin(), VisibilityMaskWords(boxes.size()), 0);
+  VisitAabbs(frustum, boxes, CullMaskSink{visible});
+}
+
+void CullSpheres(const Frustum& frustum, const SphereSoa& spheres, const std::span<std::uint64_t> visible)
+{
+  std::fill_n(visible.begin(), VisibilityMaskWords(spheres.size()), 0);
+  VisitSpheres(frustum, spheres, CullMaskSink{visible});
+}
+
+std::size_t CullAabbs(const Frustum& frustum, const AabbSoa& boxes, const std::span<std::uint32_t> visible)
+{
+  CullIndexSink sink{visible};
+  VisitAabbs(frustum, boxes, sink);
+  return sink.count;
+}
+
+std::size_t CullSpheres(const Frustum& frustum, const SphereSoa& spheres, const std::span<std::uint32_t> visible)
+{
+  CullIndexSink sink{visible};
+  VisitSpheres(frustum, spheres, sink);
+  return sink.count;
+}
+
+const char* FrustumCullingIsa()
+{
+#if defined(__AVX2__)
+  return "AVX2";
+#elif defined(FRUSTUM_CULLING_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,389 @@
+#include "geometry_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <GL/glew.h>
+
+#include "mesh.h"
+
+namespace
+{
+// Sized for a few of the sample glTF scenes before the first growth
+constexpr std::size_t kInitialVertexCapacity = 1 << 20;
+constexpr std::size_t kInitialPackedVertexCapacity = 1 << 18;
+constexpr std::size_t kInitialIndexCapacity = 4 << 20;
+
+constexpr GLuint kVertexBinding = 0;
+constexpr GLuint kInstanceBinding = 1;
+
+// Replaces buffer with a larger copy and returns the new name
+GLuint ResizeBuffer(const GLuint buffer, const std::size_t old_bytes, const std::size_t new_bytes)
+{
+  GLuint resized = 0;
+  glCreateBuffers(1, &resized);
+  glNamedBufferStorage(resized, static_cast<GLsizeiptr>(new_bytes), nullptr, GL_DYNAMIC_STORAGE_BIT);
+  if (buffer != 0 && old_bytes > 0)
+  {
+    glCopyNamedBufferSubData(buffer, resized, 0, 0, static_cast<GLsizeiptr>(old_bytes));
+  }
+  glDeleteBuffers(1, &buffer);
+  return resized;
+}
+} // namespace
+
+FreeListAllocator::FreeListAllocator(const std::size_t capacity)
+{
+  Grow(capacity);
+}
+
+std::optional<std::size_t> FreeListAllocator::Allocate(const std::size_t size)
+{
+  if (size == 0)
+  {
+    return 0;
+  }
+  for (auto it = free_blocks_.begin(); it != free_blocks_.end(); ++it)
+  {
+    if (it->second < size)
+    {
+      continue;
+    }
+    const std::size_t offset = it->first;
+    const std::size_t remaining = it->second - size;
+    free_blocks_.erase(it);
+    if (remaining > 0)
+    {
+      free_blocks_.emplace(offset + size, remaining);
+    }
+    used_ += size;
+    return offset;
+  }
+  return std::nullopt;
+}
+
+void FreeListAllocator::Free(std::size_t offset, std::size_t size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+  used_ -= size;
+  auto next = free_blocks_.lower_bound(offset);
+  if (next != free_blocks_.begin())
+  {
+    const auto previous = std::prev(next);
+    if (previous->first + previous->second == offset)
+    {
+      offset = previous->first;
+      size += previous->second;
+      free_blocks_.erase(previous);
+    }
+  }
+  if (next != free_blocks_.end() && offset + size == next->first)
+  {
+    size += next->second;
+    free_blocks_.erase(next);
+  }
+  free_blocks_.emplace(offset, size);
+}
+
+void FreeListAllocator::Grow(const std::size_t new_capacity)
+{
+  if (new_capacity <= capacity_)
+  {
+    return;
+  }
+  const std::size_t added = new_capacity - capacity_;
+  const std::size_t offset = capacity_;
+  capacity_ = new_capacity;
+  used_ += added; // Free() takes it back out
+  Free(offset, added);
+}
+
+unsigned int GeometryAllocation::index_type() const
+{
+  return index_size_ == sizeof(std::uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+GeometryAllocation::~GeometryAllocation()
+{
+  if (*this)
+  {
+    GeometryArena::Default().Release(*this);
+  }
+}
+
+GeometryAllocation::GeometryAllocation(GeometryAllocation&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+GeometryAllocation& GeometryAllocation::operator=(GeometryAllocation&& other) noexcept
+{
+  std::swap(vertex_offset_, other.vertex_offset_);
+  std::swap(vertex_count_, other.vertex_count_);
+  std::swap(index_offset_, other.index_offset_);
+  std::swap(index_count_, other.index_count_);
+  std::swap(index_size_, other.index_size_);
+  std::swap(vertex_format_, other.vertex_format_);
+  return *this;
+}
+
+GeometryArena& GeometryArena::Default()
+{
+  // Never destroyed: the GL context is gone by the time statics are torn down.
+  static auto* arena =
+      new GeometryArena(kInitialVertexCapacity, kInitialPackedVertexCapacity, kInitialIndexCapacity);
+  return *arena;
+}
+
+GeometryArena::GeometryArena(const std::size_t vertex_capacity, const std::size_t packed_vertex_capacity,
+                             const std::size_t index_capacity)
+{
+  const std::size_t capacities[kVertexFormatCount] = {vertex_capacity, packed_vertex_capacity};
+  const std::size_t strides[kVertexFormatCount] = {sizeof(Vertex), sizeof(PackedVertex)};
+  for (std::size_t i = 0; i < kVertexFormatCount; i++)
+  {
+    VertexPool& pool = vertex_pools_[i];
+    pool.stride = strides[i];
+    pool.buffer = ResizeBuffer(0, 0, capacities[i] * pool.stride);
+    pool.allocator.Grow(capacities[i]);
+  }
+  index_buffer_ = ResizeBuffer(0, 0, index_capacity * sizeof(std::uint32_t));
+  indices_.Grow(index_capacity);
+
+  for (std::size_t i = 0; i < kVertexFormatCount; i++)
+  {
+    vaos_[i] = CreateVertexArray(static_cast<VertexFormat>(i), true);
+  }
+}
+
+GeometryArena::~GeometryArena()
+{
+  for (const InstancedVao& instanced : instanced_vaos_)
+  {
+    glDeleteVertexArrays(1, &instanced.vao);
+  }
+  glDeleteVertexArrays(static_cast<GLsizei>(kVertexFormatCount), vaos_);
+  for (const VertexPool& pool : vertex_pools_)
+  {
+    glDeleteBuffers(1, &pool.buffer);
+  }
+  glDeleteBuffers(1, &index_buffer_);
+}
+
+GeometryAllocation GeometryArena::Allocate(const std::span<const Vertex> vertices,
+                                           const std::span<const unsigned int> indices)
+{
+  return Allocate(VertexFormat::kFloat, vertices.data(), vertices.size(), indices);
+}
+
+GeometryAllocation GeometryArena::Allocate(const std::span<const PackedVertex> vertices,
+                                           const std::span<const unsigned int> indices)
+{
+  return Allocate(VertexFormat::kPacked, vertices.data(), vertices.size(), indices);
+}
+
+GeometryAllocation GeometryArena::Allocate(const VertexFormat format, const void* vertices,
+                                           const std::size_t vertex_count, const std::span<const unsigned int> indices)
+{
+  GeometryAllocation allocation;
+  if (vertex_count == 0 && indices.empty())
+  {
+    return allocation;
+  }
+
+  VertexPool& pool = vertex_pools_[static_cast<std::size_t>(format)];
+  std::optional<std::size_t> vertex_offset = pool.allocator.Allocate(vertex_count);
+  if (!vertex_offset)
+  {
+    Grow(pool.allocator, pool.buffer, pool.stride, vertex_count);
+    vertex_offset = pool.allocator.Allocate(vertex_count);
+  }
+  allocation.vertex_offset_ = *vertex_offset;
+  allocation.vertex_count_ = vertex_count;
+  allocation.vertex_format_ = format;
+  if (vertex_count > 0)
+  {
+    glNamedBufferSubData(pool.buffer, static_cast<GLintptr>(*vertex_offset * pool.stride),
+                         static_cast<GLsizeiptr>(vertex_count * pool.stride), vertices);
+  }
+  WriteIndices(allocation, indices);
+  return allocation;
+}
+
+GeometryAllocation GeometryArena::AllocateIndices(const GeometryAllocation& base,
+                                                  const std::span<const unsigned int> indices)
+{
+  GeometryAllocation allocation;
+  if (indices.empty())
+  {
+    return allocation;
+  }
+  allocation.vertex_offset_ = base.vertex_offset_;
+  allocation.vertex_format_ = base.vertex_format_;
+  WriteIndices(allocation, indices);
+  return allocation;
+}
+
+void GeometryArena::WriteIndices(GeometryAllocation& allocation, const std::span<const unsigned int> indices)
+{
+  // Base-vertex-relative indices narrow to 16 bits whenever they all fit
+  const bool short_indices = !indices.empty() && std::ranges::max(indices) <= 0xFFFF;
+  allocation.index_size_ = short_indices ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+  allocation.index_count_ = indices.size();
+  const std::size_t index_words = allocation.index_words();
+  std::optional<std::size_t> index_offset = indices_.Allocate(index_words);
+  if (!index_offset)
+  {
+    Grow(indices_, index_buffer_, sizeof(std::uint32_t), index_words);
+    index_offset = indices_.Allocate(index_words);
+  }
+  allocation.index_offset_ = *index_offset;
+
+  const auto index_byte_offset = static_cast<GLintptr>(*index_offset * sizeof(std::uint32_t));
+  if (short_indices)
+  {
+    const std::vector<std::uint16_t> narrowed(indices.begin(), indices.end());
+    glNamedBufferSubData(index_buffer_, index_byte_offset,
+                         static_cast<GLsizeiptr>(narrowed.size() * sizeof(std::uint16_t)), narrowed.data());
+  }
+  else if (!indices.empty())
+  {
+    glNamedBufferSubData(index_buffer_, index_byte_offset, static_cast<GLsizeiptr>(indices.size_bytes()),
+                         indices.data());
+  }
+}
+
+unsigned int GeometryArena::CreateInstancedVao(const unsigned int instance_buffer, const VertexFormat format)
+{
+  // Locations 3 to 6 replace the tangent
+  const GLuint vao = CreateVertexArray(format, false);
+  // One mat4 per instance, a column per location
+  for (GLuint column = 0; column < 4; column++)
+  {
+    const GLuint location = 3 + column;
+    glEnableVertexArrayAttrib(vao, location);
+    glVertexArrayAttribFormat(vao, location, 4, GL_FLOAT, GL_FALSE, column * sizeof(glm::vec4));
+    glVertexArrayAttribBinding(vao, location, kInstanceBinding);
+  }
+  glVertexArrayVertexBuffer(vao, kInstanceBinding, instance_buffer, 0, sizeof(glm::mat4));
+  glVertexArrayBindingDivisor(vao, kInstanceBinding, 1);
+  instanced_vaos_.push_back({vao, format});
+  return vao;
+}
+
+unsigned int GeometryArena::CreateDrawIdVao(const unsigned int draw_id_buffer, const VertexFormat format)
+{
+  const GLuint vao = CreateVertexArray(format, true);
+  glEnableVertexArrayAttrib(vao, kDrawIdLocation);
+  glVertexArrayAttribIFormat(vao, kDrawIdLocation, 1, GL_UNSIGNED_INT, 0);
+  glVertexArrayAttribBinding(vao, kDrawIdLocation, kInstanceBinding);
+  glVertexArrayVertexBuffer(vao, kInstanceBinding, draw_id_buffer, 0, sizeof(std::uint32_t));
+  glVertexArrayBindingDivisor(vao, kInstanceBinding, 1);
+  instanced_vaos_.push_back({vao, format});
+  return vao;
+}
+
+void GeometryArena::DeleteVao(const unsigned int vao)
+{
+  const auto it = std::ranges::find(instanced_vaos_, vao, &InstancedVao::vao);
+  if (it == instanced_vaos_.end())
+  {
+    return;
+  }
+  instanced_vaos_.erase(it);
+  glDeleteVertexArrays(1, &vao);
+}
+
+std::size_t GeometryArena::used_bytes() const
+{
+  std::size_t bytes = indices_.used() * sizeof(std::uint32_t);
+  for (const VertexPool& pool : vertex_pools_)
+  {
+    bytes += pool.allocator.used() * pool.stride;
+  }
+  return bytes;
+}
+
+std::size_t GeometryArena::capacity_bytes() const
+{
+  std::size_t bytes = indices_.capacity() * sizeof(std::uint32_t);
+  for (const VertexPool& pool : vertex_pools_)
+  {
+    bytes += pool.allocator.capacity() * pool.stride;
+  }
+  return bytes;
+}
+
+void GeometryArena::Release(const GeometryAllocation& allocation)
+{
+  vertex_pools_[static_cast<std::size_t>(allocation.vertex_format_)].allocator.Free(allocation.vertex_offset_,
+                                                                                    allocation.vertex_count_);
+  indices_.Free(allocation.index_offset_, allocation.index_words());
+}
+
+void GeometryArena::Grow(FreeListAllocator& allocator, unsigned int& buffer, const std::size_t stride,
+                         const std::size_t request)
+{
+  // The new tail alone fits the request, whatever the fragmentation
+  const std::size_t capacity = std::max(allocator.capacity() * 2, allocator.capacity() + request);
+  buffer = ResizeBuffer(buffer, allocator.capacity() * stride, capacity * stride);
+  allocator.Grow(capacity);
+  for (std::size_t i = 0; i < kVertexFormatCount; i++)
+  {
+    AttachBuffers(vaos_[i], static_cast<VertexFormat>(i));
+  }
+  for (const InstancedVao& instanced : instanced_vaos_)
+  {
+    AttachBuffers(instanced.vao, instanced.format);
+  }
+}
+
+unsigned int GeometryArena::CreateVertexArray(const VertexFormat format, const bool tangent) const
+{
+  GLuint vao = 0;
+  glCreateVertexArrays(1, &vao);
+  glEnableVertexArrayAttrib(vao, 0);
+  glEnableVertexArrayAttrib(vao, 1);
+  glEnableVertexArrayAttrib(vao, 2);
+  if (tangent)
+  {
+    glEnableVertexArrayAttrib(vao, 3);
+  }
+  if (format == VertexFormat::kPacked)
+  {
+    // Half floats and signed normalized 10:10:10:2 reach the shader as floats
+    glVertexArrayAttribFormat(vao, 0, 3, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, position));
+    glVertexArrayAttribFormat(vao, 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, normal));
+    glVertexArrayAttribFormat(vao, 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, tex_coords));
+    if (tangent)
+    {
+      glVertexArrayAttribFormat(vao, 3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, tangent));
+    }
+  }
+  else
+  {
+    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+    glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+    glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
+    if (tangent)
+    {
+      glVertexArrayAttribFormat(vao, 3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent));
+    }
+  }
+  for (GLuint location = 0; location < (tangent ? 4u : 3u); location++)
+  {
+    glVertexArrayAttribBinding(vao, location, kVertexBinding);
+  }
+  AttachBuffers(vao, format);
+  return vao;
+}
+
+void GeometryArena::AttachBuffers(const unsigned int vao, const VertexFormat format) const
+{
+  const VertexPool& pool = vertex_pools_[static_cast<std::size_t>(format)];
+  glVertexArrayVertexBuffer(vao, kVertexBinding, pool.buffer, 0, static_cast<GLsizei>(pool.stride));
+  glVertexArrayElementBuffer(vao, index_buffer_);
+}
@@ -0,0 +1,19 @@
+#include "hash_utility.h"
+
+#include "file_utility.h"
+
+namespace gpr5300
+{
+
+std::uint64_t HashFile(const std::string& path)
+{
+  const MappedFile file(path);
+  if (!file.is_open())
+  {
+    return 0;
+  }
+  const std::uint64_t hash = HashBytes(kFnvOffsetBasis, file.bytes().data(), file.size());
+  return hash == 0 ? 1 : hash;
+}
+
+} // namespace gpr5300
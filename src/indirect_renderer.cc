@@ -0,0 +1,212 @@
+#include "indirect_renderer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <GL/glew.h>
+
+#include "bounds.h"
+#include "free_camera.h"
+#include "geometry_arena.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+#include "stream_buffer.h"
+
+namespace
+{
+constexpr std::size_t kInitialDrawCapacity = 256;
+
+// Same textures bound to the same samplers and the same VAO
+bool SameMaterial(const Mesh& a, const Mesh& b)
+{
+  return a.vertex_format() == b.vertex_format() &&
+         std::ranges::equal(a.textures_, b.textures_, [](const Texture& lhs, const Texture& rhs) {
+    return lhs.id == rhs.id && lhs.type == rhs.type;
+  });
+}
+} // namespace
+
+void IndirectRenderer::Create()
+{
+  glCreateBuffers(1, &draw_id_buffer_);
+  Reserve(kInitialDrawCapacity);
+  for (std::size_t i = 0; i < kVertexFormatCount; i++)
+  {
+    vaos_[i] = GeometryArena::Default().CreateDrawIdVao(draw_id_buffer_, static_cast<VertexFormat>(i));
+  }
+}
+
+void IndirectRenderer::Delete()
+{
+  for (unsigned int& vao : vaos_)
+  {
+    GeometryArena::Default().DeleteVao(vao);
+    vao = 0;
+  }
+  glDeleteBuffers(1, &draw_id_buffer_);
+  draw_id_buffer_ = 0;
+  capacity_ = 0;
+}
+
+void IndirectRenderer::Clear()
+{
+  queued_.clear();
+  ranges_.clear();
+  buckets_.clear();
+  cull_stats_ = {};
+}
+
+void IndirectRenderer::SetLodSelection(const LodSelector& selector, const glm::vec3& camera_position)
+{
+  lod_selector_ = selector;
+  camera_position_ = camera_position;
+}
+
+void IndirectRenderer::SetMeshletCulling(const Frustum* frustum, const glm::vec3& camera_position)
+{
+  frustum_ = frustum;
+  cull_camera_position_ = camera_position;
+}
+
+void IndirectRenderer::Add(const Model& model, const glm::mat4& transform)
+{
+  for (const Mesh& mesh : model.meshes())
+  {
+    Add(mesh, transform);
+  }
+}
+
+void IndirectRenderer::Add(const Mesh& mesh, const glm::mat4& transform)
+{
+  if (mesh.geometry().index_count() == 0)
+  {
+    return;
+  }
+  const auto lod = static_cast<std::uint32_t>(mesh.SelectLod(lod_selector_, transform, camera_position_));
+  const GeometryAllocation& geometry = mesh.geometry(lod);
+  const auto first_range = static_cast<std::uint32_t>(ranges_.size());
+  if (frustum_ == nullptr)
+  {
+    ranges_.push_back({0, static_cast<std::uint32_t>(geometry.index_count())});
+  }
+  else
+  {
+    const BoundingSphere bounds = TransformSphere(transform, mesh.bounding_sphere());
+    MeshletCullStats stats;
+    if (!frustum_->IsSphereInFrustum(Sphere(bounds.center, bounds.radius)))
+    {
+      stats.meshlet_count = mesh.meshlets().size();
+      stats.triangle_count = geometry.index_count() / 3;
+    }
+    else if (lod == 0 && !mesh.meshlets().empty())
+    {
+      stats = CullMeshlets(mesh.meshlets(), transform, *frustum_, cull_camera_position_, ranges_);
+    }
+    else
+    {
+      ranges_.push_back({0, static_cast<std::uint32_t>(geometry.index_count())});
+      stats.triangle_count = stats.visible_triangle_count = geometry.index_count() / 3;
+    }
+    cull_stats_ += stats;
+  }
+  const auto range_count = static_cast<std::uint32_t>(ranges_.size()) - first_range;
+  if (range_count == 0)
+  {
+    return;
+  }
+  queued_.push_back(
+      {&mesh, transform, FindMaterial(mesh, geometry.index_type(), range_count), lod, first_range, range_count});
+}
+
+std::uint32_t IndirectRenderer::FindMaterial(const Mesh& mesh, const unsigned int index_type,
+                                             const std::uint32_t command_count)
+{
+  // A scene has a handful of materials, a linear scan beats hashing texture lists
+  for (std::uint32_t i = 0; i < buckets_.size(); i++)
+  {
+    if (buckets_[i].index_type == index_type &&
+        (buckets_[i].material == &mesh || SameMaterial(*buckets_[i].material, mesh)))
+    {
+      buckets_[i].command_count += command_count;
+      return i;
+    }
+  }
+  buckets_.push_back({&mesh, index_type, 0, command_count});
+  return static_cast<std::uint32_t>(buckets_.size() - 1);
+}
+
+void IndirectRenderer::Submit(const Shader& shader)
+{
+  draw_calls_ = 0;
+  command_count_ = 0;
+  if (queued_.empty())
+  {
+    return;
+  }
+
+  // Counting sort of the draws by material: each bucket becomes one contiguous command range
+  std::uint32_t first_command = 0;
+  for (Bucket& bucket : buckets_)
+  {
+    bucket.first_command = first_command;
+    first_command += bucket.command_count;
+  }
+
+  // Written straight into this frame's mapped stream memory
+  StreamBuffer& stream = StreamBuffer::Default();
+  const StreamBuffer::Slice<DrawElementsIndirectCommand> commands =
+      stream.Allocate<DrawElementsIndirectCommand>(first_command);
+  const StreamBuffer::Slice<DrawRecord> records =
+      stream.Allocate<DrawRecord>(queued_.size(), stream.storage_alignment());
+  if (!commands || !records)
+  {
+    return;
+  }
+  command_count_ = first_command;
+  cursors_.resize(buckets_.size());
+  std::ranges::transform(buckets_, cursors_.begin(), &Bucket::first_command);
+  for (std::uint32_t record = 0; record < queued_.size(); record++)
+  {
+    const QueuedDraw& draw = queued_[record];
+    const GeometryAllocation& geometry = draw.mesh->geometry(draw.lod);
+    for (std::uint32_t r = draw.first_range; r < draw.first_range + draw.range_count; r++)
+    {
+      const std::uint32_t index = cursors_[draw.material]++;
+      commands.data[index] = {ranges_[r].index_count, 1,
+                          static_cast<std::uint32_t>(geometry.first_index()) + ranges_[r].first_index,
+                          geometry.base_vertex(), record};
+    }
+    records.data[record] = {draw.transform, draw.material, {}};
+  }
+
+  Reserve(queued_.size());
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.buffer());
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, kDrawRecordBinding, stream.buffer(),
+                    static_cast<GLintptr>(records.offset), static_cast<GLsizeiptr>(records.size_bytes()));
+  for (const Bucket& bucket : buckets_)
+  {
+    glBindVertexArray(vaos_[static_cast<std::size_t>(bucket.material->vertex_format())]);
+    bucket.material->BindTextures(shader);
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, bucket.index_type,
+        reinterpret_cast<const void*>(commands.offset + bucket.first_command * sizeof(DrawElementsIndirectCommand)),
+        static_cast<GLsizei>(bucket.command_count), 0);
+    draw_calls_++;
+  }
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+void IndirectRenderer::Reserve(const std::size_t count)
+{
+  if (count <= capacity_)
+  {
+    return;
+  }
+  capacity_ = std::max(count, capacity_ * 2);
+  // Draw ids never change: element i holds i
+  std::vector<std::uint32_t> draw_ids(capacity_);
+  std::iota(draw_ids.begin(), draw_ids.end(), 0u);
+  glNamedBufferData(draw_id_buffer_, static_cast<GLsizeiptr>(draw_ids.size() * sizeof(std::uint32_t)),
+                    draw_ids.data(), GL_STATIC_DRAW);
+}
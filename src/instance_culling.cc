@@ -0,0 +1,88 @@
+#include "instance_culling.h"
+
+#include <algorithm>
+
+#include "free_camera.h"
+#include "thread_pool.h"
+
+namespace
+{
+template <typename Body>
+void ForEachChunk(gpr5300::ThreadPool* pool, const std::size_t count, Body&& body)
+{
+  if (pool != nullptr)
+  {
+    pool->ParallelFor(count, body);
+    return;
+  }
+  for (std::size_t i = 0; i < count; i++)
+  {
+    body(i);
+  }
+}
+} // namespace
+
+std::span<const std::uint32_t> InstanceCuller::Cull(const Frustum& frustum, const std::span<const glm::mat4> transforms,
+                                                    const BoundingSphere& local_sphere, gpr5300::ThreadPool* pool)
+{
+  const std::size_t count = transforms.size();
+  const std::size_t chunk_count = (count + kChunkSize - 1) / kChunkSize;
+  if (chunks_.size() < chunk_count)
+  {
+    chunks_.resize(chunk_count);
+  }
+  if (visible_.size() < count)
+  {
+    visible_.resize(count);
+  }
+
+  ForEachChunk(pool, chunk_count, [&](const std::size_t c) {
+    Chunk& chunk = chunks_[c];
+    const std::size_t first = c * kChunkSize;
+    const std::size_t size = std::min(kChunkSize, count - first);
+    chunk.spheres.Resize(size);
+    for (std::size_t i = 0; i < size; i++)
+    {
+      const BoundingSphere sphere = TransformSphere(transforms[first + i], local_sphere);
+      chunk.spheres.center_x[i] = sphere.center.x;
+      chunk.spheres.center_y[i] = sphere.center.y;
+      chunk.spheres.center_z[i] = sphere.center.z;
+      chunk.spheres.radius[i] = sphere.radius;
+    }
+    if (chunk.visible.size() < size)
+    {
+      chunk.visible.resize(size);
+    }
+    chunk.visible_count = CullSpheres(frustum, chunk.spheres, std::span(chunk.visible));
+  });
+
+  visible_count_ = 0;
+  for (std::size_t c = 0; c < chunk_count; c++)
+  {
+    chunks_[c].first_output = visible_count_;
+    visible_count_ += chunks_[c].visible_count;
+  }
+
+  ForEachChunk(pool, chunk_count, [&](const std::size_t c) {
+    const Chunk& chunk = chunks_[c];
+    const auto first = static_cast<std::uint32_t>(c * kChunkSize);
+    for (std::size_t i = 0; i < chunk.visible_count; i++)
+    {
+      visible_[chunk.first_output + i] = first + chunk.visible[i];
+    }
+  });
+  return visible();
+}
+
+void InstanceCuller::Compact(const std::span<const glm::mat4> transforms, const std::span<glm::mat4> out,
+                             gpr5300::ThreadPool* pool) const
+{
+  const std::size_t chunk_count = (transforms.size() + kChunkSize - 1) / kChunkSize;
+  ForEachChunk(pool, std::min(chunk_count, chunks_.size()), [&](const std::size_t c) {
+    const Chunk& chunk = chunks_[c];
+    for (std::size_t i = chunk.first_output; i < chunk.first_output + chunk.visible_count; i++)
+    {
+      out[i] = transforms[visible_[i]];
+    }
+  });
+}
@@ -0,0 +1,80 @@
+#include "mapped_io_system.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include "file_utility.h"
+
+namespace gpr5300
+{
+namespace
+{
+class MappedIOStream final : public Assimp::IOStream
+{
+ public:
+  explicit MappedIOStream(MappedFile file) : file_(std::move(file)) {}
+
+  size_t Read(void* buffer, const size_t size, const size_t count) override
+  {
+    if (size == 0)
+    {
+      return 0;
+    }
+    const size_t available = (file_.size() - position_) / size;
+    const size_t read = std::min(count, available);
+    std::memcpy(buffer, file_.bytes().data() + position_, read * size);
+    position_ += read * size;
+    return read;
+  }
+
+  size_t Write(const void*, size_t, size_t) override { return 0; }
+
+  // Same meaning as fseek: importers pass negative offsets cast to size_t, so
+  // the unsigned sums wrap back into the file, and a target before its start
+  // wraps past its end and fails the bounds check
+  aiReturn Seek(const size_t offset, const aiOrigin origin) override
+  {
+    size_t target = offset;
+    if (origin == aiOrigin_CUR)
+    {
+      target = position_ + offset;
+    }
+    else if (origin == aiOrigin_END)
+    {
+      target = file_.size() + offset;
+    }
+    if (target > file_.size())
+    {
+      return aiReturn_FAILURE;
+    }
+    position_ = target;
+    return aiReturn_SUCCESS;
+  }
+
+  [[nodiscard]] size_t Tell() const override { return position_; }
+  [[nodiscard]] size_t FileSize() const override { return file_.size(); }
+  void Flush() override {}
+
+ private:
+  MappedFile file_;
+  size_t position_ = 0;
+};
+} // namespace
+
+Assimp::IOStream* MappedIOSystem::Open(const char* file, const char* mode)
+{
+  if (std::string_view(mode).find_first_of("wa+") != std::string_view::npos)
+  {
+    return DefaultIOSystem::Open(file, mode);
+  }
+  MappedFile mapped;
+  if (!mapped.Open(file))
+  {
+    return nullptr;
+  }
+  return new MappedIOStream(std::move(mapped));
+}
+
+} // namespace gpr5300
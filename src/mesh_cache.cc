@@ -0,0 +1,410 @@
+#include "mesh_cache.h"
+#include "hash_utility.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_trivially_copyable_v<Vertex>, "Vertex must be trivially copyable to be baked");
+static_assert(std::is_trivially_copyable_v<Meshlet>, "Meshlet must be trivially copyable to be baked");
+
+namespace
+{
+constexpr char kMeshCacheMagic[8] = {'S', '3', 'D', 'M', 'E', 'S', 'H', '\0'};
+constexpr std::size_t kMeshCacheAlignment = 16;
+
+constexpr std::size_t AlignUp(std::size_t value)
+{
+  return (value + kMeshCacheAlignment - 1) & ~(kMeshCacheAlignment - 1);
+}
+
+struct MeshCacheLayout
+{
+  std::size_t meshes = 0;
+  std::size_t materials = 0;
+  std::size_t bindings = 0;
+  std::size_t strings = 0;
+  std::size_t vertices = 0;
+  std::size_t indices = 0;
+  std::size_t meshlets = 0;
+  std::size_t total = 0;
+};
+
+MeshCacheLayout ComputeLayout(const MeshCacheHeader& header)
+{
+  MeshCacheLayout layout;
+  layout.meshes = AlignUp(sizeof(MeshCacheHeader));
+  layout.materials = AlignUp(layout.meshes + header.mesh_count * sizeof(MeshCacheMeshRecord));
+  layout.bindings = AlignUp(layout.materials + header.material_count * sizeof(MeshCacheMaterialRecord));
+  layout.strings = AlignUp(layout.bindings + header.binding_count * sizeof(MeshCacheBindingRecord));
+  layout.vertices = AlignUp(layout.strings + header.string_bytes);
+  layout.indices = AlignUp(layout.vertices + header.vertex_count * sizeof(Vertex));
+  layout.meshlets = AlignUp(layout.indices + header.index_count * sizeof(unsigned int));
+  layout.total = layout.meshlets + header.meshlet_count * sizeof(Meshlet);
+  return layout;
+}
+} // namespace
+
+std::uint64_t ComputeMeshCacheKey(const std::string& source_path, const unsigned int import_flags)
+{
+  namespace fs = std::filesystem;
+
+  const gpr5300::MappedFile source(source_path);
+  if (!source.is_open())
+  {
+    return 0;
+  }
+
+  std::uint64_t hash = gpr5300::kFnvOffsetBasis;
+  hash = gpr5300::HashValue(hash, kMeshCacheVersion);
+  hash = gpr5300::HashValue(hash, import_flags);
+  hash = gpr5300::HashBytes(hash, source.bytes().data(), source.size());
+
+  // glTF geometry lives in external .bin buffers; hashing them fully would cost
+  // as much as the import, so their size and timestamp stand in for the content.
+  std::error_code error;
+  const fs::path directory = fs::path(source_path).parent_path();
+  std::vector<fs::directory_entry> buffers;
+  for (const auto& entry : fs::directory_iterator(directory.empty() ? fs::path(".") : directory, error))
+  {
+    if (entry.is_regular_file(error) && entry.path().extension() == ".bin")
+    {
+      buffers.push_back(entry);
+    }
+  }
+  std::ranges::sort(buffers, {}, [](const fs::directory_entry& entry) { return entry.path(); });
+  for (const auto& entry : buffers)
+  {
+    const std::string name = entry.path().filename().string();
+    hash = gpr5300::HashBytes(hash, name.data(), name.size());
+    hash = gpr5300::HashValue(hash, static_cast<std::uint64_t>(entry.file_size(error)));
+    hash = gpr5300::HashValue(hash,
+                              static_cast<std::int64_t>(entry.last_write_time(error).time_since_epoch().count()));
+  }
+
+  return hash == 0 ? 1 : hash;
+}
+
+bool WriteMeshCache(const std::string& cache_path, const std::uint64_t key, const unsigned int import_flags,
+                    std::span<const MeshData> meshes)
+{
+  if (key == 0)
+  {
+    return false;
+  }
+
+  std::vector<MeshCacheMeshRecord> mesh_records;
+  std::vector<MeshCacheMaterialRecord> material_records;
+  std::vector<MeshCacheBindingRecord> binding_records;
+  std::vector<const MeshData*> material_owners;
+  std::string strings;
+  std::uint64_t vertex_count = 0;
+  std::uint64_t index_count = 0;
+  std::uint64_t meshlet_count = 0;
+
+  const auto same_textures = [](const std::vector<Texture>& a, const std::vector<Texture>& b) {
+    return std::ranges::equal(a, b, [](const Texture& lhs, const Texture& rhs) {
+      return lhs.type == rhs.type && lhs.path == rhs.path;
+    });
+  };
+  const auto add_string = [&strings](const std::string& value) {
+    const auto offset = static_cast<std::uint32_t>(strings.size());
+    strings += value;
+    return offset;
+  };
+
+  mesh_records.reserve(meshes.size());
+  for (const MeshData& mesh : meshes)
+  {
+    std::uint32_t material = 0;
+    while (material < material_owners.size() && !same_textures(material_owners[material]->textures, mesh.textures))
+    {
+      ++material;
+    }
+    if (material == material_owners.size())
+    {
+      material_owners.push_back(&mesh);
+      material_records.push_back({static_cast<std::uint32_t>(binding_records.size()),
+                                  static_cast<std::uint32_t>(mesh.textures.size())});
+      for (const Texture& texture : mesh.textures)
+      {
+        MeshCacheBindingRecord binding{};
+        binding.type_offset = add_string(texture.type);
+        binding.type_length = static_cast<std::uint32_t>(texture.type.size());
+        binding.path_offset = add_string(texture.path);
+        binding.path_length = static_cast<std::uint32_t>(texture.path.size());
+        binding_records.push_back(binding);
+      }
+    }
+
+    MeshCacheMeshRecord record{};
+    record.first_vertex = static_cast<std::uint32_t>(vertex_count);
+    record.vertex_count = static_cast<std::uint32_t>(mesh.vertices.size());
+    record.first_index = static_cast<std::uint32_t>(index_count);
+    record.index_count = static_cast<std::uint32_t>(mesh.indices.size());
+    record.material = material;
+    std::memcpy(record.aabb_min, &mesh.aabb_min, sizeof(record.aabb_min));
+    std::memcpy(record.aabb_max, &mesh.aabb_max, sizeof(record.aabb_max));
+    record.bounding_radius = mesh.bounding_sphere.radius;
+    record.lod_count = static_cast<std::uint32_t>(std::min(mesh.lods.size(), kMaxMeshLods - 1));
+    for (std::uint32_t lod = 0; lod < record.lod_count; ++lod)
+    {
+      record.lod_index_count[lod] = static_cast<std::uint32_t>(mesh.lods[lod].indices.size());
+      record.lod_error[lod] = mesh.lods[lod].error;
+      index_count += mesh.lods[lod].indices.size();
+    }
+    record.first_meshlet = static_cast<std::uint32_t>(meshlet_count);
+    record.meshlet_count = static_cast<std::uint32_t>(mesh.meshlets.size());
+    meshlet_count += mesh.meshlets.size();
+    mesh_records.push_back(record);
+
+    vertex_count += mesh.vertices.size();
+    index_count += mesh.indices.size();
+  }
+
+  MeshCacheHeader header{};
+  std::memcpy(header.magic, kMeshCacheMagic, sizeof(header.magic));
+  header.version = kMeshCacheVersion;
+  header.import_flags = import_flags;
+  header.key = key;
+  header.mesh_count = static_cast<std::uint32_t>(mesh_records.size());
+  header.material_count = static_cast<std::uint32_t>(material_records.size());
+  header.binding_count = static_cast<std::uint32_t>(binding_records.size());
+  header.string_bytes = static_cast<std::uint32_t>(strings.size());
+  header.vertex_count = vertex_count;
+  header.index_count = index_count;
+  header.meshlet_count = meshlet_count;
+  const MeshCacheLayout layout = ComputeLayout(header);
+
+  // Write to a temporary file first so a crash never leaves a truncated cache
+  // with a valid header behind.
+  const std::string temp_path = cache_path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      std::cerr << "ERROR::MESH_CACHE::Cannot write " << temp_path << "\n";
+      return false;
+    }
+    const auto pad_to = [&out](const std::size_t offset) {
+      static constexpr char zeros[kMeshCacheAlignment] = {};
+      const auto position = static_cast<std::size_t>(out.tellp());
+      out.write(zeros, static_cast<std::streamsize>(offset - position));
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pad_to(layout.meshes);
+    out.write(reinterpret_cast<const char*>(mesh_records.data()),
+              static_cast<std::streamsize>(mesh_records.size() * sizeof(MeshCacheMeshRecord)));
+    pad_to(layout.materials);
+    out.write(reinterpret_cast<const char*>(material_records.data()),
+              static_cast<std::streamsize>(material_records.size() * sizeof(MeshCacheMaterialRecord)));
+    pad_to(layout.bindings);
+    out.write(reinterpret_cast<const char*>(binding_records.data()),
+              static_cast<std::streamsize>(binding_records.size() * sizeof(MeshCacheBindingRecord)));
+    pad_to(layout.strings);
+    out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    pad_to(layout.vertices);
+    for (const MeshData& mesh : meshes)
+    {
+      out.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+                static_cast<std::streamsize>(mesh.vertices.size() * sizeof(Vertex)));
+    }
+    pad_to(layout.indices);
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+      const MeshData& mesh = meshes[i];
+      out.write(reinterpret_cast<const char*>(mesh.indices.data()),
+                static_cast<std::streamsize>(mesh.indices.size() * sizeof(unsigned int)));
+      for (std::uint32_t lod = 0; lod < mesh_records[i].lod_count; ++lod)
+      {
+        out.write(reinterpret_cast<const char*>(mesh.lods[lod].indices.data()),
+                  static_cast<std::streamsize>(mesh.lods[lod].indices.size() * sizeof(unsigned int)));
+      }
+    }
+    pad_to(layout.meshlets);
+    for (const MeshData& mesh : meshes)
+    {
+      out.write(reinterpret_cast<const char*>(mesh.meshlets.data()),
+                static_cast<std::streamsize>(mesh.meshlets.size() * sizeof(Meshlet)));
+    }
+    if (!out)
+    {
+      std::cerr << "ERROR::MESH_CACHE::Write failed for " << temp_path << "\n";
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temp_path, cache_path, error);
+  if (error)
+  {
+    std::cerr << "ERROR::MESH_CACHE::Cannot replace " << cache_path << ": " << error.message() << "\n";
+    std::filesystem::remove(temp_path, error);
+    return false;
+  }
+  return true;
+}
+
+MeshCacheFile::~MeshCacheFile()
+{
+  Close();
+}
+
+bool MeshCacheFile::Open(const std::string& cache_path, const std::uint64_t key, const unsigned int import_flags)
+{
+  Close();
+  if (key == 0)
+  {
+    return false;
+  }
+
+  if (!file_.Open(cache_path) || file_.size() < sizeof(MeshCacheHeader))
+  {
+    Close();
+    return false;
+  }
+  const std::byte* data = file_.bytes().data();
+
+  header_ = reinterpret_cast<const MeshCacheHeader*>(data);
+  if (std::memcmp(header_->magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) != 0 ||
+      header_->version != kMeshCacheVersion || header_->import_flags != import_flags || header_->key != key)
+  {
+    Close();
+    return false;
+  }
+
+  const MeshCacheLayout layout = ComputeLayout(*header_);
+  if (layout.total > file_.size())
+  {
+    std::cerr << "ERROR::MESH_CACHE::Truncated cache " << cache_path << "\n";
+    Close();
+    return false;
+  }
+
+  meshes_ = reinterpret_cast<const MeshCacheMeshRecord*>(data + layout.meshes);
+  materials_ = reinterpret_cast<const MeshCacheMaterialRecord*>(data + layout.materials);
+  bindings_ = reinterpret_cast<const MeshCacheBindingRecord*>(data + layout.bindings);
+  strings_ = reinterpret_cast<const char*>(data + layout.strings);
+  vertices_ = reinterpret_cast<const Vertex*>(data + layout.vertices);
+  indices_ = reinterpret_cast<const unsigned int*>(data + layout.indices);
+  meshlets_ = reinterpret_cast<const Meshlet*>(data + layout.meshlets);
+
+  // Reject records pointing outside their sections rather than trusting the file.
+  for (std::uint32_t i = 0; i < header_->mesh_count; ++i)
+  {
+    const MeshCacheMeshRecord& mesh = meshes_[i];
+    std::uint64_t index_end = std::uint64_t{mesh.first_index} + mesh.index_count;
+    for (std::uint32_t lod = 0; lod < std::min<std::uint32_t>(mesh.lod_count, kMaxMeshLods - 1); ++lod)
+    {
+      index_end += mesh.lod_index_count[lod];
+    }
+    if (std::uint64_t{mesh.first_vertex} + mesh.vertex_count > header_->vertex_count ||
+        index_end > header_->index_count || mesh.lod_count >= kMaxMeshLods ||
+        std::uint64_t{mesh.first_meshlet} + mesh.meshlet_count > header_->meshlet_count ||
+        mesh.material >= header_->material_count)
+    {
+      Close();
+      return false;
+    }
+    for (std::uint32_t m = mesh.first_meshlet; m < mesh.first_meshlet + mesh.meshlet_count; ++m)
+    {
+      if (std::uint64_t{meshlets_[m].first_index} + meshlets_[m].index_count > mesh.index_count)
+      {
+        Close();
+        return false;
+      }
+    }
+  }
+  for (std::uint32_t i = 0; i < header_->material_count; ++i)
+  {
+    if (std::uint64_t{materials_[i].first_binding} + materials_[i].binding_count > header_->binding_count)
+    {
+      Close();
+      return false;
+    }
+  }
+  for (std::uint32_t i = 0; i < header_->binding_count; ++i)
+  {
+    const MeshCacheBindingRecord& binding = bindings_[i];
+    if (std::uint64_t{binding.type_offset} + binding.type_length > header_->string_bytes ||
+        std::uint64_t{binding.path_offset} + binding.path_length > header_->string_bytes)
+    {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void MeshCacheFile::Close()
+{
+  file_.Close();
+  header_ = nullptr;
+  meshes_ = nullptr;
+  materials_ = nullptr;
+  bindings_ = nullptr;
+  strings_ = nullptr;
+  vertices_ = nullptr;
+  indices_ = nullptr;
+  meshlets_ = nullptr;
+}
+
+std::span<const Vertex> MeshCacheFile::vertices(const std::size_t mesh) const
+{
+  return {vertices_ + meshes_[mesh].first_vertex, meshes_[mesh].vertex_count};
+}
+
+std::span<const unsigned int> MeshCacheFile::indices(const std::size_t mesh) const
+{
+  return {indices_ + meshes_[mesh].first_index, meshes_[mesh].index_count};
+}
+
+std::span<const unsigned int> MeshCacheFile::lod_indices(const std::size_t mesh, const std::size_t lod) const
+{
+  const MeshCacheMeshRecord& record = meshes_[mesh];
+  std::size_t first = record.first_index + record.index_count;
+  for (std::size_t previous = 1; previous < lod; ++previous)
+  {
+    first += record.lod_index_count[previous - 1];
+  }
+  return {indices_ + first, record.lod_index_count[lod - 1]};
+}
+
+std::span<const Meshlet> MeshCacheFile::meshlets(const std::size_t mesh) const
+{
+  return {meshlets_ + meshes_[mesh].first_meshlet, meshes_[mesh].meshlet_count};
+}
+
+glm::vec3 MeshCacheFile::aabb_min(const std::size_t mesh) const
+{
+  const float* value = meshes_[mesh].aabb_min;
+  return {value[0], value[1], value[2]};
+}
+
+glm::vec3 MeshCacheFile::aabb_max(const std::size_t mesh) const
+{
+  const float* value = meshes_[mesh].aabb_max;
+  return {value[0], value[1], value[2]};
+}
+
+BoundingSphere MeshCacheFile::bounding_sphere(const std::size_t mesh) const
+{
+  return {(aabb_min(mesh) + aabb_max(mesh)) * 0.5f, meshes_[mesh].bounding_radius};
+}
+
+std::size_t MeshCacheFile::binding_count(const std::size_t mesh) const
+{
+  return materials_[meshes_[mesh].material].binding_count;
+}
+
+MeshCacheBinding MeshCacheFile::binding(const std::size_t mesh, const std::size_t index) const
+{
+  const MeshCacheBindingRecord& record = bindings_[materials_[meshes_[mesh].material].first_binding + index];
+  return {std::string_view(strings_ + record.type_offset, record.type_length),
+          std::string_view(strings_ + record.path_offset, record.path_length)};
+}
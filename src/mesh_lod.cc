@@ -0,0 +1,493 @@
+#include "mesh_lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "hash_utility.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+namespace
+{
+// Each level targets half the triangles of the previous one, and is kept only
+// if it removes at least 10% of them
+constexpr float kLodTriangleRatio = 0.5f;
+constexpr float kLodMinReduction = 0.9f;
+// Coarsest error allowed, relative to the mesh's bounding box diagonal
+constexpr float kLodMaxRelativeError = 0.05f;
+
+// Sum of squared distances to a set of planes, weighted by triangle area:
+// Q(p) = p^T A p + 2 b.p + c, A symmetric
+struct Quadric
+{
+  double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+  double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+  double c = 0.0;
+  double weight = 0.0;
+
+  Quadric& operator+=(const Quadric& other)
+  {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+    return *this;
+  }
+
+  void AddPlane(const glm::dvec3& normal, const double distance, const double area)
+  {
+    a00 += area * normal.x * normal.x;
+    a01 += area * normal.x * normal.y;
+    a02 += area * normal.x * normal.z;
+    a11 += area * normal.y * normal.y;
+    a12 += area * normal.y * normal.z;
+    a22 += area * normal.z * normal.z;
+    b0 += area * normal.x * distance;
+    b1 += area * normal.y * distance;
+    b2 += area * normal.z * distance;
+    c += area * distance * distance;
+    weight += area;
+  }
+
+  // Mean squared distance of p to the planes
+  [[nodiscard]] double Error(const glm::vec3& position) const
+  {
+    if (weight <= 0.0)
+    {
+      return 0.0;
+    }
+    const double x = position.x;
+    const double y = position.y;
+    const double z = position.z;
+    const double value = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                         2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    return std::max(value, 0.0) / weight;
+  }
+};
+
+struct PositionHash
+{
+  std::size_t operator()(const glm::vec3& position) const
+  {
+    return gpr5300::HashValue(gpr5300::kFnvOffsetBasis, position);
+  }
+};
+
+// Bitwise, like the hash (0.0 and -0.0 are different keys)
+struct PositionEqual
+{
+  bool operator()(const glm::vec3& a, const glm::vec3& b) const
+  {
+    return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+  }
+};
+
+struct Collapse
+{
+  unsigned int from; // Position group removed
+  unsigned int to;   // Position group kept
+  double error;      // Squared, of the merged quadric at the kept position
+};
+
+// Unordered edge between two position groups, packed for sorting
+std::uint64_t EdgeKey(const unsigned int a, const unsigned int b)
+{
+  return std::uint64_t{std::min(a, b)} << 32 | std::max(a, b);
+}
+} // namespace
+
+std::vector<unsigned int> SimplifyMesh(const std::span<const Vertex> vertices,
+                                       const std::span<const unsigned int> source_indices,
+                                       const std::size_t target_index_count, const float max_error, float* error)
+{
+  std::vector<unsigned int> indices(source_indices.begin(), source_indices.end());
+  float reached_error = 0.0f;
+  if (indices.size() % 3 != 0 || indices.size() <= target_index_count)
+  {
+    if (error)
+    {
+      *error = reached_error;
+    }
+    return indices;
+  }
+
+  // Vertices split by a UV or normal seam share a position: collapses work on
+  // position groups, and each group lists the vertices (wedges) it holds.
+  std::vector<unsigned int> group(vertices.size());
+  std::vector<glm::vec3> group_position;
+  {
+    std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> groups(vertices.size());
+    for (std::size_t v = 0; v < vertices.size(); v++)
+    {
+      const auto [it, inserted] =
+          groups.emplace(vertices[v].Position, static_cast<unsigned int>(group_position.size()));
+      if (inserted)
+      {
+        group_position.push_back(vertices[v].Position);
+      }
+      group[v] = it->second;
+    }
+  }
+  const std::size_t group_count = group_position.size();
+  std::vector<unsigned int> wedge_offsets(group_count + 1, 0);
+  for (const unsigned int g : group)
+  {
+    wedge_offsets[g + 1]++;
+  }
+  std::partial_sum(wedge_offsets.begin(), wedge_offsets.end(), wedge_offsets.begin());
+  std::vector<unsigned int> wedges(vertices.size());
+  {
+    std::vector<unsigned int> cursor(wedge_offsets.begin(), wedge_offsets.end() - 1);
+    for (unsigned int v = 0; v < vertices.size(); v++)
+    {
+      wedges[cursor[group[v]]++] = v;
+    }
+  }
+
+  // Plane quadric of every triangle accumulated on its corners
+  std::vector<Quadric> quadrics(group_count);
+  for (std::size_t i = 0; i < indices.size(); i += 3)
+  {
+    const glm::dvec3 a(group_position[group[indices[i]]]);
+    const glm::dvec3 b(group_position[group[indices[i + 1]]]);
+    const glm::dvec3 c(group_position[group[indices[i + 2]]]);
+    const glm::dvec3 cross = glm::cross(b - a, c - a);
+    const double length = glm::length(cross);
+    if (length <= 0.0)
+    {
+      continue;
+    }
+    const glm::dvec3 normal = cross / length;
+    Quadric quadric;
+    quadric.AddPlane(normal, -glm::dot(normal, a), length * 0.5);
+    for (std::size_t corner = 0; corner < 3; corner++)
+    {
+      quadrics[group[indices[i + corner]]] += quadric;
+    }
+  }
+
+  // Groups on an open or non-manifold edge never move: the meshes of a model
+  // (materials, SplitForShortIndices parts) meet along such borders, and moving
+  // them would open cracks between neighbouring meshes.
+  std::vector<bool> locked(group_count, false);
+  {
+    std::vector<std::uint64_t> edges;
+    edges.reserve(indices.size());
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const unsigned int a = group[indices[i + corner]];
+        const unsigned int b = group[indices[i + (corner + 1) % 3]];
+        if (a != b)
+        {
+          edges.push_back(EdgeKey(a, b));
+        }
+      }
+    }
+    std::ranges::sort(edges);
+    for (std::size_t i = 0; i < edges.size();)
+    {
+      std::size_t j = i + 1;
+      while (j < edges.size() && edges[j] == edges[i])
+      {
+        j++;
+      }
+      if (j - i != 2)
+      {
+        locked[edges[i] >> 32] = true;
+        locked[edges[i] & 0xFFFFFFFFu] = true;
+      }
+      i = j;
+    }
+  }
+
+  const double max_squared_error = static_cast<double>(max_error) * static_cast<double>(max_error);
+  std::vector<std::uint64_t> edges;
+  std::vector<Collapse> collapses;
+  std::vector<unsigned int> triangle_offsets(group_count + 1);
+  std::vector<unsigned int> triangles;
+  std::vector<bool> touched(group_count);
+  std::vector<unsigned int> remap(vertices.size());
+
+  // Each pass collapses the cheapest edges whose neighbourhoods do not overlap,
+  // then rebuilds the index buffer; the next pass starts from the result.
+  while (indices.size() > target_index_count)
+  {
+    const std::size_t triangle_count = indices.size() / 3;
+
+    // Triangles around each group
+    std::ranges::fill(triangle_offsets, 0);
+    for (const unsigned int index : indices)
+    {
+      triangle_offsets[group[index] + 1]++;
+    }
+    std::partial_sum(triangle_offsets.begin(), triangle_offsets.end(), triangle_offsets.begin());
+    triangles.resize(indices.size());
+    {
+      std::vector<unsigned int> cursor(triangle_offsets.begin(), triangle_offsets.end() - 1);
+      for (std::size_t i = 0; i < indices.size(); i++)
+      {
+        triangles[cursor[group[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+      }
+    }
+
+    // Both directions of every edge are candidates, the cheaper one is kept
+    edges.clear();
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const unsigned int a = group[indices[i + corner]];
+        const unsigned int b = group[indices[i + (corner + 1) % 3]];
+        if (a != b)
+        {
+          edges.push_back(EdgeKey(a, b));
+        }
+      }
+    }
+    std::ranges::sort(edges);
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // A seam group only collapses into another seam group, or its wedges
+    // would be merged with vertices of a single wedge
+    const auto wedge_count = [&](const unsigned int g) { return wedge_offsets[g + 1] - wedge_offsets[g]; };
+    const auto collapsible = [&](const unsigned int from, const unsigned int to) {
+      return !locked[from] && (wedge_count(from) == 1 || wedge_count(to) > 1);
+    };
+    collapses.clear();
+    for (const std::uint64_t edge : edges)
+    {
+      const auto a = static_cast<unsigned int>(edge >> 32);
+      const auto b = static_cast<unsigned int>(edge & 0xFFFFFFFFu);
+      Quadric merged = quadrics[a];
+      merged += quadrics[b];
+      Collapse best{0, 0, std::numeric_limits<double>::max()};
+      if (collapsible(a, b))
+      {
+        best = {a, b, merged.Error(group_position[b])};
+      }
+      if (collapsible(b, a))
+      {
+        const double cost = merged.Error(group_position[a]);
+        if (cost < best.error)
+        {
+          best = {b, a, cost};
+        }
+      }
+      if (best.error <= max_squared_error)
+      {
+        collapses.push_back(best);
+      }
+    }
+    if (collapses.empty())
+    {
+      break;
+    }
+    std::ranges::sort(collapses, {}, &Collapse::error);
+
+    std::fill(touched.begin(), touched.end(), false);
+    std::iota(remap.begin(), remap.end(), 0u);
+    std::size_t removed_triangles = 0;
+    const std::size_t removable_triangles = triangle_count - target_index_count / 3;
+    for (const Collapse& collapse : collapses)
+    {
+      if (removed_triangles >= removable_triangles)
+      {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to])
+      {
+        continue;
+      }
+
+      // Every triangle around from must keep its orientation once from moves,
+      // and none of their corners may have moved already in this pass
+      const glm::vec3& target = group_position[collapse.to];
+      bool valid = true;
+      std::size_t collapsed = 0;
+      for (unsigned int t = triangle_offsets[collapse.from]; valid && t < triangle_offsets[collapse.from + 1]; t++)
+      {
+        const unsigned int* corners = &indices[static_cast<std::size_t>(triangles[t]) * 3];
+        glm::vec3 before[3];
+        glm::vec3 after[3];
+        bool degenerate = false;
+        for (std::size_t corner = 0; corner < 3; corner++)
+        {
+          const unsigned int g = group[corners[corner]];
+          valid = valid && (g == collapse.from || !touched[g]);
+          degenerate = degenerate || g == collapse.to;
+          before[corner] = group_position[g];
+          after[corner] = g == collapse.from ? target : before[corner];
+        }
+        if (degenerate)
+        {
+          collapsed++;
+          continue;
+        }
+        const glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+        const glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+        valid = valid && glm::dot(normal_before, normal_after) > 0.0f;
+      }
+      if (!valid)
+      {
+        continue;
+      }
+
+      // Freeze the neighbourhood for the rest of the pass
+      for (unsigned int t = triangle_offsets[collapse.from]; t < triangle_offsets[collapse.from + 1]; t++)
+      {
+        const unsigned int* corners = &indices[static_cast<std::size_t>(triangles[t]) * 3];
+        for (std::size_t corner = 0; corner < 3; corner++)
+        {
+          touched[group[corners[corner]]] = true;
+        }
+      }
+      touched[collapse.to] = true;
+
+      // Each wedge of from moves onto the wedge of to with the closest attributes
+      for (unsigned int w = wedge_offsets[collapse.from]; w < wedge_offsets[collapse.from + 1]; w++)
+      {
+        const Vertex& source = vertices[wedges[w]];
+        float best_distance = std::numeric_limits<float>::max();
+        for (unsigned int k = wedge_offsets[collapse.to]; k < wedge_offsets[collapse.to + 1]; k++)
+        {
+          const Vertex& candidate = vertices[wedges[k]];
+          const glm::vec2 uv = candidate.TexCoords - source.TexCoords;
+          const glm::vec3 normal = candidate.Normal - source.Normal;
+          const float distance = glm::dot(uv, uv) + glm::dot(normal, normal);
+          if (distance < best_distance)
+          {
+            best_distance = distance;
+            remap[wedges[w]] = wedges[k];
+          }
+        }
+      }
+      quadrics[collapse.to] += quadrics[collapse.from];
+      reached_error = std::max(reached_error, static_cast<float>(std::sqrt(collapse.error)));
+      removed_triangles += collapsed;
+    }
+    if (removed_triangles == 0)
+    {
+      break;
+    }
+
+    // Rebuild without the triangles that collapsed to a line
+    std::size_t write = 0;
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+      const unsigned int a = remap[indices[i]];
+      const unsigned int b = remap[indices[i + 1]];
+      const unsigned int c = remap[indices[i + 2]];
+      if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+      {
+        continue;
+      }
+      indices[write++] = a;
+      indices[write++] = b;
+      indices[write++] = c;
+    }
+    indices.resize(write);
+  }
+
+  if (error)
+  {
+    *error = reached_error;
+  }
+  return indices;
+}
+
+void GenerateLods(MeshData& mesh)
+{
+  mesh.lods.clear();
+  if (mesh.indices.empty() || mesh.indices.size() % 3 != 0)
+  {
+    return;
+  }
+
+  glm::vec3 aabb_min(std::numeric_limits<float>::max());
+  glm::vec3 aabb_max(-std::numeric_limits<float>::max());
+  for (const Vertex& vertex : mesh.vertices)
+  {
+    aabb_min = glm::min(aabb_min, vertex.Position);
+    aabb_max = glm::max(aabb_max, vertex.Position);
+  }
+  const float max_error = kLodMaxRelativeError * glm::length(aabb_max - aabb_min);
+
+  // Every level is simplified from the full mesh, so its error is measured
+  // against the original surface rather than accumulated level to level
+  std::size_t previous_count = mesh.indices.size();
+  float previous_error = 0.0f;
+  while (mesh.lods.size() + 1 < kMaxMeshLods)
+  {
+    const auto target = static_cast<std::size_t>(static_cast<float>(previous_count / 3) * kLodTriangleRatio) * 3;
+    float error = 0.0f;
+    std::vector<unsigned int> indices = SimplifyMesh(mesh.vertices, mesh.indices, target, max_error, &error);
+    if (indices.empty() || static_cast<float>(indices.size()) > static_cast<float>(previous_count) * kLodMinReduction)
+    {
+      break;
+    }
+    OptimizeVertexCache(indices, mesh.vertices.size());
+    previous_count = indices.size();
+    previous_error = std::max(previous_error, error);
+    mesh.lods.push_back({std::move(indices), previous_error});
+  }
+}
+
+LodSelector LodSelector::FromCamera(const float fov_y, const float viewport_height, const float max_pixel_error)
+{
+  LodSelector selector;
+  selector.pixels_per_unit = viewport_height / (2.0f * std::tan(fov_y * 0.5f));
+  selector.max_pixel_error = max_pixel_error;
+  return selector;
+}
+
+float LodSelector::ProjectedError(const float error, const float distance, const float scale) const
+{
+  // Inside the bounds or closer than one unit, the error is seen as if at one unit
+  return error * scale * pixels_per_unit / std::max(distance, 1.0f);
+}
+
+std::size_t LodSelector::Select(const std::span<const float> errors, const float distance, const float scale) const
+{
+  if (pixels_per_unit <= 0.0f)
+  {
+    return 0;
+  }
+  for (std::size_t level = errors.size(); level-- > 1;)
+  {
+    if (ProjectedError(errors[level], distance, scale) <= max_pixel_error)
+    {
+      return level;
+    }
+  }
+  return 0;
+}
+
+std::size_t LodSelector::Select(const std::span<const float> errors, const glm::mat4& transform,
+                                const glm::vec3& aabb_min, const glm::vec3& aabb_max,
+                                const glm::vec3& camera_position) const
+{
+  if (errors.size() < 2 || pixels_per_unit <= 0.0f)
+  {
+    return 0;
+  }
+  const float scale = MaxScale(transform);
+  const glm::vec3 center = glm::vec3(transform * glm::vec4((aabb_min + aabb_max) * 0.5f, 1.0f));
+  const float radius = glm::length(aabb_max - aabb_min) * 0.5f * scale;
+  return Select(errors, glm::length(center - camera_position) - radius, scale);
+}
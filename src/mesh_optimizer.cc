@@ -0,0 +1,481 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "hash_utility.h"
+#include "mesh.h"
+
+namespace
+{
+constexpr unsigned int kNoVertex = std::numeric_limits<unsigned int>::max();
+constexpr std::size_t kNoTriangle = std::numeric_limits<std::size_t>::max();
+
+// Forsyth's tuning: LRU cache of 32 entries, scores favour the three most
+// recent vertices slightly less than the next ones (they are likely to be
+// reused by the very next triangle anyway) and boost vertices with few
+// triangles left so that no stragglers are left behind.
+constexpr int kForsythCacheSize = 32;
+constexpr float kForsythCacheDecayPower = 1.5f;
+constexpr float kForsythLastTriangleScore = 0.75f;
+constexpr float kForsythValenceBoostScale = 2.0f;
+constexpr float kForsythValenceBoostPower = 0.5f;
+
+float ForsythVertexScore(const int cache_position, const unsigned int remaining_triangles)
+{
+  if (remaining_triangles == 0)
+  {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cache_position >= 0)
+  {
+    if (cache_position < 3)
+    {
+      score = kForsythLastTriangleScore;
+    }
+    else
+    {
+      const float scaler = 1.0f / static_cast<float>(kForsythCacheSize - 3);
+      score = std::pow(1.0f - static_cast<float>(cache_position - 3) * scaler, kForsythCacheDecayPower);
+    }
+  }
+  return score + kForsythValenceBoostScale *
+                     std::pow(static_cast<float>(remaining_triangles), -kForsythValenceBoostPower);
+}
+
+struct VertexHash
+{
+  const std::vector<Vertex>* vertices;
+
+  std::size_t operator()(const unsigned int index) const
+  {
+    return gpr5300::HashValue(gpr5300::kFnvOffsetBasis, (*vertices)[index]);
+  }
+};
+
+struct VertexEqual
+{
+  const std::vector<Vertex>* vertices;
+
+  bool operator()(const unsigned int a, const unsigned int b) const
+  {
+    return std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) == 0;
+  }
+};
+
+struct OverdrawCluster
+{
+  std::size_t first_triangle;
+  std::size_t triangle_count;
+  float sort_key;
+};
+
+// Cluster starts where the cache is cold (every vertex of a triangle misses),
+// plus soft splits inside those runs wherever the cluster so far is cache
+// efficient enough that restarting with a cold cache costs little. A cluster
+// may end up drawn after any other, so each one is simulated from a cold cache.
+std::vector<std::size_t> OverdrawClusterStarts(const std::span<const unsigned int> indices,
+                                               const std::size_t vertex_count, const float threshold)
+{
+  const std::size_t triangle_count = indices.size() / 3;
+  const float target_acmr = AnalyzeVertexCache(indices, vertex_count).acmr() * threshold;
+
+  std::vector<std::size_t> starts;
+  std::vector<std::size_t> timestamps(vertex_count, 0);
+  std::size_t time = kVertexCacheSize + 1;
+  const auto cached = [&](const unsigned int vertex) { return time - timestamps[vertex] <= kVertexCacheSize; };
+
+  std::size_t cluster_triangles = 0;
+  std::size_t cluster_misses = 0;
+  for (std::size_t triangle = 0; triangle < triangle_count; triangle++)
+  {
+    const unsigned int* corners = &indices[triangle * 3];
+    const bool cold = !cached(corners[0]) && !cached(corners[1]) && !cached(corners[2]);
+    const bool efficient = cluster_triangles > 0 && static_cast<float>(cluster_misses) <=
+                                                        target_acmr * static_cast<float>(cluster_triangles);
+    if (triangle == 0 || cold || efficient)
+    {
+      starts.push_back(triangle);
+      cluster_triangles = 0;
+      cluster_misses = 0;
+      time += kVertexCacheSize + 1; // Flush
+    }
+    for (std::size_t corner = 0; corner < 3; corner++)
+    {
+      if (!cached(corners[corner]))
+      {
+        timestamps[corners[corner]] = time++;
+        cluster_misses++;
+      }
+    }
+    cluster_triangles++;
+  }
+  return starts;
+}
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const std::span<const unsigned int> indices, const std::size_t vertex_count,
+                                    const std::size_t cache_size)
+{
+  VertexCacheStats stats;
+  stats.triangle_count = indices.size() / 3;
+  stats.vertex_count = vertex_count;
+
+  // A vertex is in the FIFO while fewer than cache_size misses happened since it entered
+  std::vector<std::size_t> timestamps(vertex_count, 0);
+  std::size_t time = cache_size + 1;
+  for (const unsigned int index : indices)
+  {
+    if (time - timestamps[index] > cache_size)
+    {
+      timestamps[index] = time++;
+      stats.transformed_count++;
+    }
+  }
+  return stats;
+}
+
+std::size_t DeduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+  std::unordered_map<unsigned int, unsigned int, VertexHash, VertexEqual> unique(
+      vertices.size(), VertexHash{&vertices}, VertexEqual{&vertices});
+  std::vector<unsigned int> remap(vertices.size());
+  std::size_t unique_count = 0;
+  for (unsigned int i = 0; i < vertices.size(); i++)
+  {
+    const auto [it, inserted] = unique.emplace(i, static_cast<unsigned int>(unique_count));
+    if (inserted)
+    {
+      unique_count++;
+    }
+    remap[i] = it->second;
+  }
+  if (unique_count == vertices.size())
+  {
+    return 0;
+  }
+
+  // remap is increasing for first occurrences, so compaction can run in place
+  for (unsigned int i = 0; i < vertices.size(); i++)
+  {
+    vertices[remap[i]] = vertices[i];
+  }
+  const std::size_t removed = vertices.size() - unique_count;
+  vertices.resize(unique_count);
+  for (unsigned int& index : indices)
+  {
+    index = remap[index];
+  }
+  return removed;
+}
+
+void OptimizeVertexCache(const std::span<unsigned int> indices, const std::size_t vertex_count)
+{
+  const std::size_t triangle_count = indices.size() / 3;
+  if (triangle_count < 2)
+  {
+    return;
+  }
+
+  // Triangles of each vertex, live ones first: [offsets[v], offsets[v] + remaining[v])
+  std::vector<unsigned int> remaining(vertex_count, 0);
+  for (const unsigned int index : indices)
+  {
+    remaining[index]++;
+  }
+  std::vector<std::size_t> offsets(vertex_count + 1, 0);
+  std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+  std::vector<std::size_t> adjacency(indices.size());
+  {
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+      adjacency[cursor[indices[i]]++] = i / 3;
+    }
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (std::size_t v = 0; v < vertex_count; v++)
+  {
+    vertex_score[v] = ForsythVertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<bool> emitted(triangle_count, false);
+  std::size_t best = 0;
+  for (std::size_t t = 0; t < triangle_count; t++)
+  {
+    triangle_score[t] =
+        vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+    if (triangle_score[t] > triangle_score[best])
+    {
+      best = t;
+    }
+  }
+
+  std::vector<unsigned int> output;
+  output.reserve(indices.size());
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> next_cache;
+  cache.reserve(kForsythCacheSize + 3);
+  next_cache.reserve(kForsythCacheSize + 3);
+  std::size_t scan_cursor = 0;
+
+  while (output.size() < indices.size())
+  {
+    if (best == kNoTriangle)
+    {
+      // Dead end: nothing in the cache has triangles left, take the next unemitted one in input order
+      while (emitted[scan_cursor])
+      {
+        scan_cursor++;
+      }
+      best = scan_cursor;
+    }
+
+    emitted[best] = true;
+    const unsigned int* corners = &indices[best * 3];
+    next_cache.assign(corners, corners + 3);
+    for (std::size_t corner = 0; corner < 3; corner++)
+    {
+      const unsigned int vertex = corners[corner];
+      output.push_back(vertex);
+      // Swap the triangle out of the live part of the vertex's list
+      const std::size_t begin = offsets[vertex];
+      const std::size_t end = begin + remaining[vertex];
+      const auto found = std::find(adjacency.begin() + static_cast<std::ptrdiff_t>(begin),
+                                   adjacency.begin() + static_cast<std::ptrdiff_t>(end), best);
+      std::iter_swap(found, adjacency.begin() + static_cast<std::ptrdiff_t>(end - 1));
+      remaining[vertex]--;
+    }
+    for (const unsigned int vertex : cache)
+    {
+      if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+      {
+        next_cache.push_back(vertex);
+      }
+    }
+
+    // Rescore every vertex whose cache position changed, including the ones pushed out
+    for (std::size_t i = 0; i < next_cache.size(); i++)
+    {
+      const unsigned int vertex = next_cache[i];
+      cache_position[vertex] = i < kForsythCacheSize ? static_cast<int>(i) : -1;
+      const float score = ForsythVertexScore(cache_position[vertex], remaining[vertex]);
+      const float delta = score - vertex_score[vertex];
+      vertex_score[vertex] = score;
+      for (std::size_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++)
+      {
+        triangle_score[adjacency[a]] += delta;
+      }
+    }
+    next_cache.resize(std::min<std::size_t>(next_cache.size(), kForsythCacheSize));
+    std::swap(cache, next_cache);
+
+    // The next triangle is the best one touching the cache
+    best = kNoTriangle;
+    float best_score = -std::numeric_limits<float>::max();
+    for (const unsigned int vertex : cache)
+    {
+      for (std::size_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++)
+      {
+        const std::size_t triangle = adjacency[a];
+        if (triangle_score[triangle] > best_score)
+        {
+          best_score = triangle_score[triangle];
+          best = triangle;
+        }
+      }
+    }
+  }
+  std::ranges::copy(output, indices.begin());
+}
+
+void OptimizeOverdraw(const std::span<unsigned int> indices, const std::span<const Vertex> vertices,
+                      const float threshold)
+{
+  const std::size_t triangle_count = indices.size() / 3;
+  if (triangle_count < 2)
+  {
+    return;
+  }
+  const std::vector<std::size_t> starts = OverdrawClusterStarts(indices, vertices.size(), threshold);
+  if (starts.size() < 2)
+  {
+    return;
+  }
+
+  // Area-weighted centroid of the whole mesh
+  glm::vec3 mesh_centroid(0.0f);
+  float mesh_area = 0.0f;
+  for (std::size_t t = 0; t < triangle_count; t++)
+  {
+    const glm::vec3& a = vertices[indices[t * 3]].Position;
+    const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+    const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+    const float area = glm::length(glm::cross(b - a, c - a));
+    mesh_centroid += (a + b + c) * (area / 3.0f);
+    mesh_area += area;
+  }
+  mesh_centroid = mesh_area > 0.0f ? mesh_centroid / mesh_area : glm::vec3(0.0f);
+
+  // Clusters facing away from the centre are likely to occlude the others: draw them first
+  std::vector<OverdrawCluster> clusters(starts.size());
+  for (std::size_t i = 0; i < starts.size(); i++)
+  {
+    OverdrawCluster& cluster = clusters[i];
+    cluster.first_triangle = starts[i];
+    cluster.triangle_count = (i + 1 < starts.size() ? starts[i + 1] : triangle_count) - starts[i];
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area_sum = 0.0f;
+    for (std::size_t t = cluster.first_triangle; t < cluster.first_triangle + cluster.triangle_count; t++)
+    {
+      const glm::vec3& a = vertices[indices[t * 3]].Position;
+      const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+      const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+      const glm::vec3 cross = glm::cross(b - a, c - a);
+      const float area = glm::length(cross);
+      centroid += (a + b + c) * (area / 3.0f);
+      normal += cross;
+      area_sum += area;
+    }
+    const float normal_length = glm::length(normal);
+    if (area_sum <= 0.0f || normal_length <= 0.0f)
+    {
+      cluster.sort_key = -std::numeric_limits<float>::max();
+      continue;
+    }
+    centroid /= area_sum;
+    cluster.sort_key = glm::dot(centroid - mesh_centroid, normal / normal_length);
+  }
+  std::ranges::stable_sort(clusters, std::greater<>(), &OverdrawCluster::sort_key);
+
+  std::vector<unsigned int> sorted;
+  sorted.reserve(indices.size());
+  for (const OverdrawCluster& cluster : clusters)
+  {
+    const auto begin = indices.begin() + static_cast<std::ptrdiff_t>(cluster.first_triangle * 3);
+    sorted.insert(sorted.end(), begin, begin + static_cast<std::ptrdiff_t>(cluster.triangle_count * 3));
+  }
+  std::ranges::copy(sorted, indices.begin());
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, const std::span<unsigned int> indices)
+{
+  std::vector<unsigned int> remap(vertices.size(), kNoVertex);
+  unsigned int next = 0;
+  for (unsigned int& index : indices)
+  {
+    if (remap[index] == kNoVertex)
+    {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+
+  std::vector<Vertex> reordered(next);
+  for (std::size_t i = 0; i < vertices.size(); i++)
+  {
+    if (remap[i] != kNoVertex)
+    {
+      reordered[remap[i]] = vertices[i];
+    }
+  }
+  vertices = std::move(reordered);
+}
+
+MeshOptimizationReport OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+  MeshOptimizationReport report;
+  report.before = AnalyzeVertexCache(indices, vertices.size());
+  if (indices.empty() || indices.size() % 3 != 0)
+  {
+    report.after = report.before;
+    return report;
+  }
+
+  report.duplicates_removed = DeduplicateVertices(vertices, indices);
+  OptimizeVertexCache(indices, vertices.size());
+  OptimizeOverdraw(indices, vertices);
+  OptimizeVertexFetch(vertices, indices);
+  report.after = AnalyzeVertexCache(indices, vertices.size());
+  return report;
+}
+
+void SplitForShortIndices(std::vector<MeshData>& meshes)
+{
+  std::vector<MeshData> split;
+  split.reserve(meshes.size());
+  std::vector<unsigned int> remap;
+  std::vector<unsigned int> touched;
+  for (MeshData& mesh : meshes)
+  {
+    if (mesh.vertices.size() <= kShortIndexVertexLimit || mesh.indices.size() % 3 != 0)
+    {
+      split.push_back(std::move(mesh));
+      continue;
+    }
+
+    remap.assign(mesh.vertices.size(), kNoVertex);
+    touched.clear();
+    MeshData part;
+    const auto finish_part = [&]() {
+      part.bounding_sphere = ComputeBoundingSphere(part.vertices, part.aabb_min, part.aabb_max);
+      split.push_back(std::move(part));
+    };
+    const auto start_part = [&]() {
+      part = MeshData();
+      part.textures = mesh.textures;
+      for (const unsigned int vertex : touched)
+      {
+        remap[vertex] = kNoVertex;
+      }
+      touched.clear();
+    };
+    start_part();
+    for (std::size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+      std::size_t new_vertices = 0;
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const unsigned int vertex = mesh.indices[i + corner];
+        // Corners repeated in a degenerate triangle only count once
+        const bool repeated =
+            (corner > 0 && mesh.indices[i] == vertex) || (corner > 1 && mesh.indices[i + 1] == vertex);
+        new_vertices += remap[vertex] == kNoVertex && !repeated;
+      }
+      if (part.vertices.size() + new_vertices > kShortIndexVertexLimit)
+      {
+        finish_part();
+        start_part();
+      }
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const unsigned int vertex = mesh.indices[i + corner];
+        if (remap[vertex] == kNoVertex)
+        {
+          remap[vertex] = static_cast<unsigned int>(part.vertices.size());
+          touched.push_back(vertex);
+          const Vertex& source = mesh.vertices[vertex];
+          part.vertices.push_back(source);
+          part.aabb_min = glm::min(part.aabb_min, source.Position);
+          part.aabb_max = glm::max(part.aabb_max, source.Position);
+        }
+        part.indices.push_back(remap[vertex]);
+      }
+    }
+    if (!part.indices.empty())
+    {
+      finish_part();
+    }
+  }
+  meshes = std::move(split);
+}
@@ -0,0 +1,321 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "free_camera.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+namespace
+{
+constexpr std::uint32_t kNoMeshlet = std::numeric_limits<std::uint32_t>::max();
+// Below this spread of the normals around the axis, the cone is too wide to cull anything
+constexpr float kMeshletMinConeDot = 0.1f;
+// Out of reach of any dot product between unit vectors
+constexpr float kMeshletNoConeCutoff = 2.0f;
+
+void ComputeMeshletBounds(Meshlet& meshlet, const std::span<const Vertex> vertices,
+                          const std::span<const unsigned int> indices)
+{
+  const std::span<const unsigned int> triangles = indices.subspan(meshlet.first_index, meshlet.index_count);
+
+  glm::vec3 aabb_min(std::numeric_limits<float>::max());
+  glm::vec3 aabb_max(-std::numeric_limits<float>::max());
+  for (const unsigned int index : triangles)
+  {
+    aabb_min = glm::min(aabb_min, vertices[index].Position);
+    aabb_max = glm::max(aabb_max, vertices[index].Position);
+  }
+  meshlet.center = (aabb_min + aabb_max) * 0.5f;
+  meshlet.radius = 0.0f;
+  for (const unsigned int index : triangles)
+  {
+    meshlet.radius = std::max(meshlet.radius, glm::length(vertices[index].Position - meshlet.center));
+  }
+
+  // Normal cone: the average face normal, opened wide enough to hold every face
+  glm::vec3 normal_sum(0.0f);
+  for (std::size_t i = 0; i < triangles.size(); i += 3)
+  {
+    const glm::vec3& a = vertices[triangles[i]].Position;
+    const glm::vec3 cross =
+        glm::cross(vertices[triangles[i + 1]].Position - a, vertices[triangles[i + 2]].Position - a);
+    const float length = glm::length(cross);
+    if (length > 0.0f)
+    {
+      normal_sum += cross / length;
+    }
+  }
+  meshlet.cone_apex = meshlet.center;
+  meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+  meshlet.cone_cutoff = kMeshletNoConeCutoff;
+  const float sum_length = glm::length(normal_sum);
+  if (sum_length <= 0.0f)
+  {
+    return;
+  }
+  const glm::vec3 axis = normal_sum / sum_length;
+
+  float min_dot = 1.0f;
+  float max_t = 0.0f;
+  for (std::size_t i = 0; i < triangles.size(); i += 3)
+  {
+    const glm::vec3& a = vertices[triangles[i]].Position;
+    const glm::vec3 cross =
+        glm::cross(vertices[triangles[i + 1]].Position - a, vertices[triangles[i + 2]].Position - a);
+    const float length = glm::length(cross);
+    if (length <= 0.0f)
+    {
+      continue;
+    }
+    const glm::vec3 normal = cross / length;
+    const float dot = glm::dot(normal, axis);
+    min_dot = std::min(min_dot, dot);
+    // The apex moves back along the axis until it is behind every face plane
+    if (dot > 0.0f)
+    {
+      max_t = std::max(max_t, glm::dot(meshlet.center - a, normal) / dot);
+    }
+  }
+  if (min_dot <= kMeshletMinConeDot)
+  {
+    return;
+  }
+  meshlet.cone_apex = meshlet.center - axis * max_t;
+  meshlet.cone_axis = axis;
+  meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+} // namespace
+
+MeshletCullStats& MeshletCullStats::operator+=(const MeshletCullStats& other)
+{
+  meshlet_count += other.meshlet_count;
+  visible_meshlet_count += other.visible_meshlet_count;
+  triangle_count += other.triangle_count;
+  visible_triangle_count += other.visible_triangle_count;
+  return *this;
+}
+
+std::vector<Meshlet> BuildMeshlets(const std::span<const Vertex> vertices, const std::span<unsigned int> indices)
+{
+  std::vector<Meshlet> meshlets;
+  if (indices.empty() || indices.size() % 3 != 0)
+  {
+    return meshlets;
+  }
+  const std::size_t triangle_count = indices.size() / 3;
+
+  // Triangles around each vertex, compressed: those of vertex v are
+  // vertex_triangles[first_triangle[v]] to vertex_triangles[first_triangle[v + 1]]
+  std::vector<std::uint32_t> first_triangle(vertices.size() + 1, 0);
+  for (const unsigned int index : indices)
+  {
+    first_triangle[index + 1]++;
+  }
+  for (std::size_t v = 0; v < vertices.size(); v++)
+  {
+    first_triangle[v + 1] += first_triangle[v];
+  }
+  std::vector<std::uint32_t> vertex_triangles(indices.size());
+  {
+    std::vector<std::uint32_t> cursor(first_triangle.begin(), first_triangle.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); i++)
+    {
+      vertex_triangles[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+    }
+  }
+
+  std::vector<glm::vec3> normals(triangle_count, glm::vec3(0.0f));
+  for (std::size_t t = 0; t < triangle_count; t++)
+  {
+    const glm::vec3& a = vertices[indices[t * 3]].Position;
+    const glm::vec3 cross =
+        glm::cross(vertices[indices[t * 3 + 1]].Position - a, vertices[indices[t * 3 + 2]].Position - a);
+    const float length = glm::length(cross);
+    if (length > 0.0f)
+    {
+      normals[t] = cross / length;
+    }
+  }
+
+  // Meshlet in which each vertex was last counted, and each triangle was placed
+  std::vector<std::uint32_t> vertex_owner(vertices.size(), kNoMeshlet);
+  std::vector<std::uint32_t> triangle_owner(triangle_count, kNoMeshlet);
+  std::vector<std::uint32_t> order; // Triangles in meshlet order
+  order.reserve(triangle_count);
+  std::vector<std::uint32_t> candidates;
+  std::size_t next_seed = 0;
+
+  while (order.size() < triangle_count)
+  {
+    while (triangle_owner[next_seed] != kNoMeshlet)
+    {
+      next_seed++;
+    }
+    const auto id = static_cast<std::uint32_t>(meshlets.size());
+    Meshlet meshlet{};
+    meshlet.first_index = static_cast<std::uint32_t>(order.size() * 3);
+    std::size_t vertex_count = 0;
+    glm::vec3 normal_sum(0.0f);
+    candidates.clear();
+
+    const auto new_vertices = [&](const std::uint32_t t) {
+      std::size_t count = 0;
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const unsigned int vertex = indices[t * 3 + corner];
+        const bool repeated = (corner > 0 && indices[t * 3] == vertex) || (corner > 1 && indices[t * 3 + 1] == vertex);
+        count += vertex_owner[vertex] != id && !repeated;
+      }
+      return count;
+    };
+    const auto add = [&](const std::uint32_t t) {
+      triangle_owner[t] = id;
+      order.push_back(t);
+      meshlet.index_count += 3;
+      normal_sum += normals[t];
+      for (std::size_t corner = 0; corner < 3; corner++)
+      {
+        const unsigned int vertex = indices[t * 3 + corner];
+        if (vertex_owner[vertex] == id)
+        {
+          continue;
+        }
+        vertex_owner[vertex] = id;
+        vertex_count++;
+        for (std::uint32_t k = first_triangle[vertex]; k < first_triangle[vertex + 1]; k++)
+        {
+          if (triangle_owner[vertex_triangles[k]] == kNoMeshlet)
+          {
+            candidates.push_back(vertex_triangles[k]);
+          }
+        }
+      }
+    };
+
+    // Grows the meshlet from the first free triangle, in vertex cache order,
+    // through the neighbour adding the fewest vertices, then the one closest to
+    // the meshlet's average normal, which keeps the normal cone narrow
+    add(static_cast<std::uint32_t>(next_seed));
+    while (meshlet.index_count / 3 < kMeshletMaxTriangles)
+    {
+      const float axis_length = glm::length(normal_sum);
+      const glm::vec3 axis = axis_length > 0.0f ? normal_sum / axis_length : glm::vec3(0.0f);
+      constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+      std::size_t best = kNone;
+      std::size_t best_new_vertices = 3;
+      float best_dot = 0.0f;
+      for (std::size_t c = 0; c < candidates.size();)
+      {
+        const std::uint32_t t = candidates[c];
+        if (triangle_owner[t] != kNoMeshlet)
+        {
+          candidates[c] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+        const std::size_t added = new_vertices(t);
+        const float dot = glm::dot(normals[t], axis);
+        if (vertex_count + added <= kMeshletMaxVertices &&
+            (best == kNone || added < best_new_vertices || (added == best_new_vertices && dot > best_dot)))
+        {
+          best = c;
+          best_new_vertices = added;
+          best_dot = dot;
+        }
+        c++;
+      }
+      if (best == kNone)
+      {
+        break;
+      }
+      add(candidates[best]);
+    }
+    meshlets.push_back(meshlet);
+  }
+
+  std::vector<unsigned int> reordered(indices.size());
+  for (std::size_t i = 0; i < order.size(); i++)
+  {
+    std::copy_n(indices.begin() + order[i] * 3, 3, reordered.begin() + i * 3);
+  }
+  std::ranges::copy(reordered, indices.begin());
+
+  // Growth order is not cache friendly: each meshlet is run through
+  // OptimizeVertexCache again, on vertices numbered inside the meshlet
+  std::vector<std::uint32_t> local_vertex(vertices.size(), kNoMeshlet);
+  std::vector<unsigned int> global_vertices;
+  std::vector<unsigned int> local_indices;
+  for (Meshlet& meshlet : meshlets)
+  {
+    const std::span<unsigned int> range = indices.subspan(meshlet.first_index, meshlet.index_count);
+    global_vertices.clear();
+    local_indices.clear();
+    for (const unsigned int index : range)
+    {
+      if (local_vertex[index] == kNoMeshlet)
+      {
+        local_vertex[index] = static_cast<std::uint32_t>(global_vertices.size());
+        global_vertices.push_back(index);
+      }
+      local_indices.push_back(local_vertex[index]);
+    }
+    OptimizeVertexCache(local_indices, global_vertices.size());
+    std::ranges::transform(local_indices, range.begin(), [&](const unsigned int local) { return global_vertices[local]; });
+    for (const unsigned int vertex : global_vertices)
+    {
+      local_vertex[vertex] = kNoMeshlet;
+    }
+    ComputeMeshletBounds(meshlet, vertices, indices);
+  }
+  return meshlets;
+}
+
+MeshletCullStats CullMeshlets(const std::span<const Meshlet> meshlets, const glm::mat4& transform,
+                              const Frustum& frustum, const glm::vec3& camera_position,
+                              std::vector<IndexRange>& visible)
+{
+  MeshletCullStats stats;
+  stats.meshlet_count = meshlets.size();
+  if (meshlets.empty())
+  {
+    return stats;
+  }
+
+  const float scale = MaxScale(transform);
+  // Cones are tested in object space, where they were built
+  const glm::vec3 camera = glm::vec3(glm::inverse(transform) * glm::vec4(camera_position, 1.0f));
+
+  const std::size_t first_range = visible.size();
+  for (const Meshlet& meshlet : meshlets)
+  {
+    stats.triangle_count += meshlet.index_count / 3;
+    if (glm::dot(glm::normalize(meshlet.cone_apex - camera), meshlet.cone_axis) >= meshlet.cone_cutoff)
+    {
+      continue;
+    }
+    const glm::vec3 center = glm::vec3(transform * glm::vec4(meshlet.center, 1.0f));
+    if (!frustum.IsSphereInFrustum(Sphere(center, meshlet.radius * scale)))
+    {
+      continue;
+    }
+
+    stats.visible_meshlet_count++;
+    stats.visible_triangle_count += meshlet.index_count / 3;
+    // Meshlets are consecutive in the index buffer: visible neighbours make one draw
+    if (visible.size() > first_range &&
+        visible.back().first_index + visible.back().index_count == meshlet.first_index)
+    {
+      visible.back().index_count += meshlet.index_count;
+    }
+    else
+    {
+      visible.push_back({meshlet.first_index, meshlet.index_count});
+    }
+  }
+  return stats;
+}
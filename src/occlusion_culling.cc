@@ -0,0 +1,452 @@
+#include "occlusion_culling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+#include "mesh.h"
+#include "thread_pool.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Occluder vertices farther than this from the screen center, in NDC units,
+// drop their triangles: window coordinates stay small enough for float edges
+constexpr float kOcclusionGuardBand = 64.0f;
+
+// Added to occluder depths, several times the float rounding error of the
+// depth plane (about 3e-7 against double precision), so that occluders end
+// up farther than they are, never nearer
+constexpr float kOcclusionDepthBias = 2e-6f;
+
+bool IsOccluderVertexKept(const glm::vec4& clip)
+{
+  const float guard = kOcclusionGuardBand * clip.w;
+  return clip.w > 0.0f && clip.z >= -clip.w && std::abs(clip.x) <= guard && std::abs(clip.y) <= guard;
+}
+
+// Pixels of rows [first_row, last_row] whose center is inside triangle keep
+// the nearer of their depth and the triangle's. The SIMD loops start on a
+// multiple of their width, never past the row since kWidth is one, and
+// compute every pixel with the same operations as the scalar loop.
+void RasterizeRows(const OcclusionCuller::Triangle& triangle, const int first_row, const int last_row,
+                   float* const depth)
+{
+#if defined(__AVX2__)
+  const __m256 lane_centers = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+  const __m256 edge0_a = _mm256_set1_ps(triangle.edge_a[0]);
+  const __m256 edge1_a = _mm256_set1_ps(triangle.edge_a[1]);
+  const __m256 edge2_a = _mm256_set1_ps(triangle.edge_a[2]);
+  const __m256 depth_a = _mm256_set1_ps(triangle.depth_a);
+  const __m256 zero = _mm256_setzero_ps();
+  for (int y = first_row; y <= last_row; y++)
+  {
+    const float center_y = static_cast<float>(y) + 0.5f;
+    const __m256 edge0_row = _mm256_set1_ps(triangle.edge_b[0] * center_y + triangle.edge_c[0]);
+    const __m256 edge1_row = _mm256_set1_ps(triangle.edge_b[1] * center_y + triangle.edge_c[1]);
+    const __m256 edge2_row = _mm256_set1_ps(triangle.edge_b[2] * center_y + triangle.edge_c[2]);
+    const __m256 depth_row = _mm256_set1_ps(triangle.depth_b * center_y + triangle.depth_c);
+    float* const row = depth + y * OcclusionCuller::kWidth;
+    for (int x = triangle.min_x & ~7; x <= triangle.max_x; x += 8)
+    {
+      const __m256 center_x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lane_centers);
+      const __m256 edge0 = _mm256_add_ps(_mm256_mul_ps(edge0_a, center_x), edge0_row);
+      const __m256 edge1 = _mm256_add_ps(_mm256_mul_ps(edge1_a, center_x), edge1_row);
+      const __m256 edge2 = _mm256_add_ps(_mm256_mul_ps(edge2_a, center_x), edge2_row);
+      const __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(edge0, zero, _CMP_GE_OQ),
+                                                        _mm256_cmp_ps(edge1, zero, _CMP_GE_OQ)),
+                                          _mm256_cmp_ps(edge2, zero, _CMP_GE_OQ));
+      const __m256 triangle_depth = _mm256_add_ps(_mm256_mul_ps(depth_a, center_x), depth_row);
+      const __m256 old_depth = _mm256_loadu_ps(row + x);
+      _mm256_storeu_ps(row + x, _mm256_blendv_ps(old_depth, _mm256_min_ps(old_depth, triangle_depth), inside));
+    }
+  }
+#elif defined(OCCLUSION_CULLING_SSE2)
+  const __m128 lane_centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+  const __m128 edge0_a = _mm_set1_ps(triangle.edge_a[0]);
+  const __m128 edge1_a = _mm_set1_ps(triangle.edge_a[1]);
+  const __m128 edge2_a = _mm_set1_ps(triangle.edge_a[2]);
+  const __m128 depth_a = _mm_set1_ps(triangle.depth_a);
+  const __m128 zero = _mm_setzero_ps();
+  for (int y = first_row; y <= last_row; y++)
+  {
+    const float center_y = static_cast<float>(y) + 0.5f;
+    const __m128 edge0_row = _mm_set1_ps(triangle.edge_b[0] * center_y + triangle.edge_c[0]);
+    const __m128 edge1_row = _mm_set1_ps(triangle.edge_b[1] * center_y + triangle.edge_c[1]);
+    const __m128 edge2_row = _mm_set1_ps(triangle.edge_b[2] * center_y + triangle.edge_c[2]);
+    const __m128 depth_row = _mm_set1_ps(triangle.depth_b * center_y + triangle.depth_c);
+    float* const row = depth + y * OcclusionCuller::kWidth;
+    for (int x = triangle.min_x & ~3; x <= triangle.max_x; x += 4)
+    {
+      const __m128 center_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane_centers);
+      const __m128 edge0 = _mm_add_ps(_mm_mul_ps(edge0_a, center_x), edge0_row);
+      const __m128 edge1 = _mm_add_ps(_mm_mul_ps(edge1_a, center_x), edge1_row);
+      const __m128 edge2 = _mm_add_ps(_mm_mul_ps(edge2_a, center_x), edge2_row);
+      const __m128 inside =
+          _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+      const __m128 triangle_depth = _mm_add_ps(_mm_mul_ps(depth_a, center_x), depth_row);
+      const __m128 old_depth = _mm_loadu_ps(row + x);
+      const __m128 new_depth = _mm_min_ps(old_depth, triangle_depth);
+      _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+    }
+  }
+#else
+  for (int y = first_row; y <= last_row; y++)
+  {
+    const float center_y = static_cast<float>(y) + 0.5f;
+    const float edge0_row = triangle.edge_b[0] * center_y + triangle.edge_c[0];
+    const float edge1_row = triangle.edge_b[1] * center_y + triangle.edge_c[1];
+    const float edge2_row = triangle.edge_b[2] * center_y + triangle.edge_c[2];
+    const float depth_row = triangle.depth_b * center_y + triangle.depth_c;
+    float* const row = depth + y * OcclusionCuller::kWidth;
+    for (int x = triangle.min_x; x <= triangle.max_x; x++)
+    {
+      const float center_x = static_cast<float>(x) + 0.5f;
+      if (triangle.edge_a[0] * center_x + edge0_row >= 0.0f && triangle.edge_a[1] * center_x + edge1_row >= 0.0f &&
+          triangle.edge_a[2] * center_x + edge2_row >= 0.0f)
+      {
+        row[x] = std::min(row[x], triangle.depth_a * center_x + depth_row);
+      }
+    }
+  }
+#endif
+}
+} // namespace
+
+OcclusionCuller::OcclusionCuller()
+{
+  depth_.fill(1.0f);
+  tile_max_depth_.fill(1.0f);
+}
+
+std::uint32_t OcclusionCuller::AddOccluder(const std::span<const glm::vec3> positions,
+                                           const std::span<const unsigned int> indices)
+{
+  const std::size_t index_count = indices.size() - indices.size() % 3;
+  for (std::size_t i = 0; i < index_count; i++)
+  {
+    if (indices[i] >= positions.size())
+    {
+      std::cerr << "ERROR::OCCLUSION_CULLING::INDEX_OUT_OF_RANGE: " << indices[i] << " of " << positions.size()
+                << " positions" << std::endl;
+      return kNoOccluder;
+    }
+  }
+  occluders_.push_back({static_cast<std::uint32_t>(positions_.size()), static_cast<std::uint32_t>(positions.size()),
+                        static_cast<std::uint32_t>(indices_.size()), static_cast<std::uint32_t>(index_count)});
+  positions_.insert(positions_.end(), positions.begin(), positions.end());
+  indices_.insert(indices_.end(), indices.begin(), indices.begin() + static_cast<std::ptrdiff_t>(index_count));
+  // Room for a frame placing every occluder once, so that Add and Rasterize
+  // do not allocate as more of them come into view
+  instances_.reserve(occluders_.size());
+  clip_vertices_.resize(std::max(clip_vertices_.size(), positions_.size()));
+  triangles_.resize(std::max(triangles_.size(), indices_.size() / 3));
+  return static_cast<std::uint32_t>(occluders_.size() - 1);
+}
+
+std::uint32_t OcclusionCuller::AddOccluder(const Mesh& mesh)
+{
+  if (!mesh.has_cpu_data())
+  {
+    return kNoOccluder;
+  }
+  std::vector<glm::vec3> positions;
+  positions.reserve(mesh.vertices().size());
+  for (const Vertex& vertex : mesh.vertices())
+  {
+    positions.push_back(vertex.Position);
+  }
+  return AddOccluder(positions, mesh.indices());
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+  positions_.clear();
+  indices_.clear();
+  occluders_.clear();
+  instances_.clear();
+  vertex_count_ = 0;
+  triangle_count_ = 0;
+}
+
+void OcclusionCuller::Begin(const glm::mat4& view_projection)
+{
+  view_projection_ = view_projection;
+  instances_.clear();
+  vertex_count_ = 0;
+  triangle_count_ = 0;
+}
+
+void OcclusionCuller::Add(const std::uint32_t occluder, const glm::mat4& transform)
+{
+  if (occluder >= occluders_.size())
+  {
+    return;
+  }
+  instances_.push_back({view_projection_ * transform, occluder, static_cast<std::uint32_t>(vertex_count_),
+                        static_cast<std::uint32_t>(triangle_count_), 0});
+  vertex_count_ += occluders_[occluder].position_count;
+  triangle_count_ += occluders_[occluder].index_count / 3;
+}
+
+void OcclusionCuller::Rasterize(gpr5300::ThreadPool* const pool)
+{
+  // Every instance writes its own range: sized here, the parallel part never
+  // allocates. Only frames placing an occluder more than once grow them.
+  if (clip_vertices_.size() < vertex_count_)
+  {
+    clip_vertices_.resize(vertex_count_);
+  }
+  if (triangles_.size() < triangle_count_)
+  {
+    triangles_.resize(triangle_count_);
+  }
+
+  const auto setup = [this](const std::size_t i) { SetupInstance(instances_[i]); };
+  const auto band = [this](const std::size_t i) { RasterizeBand(static_cast<int>(i)); };
+  constexpr std::size_t kBandCount = kHeight / kBandHeight;
+  if (pool != nullptr)
+  {
+    pool->ParallelFor(instances_.size(), setup);
+    pool->ParallelFor(kBandCount, band);
+  }
+  else
+  {
+    for (std::size_t i = 0; i < instances_.size(); i++)
+    {
+      setup(i);
+    }
+    for (std::size_t i = 0; i < kBandCount; i++)
+    {
+      band(i);
+    }
+  }
+
+  drawn_triangle_count_ = 0;
+  for (const Instance& instance : instances_)
+  {
+    drawn_triangle_count_ += instance.drawn_triangles;
+  }
+}
+
+void OcclusionCuller::SetupInstance(Instance& instance)
+{
+  const Occluder& occluder = occluders_[instance.occluder];
+  glm::vec4* const clip = clip_vertices_.data() + instance.first_vertex;
+  for (std::uint32_t i = 0; i < occluder.position_count; i++)
+  {
+    clip[i] = instance.clip_from_local * glm::vec4(positions_[occluder.first_position + i], 1.0f);
+  }
+
+  instance.drawn_triangles = 0;
+  const unsigned int* const indices = indices_.data() + occluder.first_index;
+  for (std::uint32_t t = 0; t < occluder.index_count / 3; t++)
+  {
+    Triangle& triangle = triangles_[instance.first_triangle + t];
+    if (SetupTriangle(clip[indices[3 * t]], clip[indices[3 * t + 1]], clip[indices[3 * t + 2]], triangle))
+    {
+      instance.drawn_triangles++;
+    }
+    else
+    {
+      triangle.min_x = 1;
+      triangle.max_x = 0;
+    }
+  }
+}
+
+void OcclusionCuller::RasterizeBand(const int band)
+{
+  const int first_row = band * kBandHeight;
+  const int last_row = first_row + kBandHeight - 1;
+  std::fill_n(depth_.begin() + first_row * kWidth, kBandHeight * kWidth, 1.0f);
+  for (std::size_t t = 0; t < triangle_count_; t++)
+  {
+    const Triangle& triangle = triangles_[t];
+    if (triangle.min_x > triangle.max_x || triangle.max_y < first_row || triangle.min_y > last_row)
+    {
+      continue;
+    }
+    RasterizeRows(triangle, std::max(triangle.min_y, first_row), std::min(triangle.max_y, last_row), depth_.data());
+  }
+
+  for (int tile_y = first_row / kTileSize; tile_y <= last_row / kTileSize; tile_y++)
+  {
+    for (int tile_x = 0; tile_x < kTilesX; tile_x++)
+    {
+      float farthest = 0.0f;
+      for (int y = tile_y * kTileSize; y < (tile_y + 1) * kTileSize; y++)
+      {
+        const float* const row = depth_.data() + y * kWidth + tile_x * kTileSize;
+        for (int x = 0; x < kTileSize; x++)
+        {
+          farthest = std::max(farthest, row[x]);
+        }
+      }
+      tile_max_depth_[tile_y * kTilesX + tile_x] = farthest;
+    }
+  }
+}
+
+bool OcclusionCuller::IsBoxVisible(const glm::vec3& min, const glm::vec3& max) const
+{
+  glm::vec3 window_min(FLT_MAX);
+  glm::vec3 window_max(-FLT_MAX);
+  for (int corner = 0; corner < 8; corner++)
+  {
+    const glm::vec4 clip = view_projection_ * glm::vec4((corner & 1) != 0 ? max.x : min.x,
+                                                        (corner & 2) != 0 ? max.y : min.y,
+                                                        (corner & 4) != 0 ? max.z : min.z, 1.0f);
+    if (!(clip.w > 0.0f && clip.z >= -clip.w))
+    {
+      return true;
+    }
+    const glm::vec3 window = ToWindow(clip);
+    window_min = glm::min(window_min, window);
+    window_max = glm::max(window_max, window);
+  }
+  // Every pixel the rectangle touches, clamped before the conversion to int
+  const auto to_pixel = [](const float coordinate, const int size) {
+    return static_cast<int>(std::floor(std::clamp(coordinate, -1.0f, static_cast<float>(size))));
+  };
+  return IsRectVisible(to_pixel(window_min.x, kWidth), to_pixel(window_min.y, kHeight),
+                       to_pixel(window_max.x, kWidth), to_pixel(window_max.y, kHeight), window_min.z);
+}
+
+bool OcclusionCuller::IsSphereVisible(const BoundingSphere& sphere) const
+{
+  return IsBoxVisible(sphere.center - glm::vec3(sphere.radius), sphere.center + glm::vec3(sphere.radius));
+}
+
+bool OcclusionCuller::IsRectVisible(int min_x, int min_y, int max_x, int max_y, const float depth) const
+{
+  // Off screen: frustum culling decides
+  if (min_x > max_x || min_y > max_y || max_x < 0 || max_y < 0 || min_x >= kWidth || min_y >= kHeight)
+  {
+    return true;
+  }
+  min_x = std::max(min_x, 0);
+  min_y = std::max(min_y, 0);
+  max_x = std::min(max_x, kWidth - 1);
+  max_y = std::min(max_y, kHeight - 1);
+  for (int tile_y = min_y / kTileSize; tile_y <= max_y / kTileSize; tile_y++)
+  {
+    for (int tile_x = min_x / kTileSize; tile_x <= max_x / kTileSize; tile_x++)
+    {
+      // Every pixel of the tile is nearer than the object
+      if (tile_max_depth_[tile_y * kTilesX + tile_x] < depth)
+      {
+        continue;
+      }
+      const int first_x = std::max(min_x, tile_x * kTileSize);
+      const int last_x = std::min(max_x, tile_x * kTileSize + kTileSize - 1);
+      const int first_y = std::max(min_y, tile_y * kTileSize);
+      const int last_y = std::min(max_y, tile_y * kTileSize + kTileSize - 1);
+      for (int y = first_y; y <= last_y; y++)
+      {
+        for (int x = first_x; x <= last_x; x++)
+        {
+          if (depth_[y * kWidth + x] >= depth)
+          {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+glm::vec3 OcclusionCuller::ToWindow(const glm::vec4& clip)
+{
+  const float inverse_w = 1.0f / clip.w;
+  return {(clip.x * inverse_w * 0.5f + 0.5f) * static_cast<float>(kWidth),
+          (clip.y * inverse_w * 0.5f + 0.5f) * static_cast<float>(kHeight), clip.z * inverse_w * 0.5f + 0.5f};
+}
+
+bool OcclusionCuller::SetupTriangle(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2,
+                                    Triangle& triangle)
+{
+  // Not clipped against the near plane: dropping the triangle only hides less
+  if (!IsOccluderVertexKept(clip0) || !IsOccluderVertexKept(clip1) || !IsOccluderVertexKept(clip2))
+  {
+    return false;
+  }
+  const glm::vec3 v0 = ToWindow(clip0);
+  const glm::vec3 v1 = ToWindow(clip1);
+  const glm::vec3 v2 = ToWindow(clip2);
+
+  // Both windings are drawn: counterclockwise order makes the inside positive
+  float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+  if (!(std::abs(area) > 0.0f))
+  {
+    return false;
+  }
+  const glm::vec3 a = v0;
+  glm::vec3 b = v1;
+  glm::vec3 c = v2;
+  if (area < 0.0f)
+  {
+    std::swap(b, c);
+    area = -area;
+  }
+
+  // Pixel centers inside the bounds: x + 0.5 in [min, max]
+  const auto first_pixel = [](const float min, const int size) {
+    return std::max(0, static_cast<int>(std::ceil(std::clamp(min - 0.5f, -1.0f, static_cast<float>(size)))));
+  };
+  const auto last_pixel = [](const float max, const int size) {
+    return std::min(size - 1, static_cast<int>(std::floor(std::clamp(max - 0.5f, -1.0f, static_cast<float>(size)))));
+  };
+  triangle.min_x = first_pixel(std::min({a.x, b.x, c.x}), kWidth);
+  triangle.max_x = last_pixel(std::max({a.x, b.x, c.x}), kWidth);
+  triangle.min_y = first_pixel(std::min({a.y, b.y, c.y}), kHeight);
+  triangle.max_y = last_pixel(std::max({a.y, b.y, c.y}), kHeight);
+  if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+  {
+    return false;
+  }
+
+  // Edge e is zero on the side facing vertex e and equals area on that vertex.
+  // Both triangles of a shared edge compute it from the same window
+  // coordinates, to exactly opposite values: no pixel falls between them.
+  // edge_c is rounded once from exact double products, so that contracting
+  // it into a multiply-add (FMA) cannot break that symmetry.
+  const std::pair<const glm::vec3&, const glm::vec3&> edges[3] = {{b, c}, {c, a}, {a, b}};
+  for (int e = 0; e < 3; e++)
+  {
+    const glm::vec3& from = edges[e].first;
+    const glm::vec3& to = edges[e].second;
+    triangle.edge_a[e] = from.y - to.y;
+    triangle.edge_b[e] = to.x - from.x;
+    triangle.edge_c[e] = static_cast<float>(static_cast<double>(from.x) * to.y - static_cast<double>(from.y) * to.x);
+  }
+  // Depth plane through a, from the vertex differences rather than the large
+  // edge_c terms, which cancel; pushed kOcclusionDepthBias farther
+  const float inverse_area = 1.0f / area;
+  const glm::vec3 ab = b - a;
+  const glm::vec3 ac = c - a;
+  triangle.depth_a = (ab.z * ac.y - ac.z * ab.y) * inverse_area;
+  triangle.depth_b = (ac.z * ab.x - ab.z * ac.x) * inverse_area;
+  triangle.depth_c = a.z - triangle.depth_a * a.x - triangle.depth_b * a.y + kOcclusionDepthBias;
+  return true;
+}
+
+const char* OcclusionCullingIsa()
+{
+#if defined(__AVX2__)
+  return "AVX2";
+#elif defined(OCCLUSION_CULLING_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,164 @@
+#include "shader_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+#include "file_utility.h"
+#include "hash_utility.h"
+
+namespace
+{
+constexpr char kProgramCacheMagic[8] = {'S', '3', 'D', 'P', 'R', 'O', 'G', '\0'};
+constexpr std::uint32_t kProgramCacheVersion = 1;
+
+struct ProgramCacheHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t binary_format;
+  std::uint64_t key;
+  std::uint64_t binary_size;
+  double compile_milliseconds;
+};
+
+std::string_view GlString(const GLenum name)
+{
+  const auto* value = reinterpret_cast<const char*>(glGetString(name));
+  return value ? std::string_view(value) : std::string_view();
+}
+} // namespace
+
+ProgramCache& ProgramCache::Default()
+{
+  static ProgramCache cache;
+  return cache;
+}
+
+bool ProgramCache::enabled() const
+{
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  return format_count > 0 && !directory_.empty();
+}
+
+std::uint64_t ProgramCache::Key(const std::string_view vertex_source, const std::string_view fragment_source) const
+{
+  std::uint64_t hash = gpr5300::HashValue(gpr5300::kFnvOffsetBasis, kProgramCacheVersion);
+  // Sizes separate the fields so moving text from one shader to the other changes the key
+  for (const std::string_view text : {vertex_source, fragment_source, GlString(GL_VENDOR), GlString(GL_RENDERER),
+                                      GlString(GL_VERSION)})
+  {
+    hash = gpr5300::HashValue(hash, static_cast<std::uint64_t>(text.size()));
+    hash = gpr5300::HashBytes(hash, text.data(), text.size());
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+std::string ProgramCache::EntryPath(const std::uint64_t key) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return directory_ + '/' + name;
+}
+
+unsigned int ProgramCache::Load(const std::uint64_t key)
+{
+  if (!enabled())
+  {
+    misses_++;
+    return 0;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const std::string path = EntryPath(key);
+  gpr5300::MappedFile file(path);
+  ProgramCacheHeader header{};
+  if (file.size() >= sizeof(header))
+  {
+    std::memcpy(&header, file.bytes().data(), sizeof(header));
+  }
+  if (file.size() < sizeof(header) || std::memcmp(header.magic, kProgramCacheMagic, sizeof(kProgramCacheMagic)) != 0 ||
+      header.version != kProgramCacheVersion || header.key != key ||
+      file.size() - sizeof(header) < header.binary_size)
+  {
+    misses_++;
+    return 0;
+  }
+
+  const unsigned int program = glCreateProgram();
+  glProgramBinary(program, header.binary_format, file.bytes().data() + sizeof(header),
+                  static_cast<GLsizei>(header.binary_size));
+  GLint success = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    // Usually a driver update that kept the same version string
+    glDeleteProgram(program);
+    file.Close();
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    rejected_++;
+    misses_++;
+    return 0;
+  }
+
+  hits_++;
+  const double load_milliseconds =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  saved_milliseconds_ += std::max(0.0, header.compile_milliseconds - load_milliseconds);
+  return program;
+}
+
+void ProgramCache::Store(const std::uint64_t key, const unsigned int program, const double compile_milliseconds)
+{
+  if (!enabled())
+  {
+    return;
+  }
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+  {
+    return;
+  }
+  std::vector<char> binary(static_cast<std::size_t>(length));
+  GLenum binary_format = 0;
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &binary_format, binary.data());
+  if (written <= 0)
+  {
+    return;
+  }
+
+  ProgramCacheHeader header{};
+  std::memcpy(header.magic, kProgramCacheMagic, sizeof(kProgramCacheMagic));
+  header.version = kProgramCacheVersion;
+  header.binary_format = binary_format;
+  header.key = key;
+  header.binary_size = static_cast<std::uint64_t>(written);
+  header.compile_milliseconds = compile_milliseconds;
+
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  // Written under a temporary name so a crash never leaves a truncated entry behind
+  const std::string path = EntryPath(key);
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(binary.data(), written);
+    if (!out)
+    {
+      std::cerr << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << path << "\n";
+      return;
+    }
+  }
+  std::filesystem::rename(temp_path, path, error);
+}
@@ -0,0 +1,79 @@
+#include "shader_include.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include "file_utility.h"
+
+namespace
+{
+constexpr int kMaxIncludeDepth = 8;
+
+std::string_view TrimLeft(std::string_view line)
+{
+  while (!line.empty() && (line.front() == ' ' || line.front() == '\t'))
+  {
+    line.remove_prefix(1);
+  }
+  return line;
+}
+
+void AppendExpanded(const std::filesystem::path& path, const std::string_view source, std::string& out,
+                    const int depth)
+{
+  std::size_t begin = 0;
+  while (begin < source.size())
+  {
+    std::size_t end = source.find('\n', begin);
+    end = end == std::string_view::npos ? source.size() : end + 1;
+    const std::string_view line = source.substr(begin, end - begin);
+    begin = end;
+
+    const std::string_view directive = TrimLeft(line);
+    if (directive.starts_with("#extension GL_GOOGLE_include_directive"))
+    {
+      // Only meaningful to glslangValidator
+      out += '\n';
+      continue;
+    }
+    if (!directive.starts_with("#include"))
+    {
+      out.append(line);
+      continue;
+    }
+
+    const std::size_t open = directive.find('"');
+    const std::size_t close = directive.find('"', open + 1);
+    if (open == std::string_view::npos || close == std::string_view::npos || depth >= kMaxIncludeDepth)
+    {
+      std::cerr << "ERROR::SHADER::BAD_INCLUDE " << path.generic_string() << ": " << directive;
+      continue;
+    }
+    const std::filesystem::path include_path =
+        (path.parent_path() / directive.substr(open + 1, close - open - 1)).lexically_normal();
+    const gpr5300::MappedFile include(include_path.string());
+    if (!include.is_open())
+    {
+      std::cerr << "ERROR::SHADER::MISSING_INCLUDE " << include_path.generic_string() << "\n";
+      continue;
+    }
+    AppendExpanded(include_path, include.text(), out, depth + 1);
+    if (!out.empty() && out.back() != '\n')
+    {
+      out += '\n';
+    }
+  }
+}
+} // namespace
+
+std::string_view ExpandShaderIncludes(const std::string& path, const std::string_view source, std::string& storage)
+{
+  if (source.find("#include") == std::string_view::npos)
+  {
+    return source;
+  }
+  storage.clear();
+  storage.reserve(source.size() * 2);
+  AppendExpanded(path, source, storage, 0);
+  return storage;
+}
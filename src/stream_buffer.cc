@@ -0,0 +1,104 @@
+#include "stream_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+namespace
+{
+// Upper bound of one wait in BeginFrame before it flushes and tries again
+constexpr GLuint64 kStreamFenceTimeoutNs = 1'000'000;
+} // namespace
+
+StreamBuffer::StreamBuffer(const std::size_t frame_capacity) : frame_capacity_(frame_capacity)
+{
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  uniform_alignment_ = std::max<std::size_t>(alignment, 1);
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  storage_alignment_ = std::max<std::size_t>(alignment, 1);
+  // Every segment starts on an offset usable by any binding
+  frame_capacity_ = (frame_capacity_ + 255) / 256 * 256;
+
+  constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const auto bytes = static_cast<GLsizeiptr>(frame_capacity_ * kRingSize);
+  glCreateBuffers(1, &buffer_);
+  glNamedBufferStorage(buffer_, bytes, nullptr, flags);
+  mapped_ = static_cast<std::byte*>(glMapNamedBufferRange(buffer_, 0, bytes, flags));
+  if (mapped_ == nullptr)
+  {
+    // Every Allocate then returns an empty slice
+    std::cerr << "ERROR::STREAM_BUFFER::MAPPING_FAILED\n";
+    frame_capacity_ = 0;
+  }
+}
+
+StreamBuffer::~StreamBuffer()
+{
+  for (GLsync& fence : fences_)
+  {
+    if (fence)
+    {
+      glDeleteSync(fence);
+    }
+  }
+  if (mapped_)
+  {
+    glUnmapNamedBuffer(buffer_);
+  }
+  glDeleteBuffers(1, &buffer_);
+}
+
+StreamBuffer& StreamBuffer::Default()
+{
+  // Never destroyed: the GL context is gone by the time statics are torn down.
+  static auto* stream = new StreamBuffer();
+  return *stream;
+}
+
+void StreamBuffer::BeginFrame()
+{
+  GLsync& fence = fences_[current_];
+  if (fence)
+  {
+    // The GPU may still read what this segment held kRingSize frames ago
+    GLbitfield flags = 0;
+    GLenum status = glClientWaitSync(fence, flags, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      stall_count_++;
+      flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+      do
+      {
+        status = glClientWaitSync(fence, flags, kStreamFenceTimeoutNs);
+      } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  offset_ = 0;
+}
+
+void StreamBuffer::EndFrame()
+{
+  fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  last_frame_bytes_ = offset_;
+  current_ = (current_ + 1) % kRingSize;
+}
+
+std::byte* StreamBuffer::AllocateBytes(const std::size_t size, const std::size_t alignment)
+{
+  const std::size_t aligned = (offset_ + alignment - 1) / alignment * alignment;
+  if (aligned + size > frame_capacity_)
+  {
+    if (!overflow_reported_)
+    {
+      std::cerr << "ERROR::STREAM_BUFFER::FRAME_CAPACITY_EXCEEDED " << aligned + size << " > " << frame_capacity_
+                << " bytes\n";
+      overflow_reported_ = true;
+    }
+    return nullptr;
+  }
+  offset_ = aligned + size;
+  return mapped_ + current_ * frame_capacity_ + aligned;
+}
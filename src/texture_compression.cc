@@ -0,0 +1,787 @@
+#include "texture_compression.h"
+#include "file_utility.h"
+#include "texture_loader.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <GL/glew.h>
+
+namespace
+{
+
+// Working copy of one mip level, always 4 channels
+struct Rgba8Image
+{
+  int width = 0;
+  int height = 0;
+  std::vector<std::uint8_t> texels;
+};
+
+using Block = std::array<std::array<float, 4>, 16>;
+
+Rgba8Image ExpandToRgba8(const Image& image)
+{
+  Rgba8Image result{image.width, image.height, {}};
+  const std::size_t count = static_cast<std::size_t>(image.width) * image.height;
+  result.texels.resize(count * 4);
+  const auto* src = static_cast<const std::uint8_t*>(image.pixel);
+  for (std::size_t i = 0; i < count; i++)
+  {
+    const std::uint8_t* texel = src + i * image.comp;
+    std::uint8_t* dst = &result.texels[i * 4];
+    switch (image.comp)
+    {
+      case 1: dst[0] = dst[1] = dst[2] = texel[0]; dst[3] = 255; break;
+      case 2: dst[0] = dst[1] = dst[2] = texel[0]; dst[3] = texel[1]; break;
+      case 3: dst[0] = texel[0]; dst[1] = texel[1]; dst[2] = texel[2]; dst[3] = 255; break;
+      default: std::memcpy(dst, texel, 4); break;
+    }
+  }
+  return result;
+}
+
+// 2x2 box filter. Normal maps are renormalized so that shorter mips do not darken the lighting.
+Rgba8Image Downsample(const Rgba8Image& src, const bool normal_map)
+{
+  Rgba8Image dst{std::max(1, src.width / 2), std::max(1, src.height / 2), {}};
+  dst.texels.resize(static_cast<std::size_t>(dst.width) * dst.height * 4);
+  for (int y = 0; y < dst.height; y++)
+  {
+    for (int x = 0; x < dst.width; x++)
+    {
+      const int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+      const int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+      float sum[4] = {};
+      for (const int sy : {y0, y1})
+        for (const int sx : {x0, x1})
+          for (int c = 0; c < 4; c++)
+            sum[c] += src.texels[(static_cast<std::size_t>(sy) * src.width + sx) * 4 + c];
+
+      std::uint8_t* texel = &dst.texels[(static_cast<std::size_t>(y) * dst.width + x) * 4];
+      if (normal_map)
+      {
+        float n[3];
+        for (int c = 0; c < 3; c++)
+          n[c] = sum[c] / (4.0f * 127.5f) - 1.0f;
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int c = 0; c < 3; c++)
+          sum[c] = ((length > 0.0f ? n[c] / length : 0.0f) + 1.0f) * 127.5f * 4.0f;
+      }
+      for (int c = 0; c < 4; c++)
+        texel[c] = static_cast<std::uint8_t>(std::clamp(sum[c] / 4.0f + 0.5f, 0.0f, 255.0f));
+    }
+  }
+  return dst;
+}
+
+Block FetchBlock(const Rgba8Image& image, const int block_x, const int block_y)
+{
+  Block block{};
+  for (int i = 0; i < 16; i++)
+  {
+    const int x = std::min(block_x * 4 + i % 4, image.width - 1);
+    const int y = std::min(block_y * 4 + i / 4, image.height - 1);
+    const std::uint8_t* texel = &image.texels[(static_cast<std::size_t>(y) * image.width + x) * 4];
+    for (int c = 0; c < 4; c++)
+      block[i][c] = texel[c];
+  }
+  return block;
+}
+
+// Principal axis of the block's colours (power iteration on the covariance
+// matrix), returned with the two texels projecting furthest along it.
+void FitPrincipalAxis(const Block& block, const int channels, std::array<float, 4>& low, std::array<float, 4>& high)
+{
+  std::array<float, 4> mean{};
+  for (const auto& texel : block)
+    for (int c = 0; c < channels; c++)
+      mean[c] += texel[c] / 16.0f;
+
+  float covariance[4][4] = {};
+  for (const auto& texel : block)
+    for (int a = 0; a < channels; a++)
+      for (int b = 0; b < channels; b++)
+        covariance[a][b] += (texel[a] - mean[a]) * (texel[b] - mean[b]);
+
+  std::array<float, 4> axis{1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++)
+  {
+    std::array<float, 4> next{};
+    float length = 0.0f;
+    for (int a = 0; a < channels; a++)
+    {
+      for (int b = 0; b < channels; b++)
+        next[a] += covariance[a][b] * axis[b];
+      length = std::max(length, std::abs(next[a]));
+    }
+    if (length <= 0.0f)
+      break;
+    for (int a = 0; a < channels; a++)
+      axis[a] = next[a] / length;
+  }
+
+  float min_t = FLT_MAX, max_t = -FLT_MAX;
+  for (const auto& texel : block)
+  {
+    float t = 0.0f;
+    for (int c = 0; c < channels; c++)
+      t += (texel[c] - mean[c]) * axis[c];
+    if (t < min_t)
+    {
+      min_t = t;
+      low = texel;
+    }
+    if (t > max_t)
+    {
+      max_t = t;
+      high = texel;
+    }
+  }
+}
+
+// Least squares endpoints for fixed indices, where texel i is
+// lerp(e0, e1, weights[indices[i]]). Leaves the endpoints unchanged if the
+// system is degenerate (all texels on the same index).
+void RefineEndpoints(const Block& block, const int channels, const int* indices, const float* weights,
+                     std::array<float, 4>& e0, std::array<float, 4>& e1)
+{
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  std::array<float, 4> ax{}, bx{};
+  for (int i = 0; i < 16; i++)
+  {
+    const float b = weights[indices[i]];
+    const float a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < channels; c++)
+    {
+      ax[c] += a * block[i][c];
+      bx[c] += b * block[i][c];
+    }
+  }
+  const float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) < 1e-6f)
+    return;
+  for (int c = 0; c < channels; c++)
+  {
+    e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+    e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+  }
+}
+
+std::uint16_t PackRgb565(const std::array<float, 4>& color)
+{
+  const int r = std::clamp(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+  const int g = std::clamp(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+  const int b = std::clamp(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+  return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+}
+
+std::array<float, 4> UnpackRgb565(const std::uint16_t packed)
+{
+  const int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+  return {static_cast<float>(r << 3 | r >> 2), static_cast<float>(g << 2 | g >> 4),
+          static_cast<float>(b << 3 | b >> 2), 255.0f};
+}
+
+float DistanceSquared(const std::array<float, 4>& a, const std::array<float, 4>& b, const int channels)
+{
+  float distance = 0.0f;
+  for (int c = 0; c < channels; c++)
+    distance += (a[c] - b[c]) * (a[c] - b[c]);
+  return distance;
+}
+
+// Palette index -> weight of the second endpoint, in the order BC1 stores them
+constexpr float kBc1Weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+void SelectBc1Indices(const Block& block, const std::uint16_t c0, const std::uint16_t c1, int* indices)
+{
+  const std::array<float, 4> e0 = UnpackRgb565(c0), e1 = UnpackRgb565(c1);
+  std::array<std::array<float, 4>, 4> palette{};
+  for (int p = 0; p < 4; p++)
+    for (int c = 0; c < 3; c++)
+      palette[p][c] = e0[c] + (e1[c] - e0[c]) * kBc1Weights[p];
+  for (int i = 0; i < 16; i++)
+  {
+    float best = FLT_MAX;
+    for (int p = 0; p < 4; p++)
+    {
+      const float distance = DistanceSquared(block[i], palette[p], 3);
+      if (distance < best)
+      {
+        best = distance;
+        indices[i] = p;
+      }
+    }
+  }
+}
+
+void EncodeBc1(const Block& block, std::byte* out)
+{
+  std::array<float, 4> e0{}, e1{};
+  FitPrincipalAxis(block, 3, e1, e0);
+
+  std::uint16_t c0 = PackRgb565(e0), c1 = PackRgb565(e1);
+  int indices[16] = {};
+  if (c0 != c1)
+  {
+    SelectBc1Indices(block, c0, c1, indices);
+    RefineEndpoints(block, 3, indices, kBc1Weights, e0, e1);
+    c0 = PackRgb565(e0);
+    c1 = PackRgb565(e1);
+  }
+  // c0 > c1 selects the four colour mode
+  if (c0 < c1)
+    std::swap(c0, c1);
+  std::uint32_t bits = 0;
+  if (c0 != c1)
+  {
+    SelectBc1Indices(block, c0, c1, indices);
+    for (int i = 0; i < 16; i++)
+      bits |= static_cast<std::uint32_t>(indices[i]) << (2 * i);
+  }
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &bits, 4);
+}
+
+void EncodeBc4(const Block& block, const int channel, std::byte* out)
+{
+  float low = 255.0f, high = 0.0f;
+  for (const auto& texel : block)
+  {
+    low = std::min(low, texel[channel]);
+    high = std::max(high, texel[channel]);
+  }
+  const auto a0 = static_cast<std::uint8_t>(high + 0.5f);
+  const auto a1 = static_cast<std::uint8_t>(low + 0.5f);
+
+  std::uint64_t bits = 0;
+  if (a0 > a1)
+  {
+    // Eight value mode: index 0 = a0, 1 = a1, 2..7 = (8 - i) / 7 * a0 + (i - 1) / 7 * a1
+    float palette[8] = {static_cast<float>(a0), static_cast<float>(a1)};
+    for (int i = 2; i < 8; i++)
+      palette[i] = (static_cast<float>(8 - i) * a0 + static_cast<float>(i - 1) * a1) / 7.0f;
+    for (int i = 0; i < 16; i++)
+    {
+      int best_index = 0;
+      float best = FLT_MAX;
+      for (int p = 0; p < 8; p++)
+      {
+        const float distance = std::abs(block[i][channel] - palette[p]);
+        if (distance < best)
+        {
+          best = distance;
+          best_index = p;
+        }
+      }
+      bits |= static_cast<std::uint64_t>(best_index) << (3 * i);
+    }
+  }
+  out[0] = static_cast<std::byte>(a0);
+  out[1] = static_cast<std::byte>(a1);
+  for (int i = 0; i < 6; i++)
+    out[2 + i] = static_cast<std::byte>(bits >> (8 * i) & 0xFF);
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4-bit indices
+constexpr int kBc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Quantizes an endpoint to 7 bits per channel plus the p-bit that fits it best.
+void QuantizeBc7Endpoint(const std::array<float, 4>& endpoint, std::array<int, 4>& quantized, int& p_bit,
+                         std::array<float, 4>& reconstructed)
+{
+  float best = FLT_MAX;
+  for (int p = 0; p < 2; p++)
+  {
+    std::array<int, 4> candidate{};
+    std::array<float, 4> value{};
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++)
+    {
+      candidate[c] = std::clamp(static_cast<int>((endpoint[c] - p) / 2.0f + 0.5f), 0, 127);
+      value[c] = static_cast<float>(candidate[c] << 1 | p);
+      error += (value[c] - endpoint[c]) * (value[c] - endpoint[c]);
+    }
+    if (error < best)
+    {
+      best = error;
+      quantized = candidate;
+      p_bit = p;
+      reconstructed = value;
+    }
+  }
+}
+
+void SelectBc7Indices(const Block& block, const std::array<float, 4>& e0, const std::array<float, 4>& e1,
+                      int* indices)
+{
+  for (int i = 0; i < 16; i++)
+  {
+    float best = FLT_MAX;
+    for (int w = 0; w < 16; w++)
+    {
+      std::array<float, 4> value{};
+      for (int c = 0; c < 4; c++)
+        value[c] = std::floor(((64 - kBc7Weights[w]) * e0[c] + kBc7Weights[w] * e1[c] + 32) / 64.0f);
+      const float distance = DistanceSquared(block[i], value, 4);
+      if (distance < best)
+      {
+        best = distance;
+        indices[i] = w;
+      }
+    }
+  }
+}
+
+class BitWriter
+{
+ public:
+  explicit BitWriter(std::byte* out) : out_(out) { std::memset(out_, 0, 16); }
+
+  void Write(const std::uint32_t value, const int count)
+  {
+    for (int i = 0; i < count; i++, position_++)
+      if (value >> i & 1)
+        out_[position_ / 8] |= static_cast<std::byte>(1 << (position_ % 8));
+  }
+
+ private:
+  std::byte* out_;
+  int position_ = 0;
+};
+
+void EncodeBc7(const Block& block, std::byte* out)
+{
+  std::array<float, 4> e0{}, e1{};
+  FitPrincipalAxis(block, 4, e0, e1);
+
+  std::array<int, 4> q0{}, q1{};
+  int p0 = 0, p1 = 0;
+  std::array<float, 4> r0{}, r1{};
+  int indices[16] = {};
+  float weights[16];
+  for (int w = 0; w < 16; w++)
+    weights[w] = kBc7Weights[w] / 64.0f;
+
+  QuantizeBc7Endpoint(e0, q0, p0, r0);
+  QuantizeBc7Endpoint(e1, q1, p1, r1);
+  SelectBc7Indices(block, r0, r1, indices);
+  RefineEndpoints(block, 4, indices, weights, e0, e1);
+  QuantizeBc7Endpoint(e0, q0, p0, r0);
+  QuantizeBc7Endpoint(e1, q1, p1, r1);
+  SelectBc7Indices(block, r0, r1, indices);
+
+  // The first index is stored without its top bit, which must therefore be 0
+  if (indices[0] & 8)
+  {
+    std::swap(q0, q1);
+    std::swap(p0, p1);
+    for (int& index : indices)
+      index = 15 - index;
+  }
+
+  BitWriter writer(out);
+  writer.Write(1 << 6, 7);
+  for (int c = 0; c < 4; c++)
+  {
+    writer.Write(q0[c], 7);
+    writer.Write(q1[c], 7);
+  }
+  writer.Write(p0, 1);
+  writer.Write(p1, 1);
+  writer.Write(indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    writer.Write(indices[i], 4);
+}
+
+void EncodeLevel(const Rgba8Image& level, const BlockFormat format, std::byte* out)
+{
+  const int blocks_x = (level.width + 3) / 4;
+  const int blocks_y = (level.height + 3) / 4;
+  const std::size_t block_bytes = BlockBytes(format);
+  for (int by = 0; by < blocks_y; by++)
+  {
+    for (int bx = 0; bx < blocks_x; bx++)
+    {
+      const Block block = FetchBlock(level, bx, by);
+      std::byte* dst = out + (static_cast<std::size_t>(by) * blocks_x + bx) * block_bytes;
+      switch (format)
+      {
+        case BlockFormat::kBC1: EncodeBc1(block, dst); break;
+        case BlockFormat::kBC3: EncodeBc4(block, 3, dst); EncodeBc1(block, dst + 8); break;
+        case BlockFormat::kBC5: EncodeBc4(block, 0, dst); EncodeBc4(block, 1, dst + 8); break;
+        case BlockFormat::kBC7: EncodeBc7(block, dst); break;
+      }
+    }
+  }
+}
+
+std::size_t LevelBytes(const BlockFormat format, const int width, const int height)
+{
+  return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+// Fills levels[] (offsets and sizes) for a full chain starting at width x height
+std::size_t ComputeLevels(CompressedImage& image, const int width, const int height, const int level_count)
+{
+  std::size_t offset = 0;
+  int w = width, h = height;
+  image.levels.clear();
+  for (int i = 0; i < level_count; i++)
+  {
+    const std::size_t size = LevelBytes(image.format, w, h);
+    image.levels.push_back({offset, size, w, h});
+    offset += size;
+    w = std::max(1, w / 2);
+    h = std::max(1, h / 2);
+  }
+  return offset;
+}
+
+// DirectDraw Surface container with the DX10 extension header
+constexpr std::uint32_t kDdsMagic = 0x20534444;        // "DDS "
+constexpr std::uint32_t kFourCcDx10 = 0x30315844;      // "DX10"
+constexpr std::uint32_t kFourCcDxt1 = 0x31545844;      // "DXT1"
+constexpr std::uint32_t kFourCcDxt5 = 0x35545844;      // "DXT5"
+constexpr std::uint32_t kFourCcAti2 = 0x32495441;      // "ATI2"
+constexpr std::uint32_t kDdsFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+constexpr std::uint32_t kDdsCaps = 0x1000 | 0x400000 | 0x8;
+constexpr std::uint32_t kDdsPixelFormatFourCc = 0x4;
+constexpr std::uint32_t kDxgiTexture2D = 3;
+constexpr std::uint32_t kDdsAlphaStraight = 1;
+constexpr std::uint32_t kDdsAlphaOpaque = 3;
+
+struct DdsPixelFormat
+{
+  std::uint32_t size;
+  std::uint32_t flags;
+  std::uint32_t four_cc;
+  std::uint32_t rgb_bit_count;
+  std::uint32_t masks[4];
+};
+
+struct DdsHeader
+{
+  std::uint32_t magic;
+  std::uint32_t size;
+  std::uint32_t flags;
+  std::uint32_t height;
+  std::uint32_t width;
+  std::uint32_t pitch_or_linear_size;
+  std::uint32_t depth;
+  std::uint32_t mip_map_count;
+  std::uint32_t reserved1[11];
+  DdsPixelFormat pixel_format;
+  std::uint32_t caps[4];
+  std::uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+  std::uint32_t dxgi_format;
+  std::uint32_t resource_dimension;
+  std::uint32_t misc_flag;
+  std::uint32_t array_size;
+  std::uint32_t misc_flags2;
+};
+
+static_assert(sizeof(DdsHeader) == 128 && sizeof(DdsHeaderDx10) == 20);
+
+// The *_UNORM_SRGB variant of each format follows its *_UNORM one; BC5 has none
+std::uint32_t DxgiFormat(const BlockFormat format, const bool srgb)
+{
+  switch (format)
+  {
+    case BlockFormat::kBC1: return srgb ? 72 : 71;
+    case BlockFormat::kBC3: return srgb ? 78 : 77;
+    case BlockFormat::kBC5: return 83;
+    case BlockFormat::kBC7: return srgb ? 99 : 98;
+  }
+  return 0;
+}
+
+bool BlockFormatFromDxgi(const std::uint32_t dxgi, BlockFormat& format, bool& srgb)
+{
+  srgb = dxgi == 72 || dxgi == 78 || dxgi == 99;
+  switch (dxgi)
+  {
+    case 71: case 72: format = BlockFormat::kBC1; return true;
+    case 77: case 78: format = BlockFormat::kBC3; return true;
+    case 83: format = BlockFormat::kBC5; return true;
+    case 98: case 99: format = BlockFormat::kBC7; return true;
+    default: return false;
+  }
+}
+
+bool EndsWith(const std::string_view text, const std::string_view suffix)
+{
+  return text.size() >= suffix.size() &&
+         std::equal(suffix.rbegin(), suffix.rend(), text.rbegin(),
+                    [](const char a, const char b) { return std::tolower(a) == std::tolower(b); });
+}
+
+} // namespace
+
+std::size_t BlockBytes(const BlockFormat format)
+{
+  return format == BlockFormat::kBC1 ? 8 : 16;
+}
+
+std::string_view BlockFormatName(const BlockFormat format)
+{
+  switch (format)
+  {
+    case BlockFormat::kBC1: return "BC1";
+    case BlockFormat::kBC3: return "BC3";
+    case BlockFormat::kBC5: return "BC5";
+    case BlockFormat::kBC7: return "BC7";
+  }
+  return "?";
+}
+
+unsigned int CompressedInternalFormat(const BlockFormat format, const bool gamma)
+{
+  switch (format)
+  {
+    case BlockFormat::kBC1: return gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::kBC3:
+      return gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::kBC5: return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::kBC7: return gamma ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  return 0;
+}
+
+BlockFormat ChooseBlockFormat(const std::string_view path, const Image& image, const bool high_quality)
+{
+  const std::string_view stem = path.substr(0, path.find_last_of('.'));
+  if (EndsWith(stem, "_normal"))
+  {
+    return BlockFormat::kBC5;
+  }
+  bool translucent = false;
+  if (image.comp == 2 || image.comp == 4)
+  {
+    const auto* texels = static_cast<const std::uint8_t*>(image.pixel);
+    const std::size_t count = static_cast<std::size_t>(image.width) * image.height;
+    for (std::size_t i = 0; i < count && !translucent; i++)
+      translucent = texels[i * image.comp + image.comp - 1] != 255;
+  }
+  if (high_quality)
+  {
+    return BlockFormat::kBC7;
+  }
+  return translucent ? BlockFormat::kBC3 : BlockFormat::kBC1;
+}
+
+CompressedImage CompressImage(const Image& image, const BlockFormat format)
+{
+  CompressedImage result;
+  if (!image.valid())
+  {
+    return result;
+  }
+  result.format = format;
+  // Drives the wrap mode, like the channel count does in UploadTexture
+  result.has_alpha = format != BlockFormat::kBC5 && (image.comp == 2 || image.comp == 4);
+  const std::size_t total = ComputeLevels(result, image.width, image.height,
+                                          MipLevelCount(image.width, image.height));
+  result.data.resize(total);
+
+  Rgba8Image level = ExpandToRgba8(image);
+  for (std::size_t i = 0; i < result.levels.size(); i++)
+  {
+    if (i > 0)
+    {
+      level = Downsample(level, format == BlockFormat::kBC5);
+    }
+    EncodeLevel(level, format, result.data.data() + result.levels[i].offset);
+  }
+  return result;
+}
+
+bool WriteDds(const std::string& path, const CompressedImage& image)
+{
+  if (!image.valid())
+  {
+    return false;
+  }
+  DdsHeader header{};
+  header.magic = kDdsMagic;
+  header.size = 124;
+  header.flags = kDdsFlags;
+  header.height = static_cast<std::uint32_t>(image.height());
+  header.width = static_cast<std::uint32_t>(image.width());
+  header.pitch_or_linear_size = static_cast<std::uint32_t>(image.levels.front().size);
+  header.mip_map_count = static_cast<std::uint32_t>(image.levels.size());
+  header.pixel_format.size = 32;
+  header.pixel_format.flags = kDdsPixelFormatFourCc;
+  header.pixel_format.four_cc = kFourCcDx10;
+  header.caps[0] = kDdsCaps;
+
+  DdsHeaderDx10 dx10{};
+  dx10.dxgi_format = DxgiFormat(image.format, image.srgb);
+  dx10.resource_dimension = kDxgiTexture2D;
+  dx10.array_size = 1;
+  dx10.misc_flags2 = image.has_alpha ? kDdsAlphaStraight : kDdsAlphaOpaque;
+
+  // Written under a temporary name so a crash never leaves a truncated file behind
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+      std::cerr << "ERROR::DDS::CANNOT_WRITE " << path << "\n";
+      return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+    file.write(reinterpret_cast<const char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()));
+    if (!file)
+    {
+      std::cerr << "ERROR::DDS::CANNOT_WRITE " << path << "\n";
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temp_path, path, error);
+  return !error;
+}
+
+CompressedImage ReadDds(const std::string& path)
+{
+  CompressedImage result;
+  const gpr5300::MappedFile file(path);
+  if (!file.is_open())
+  {
+    return result;
+  }
+  const std::span<const std::byte> bytes = file.bytes();
+
+  DdsHeader header{};
+  if (bytes.size() >= sizeof(header))
+  {
+    std::memcpy(&header, bytes.data(), sizeof(header));
+  }
+  if (bytes.size() < sizeof(header) || header.magic != kDdsMagic || header.size != 124 || !(header.pixel_format.flags & kDdsPixelFormatFourCc))
+  {
+    std::cerr << "ERROR::DDS::INVALID_HEADER " << path << "\n";
+    return result;
+  }
+
+  std::size_t data_offset = sizeof(header);
+  switch (header.pixel_format.four_cc)
+  {
+    case kFourCcDx10:
+    {
+      DdsHeaderDx10 dx10{};
+      if (bytes.size() >= sizeof(header) + sizeof(dx10))
+      {
+        std::memcpy(&dx10, bytes.data() + sizeof(header), sizeof(dx10));
+      }
+      if (bytes.size() < sizeof(header) + sizeof(dx10) ||
+          !BlockFormatFromDxgi(dx10.dxgi_format, result.format, result.srgb) ||
+          dx10.resource_dimension != kDxgiTexture2D)
+      {
+        std::cerr << "ERROR::DDS::UNSUPPORTED_FORMAT " << path << "\n";
+        return result;
+      }
+      data_offset += sizeof(dx10);
+      const std::uint32_t alpha_mode = dx10.misc_flags2 & 0x7;
+      result.has_alpha = alpha_mode == kDdsAlphaOpaque
+                             ? false
+                             : alpha_mode != 0 || result.format == BlockFormat::kBC3 ||
+                                   result.format == BlockFormat::kBC7;
+      break;
+    }
+    case kFourCcDxt1: result.format = BlockFormat::kBC1; break;
+    case kFourCcDxt5: result.format = BlockFormat::kBC3; result.has_alpha = true; break;
+    case kFourCcAti2: result.format = BlockFormat::kBC5; break;
+    default:
+      std::cerr << "ERROR::DDS::UNSUPPORTED_FORMAT " << path << "\n";
+      return result;
+  }
+
+  const int level_count = std::max<int>(1, static_cast<int>(header.mip_map_count));
+  const std::size_t total = ComputeLevels(result, static_cast<int>(header.width), static_cast<int>(header.height),
+                                          std::min(level_count, MipLevelCount(header.width, header.height)));
+  if (header.width == 0 || header.height == 0 || bytes.size() < data_offset + total)
+  {
+    std::cerr << "ERROR::DDS::TRUNCATED " << path << "\n";
+    result.levels.clear();
+    return result;
+  }
+  // The one copy left: the levels outlive the mapping while they are streamed to the GPU
+  const auto levels = bytes.subspan(data_offset, total);
+  result.data.assign(levels.begin(), levels.end());
+  return result;
+}
+
+std::string BakedTexturePath(const std::string& source_path)
+{
+  return source_path + std::string(kBakedTextureExtension);
+}
+
+CompressedImage LoadBakedTexture(const std::string& source_path)
+{
+  const std::string baked_path = BakedTexturePath(source_path);
+  std::error_code error;
+  const auto baked_time = std::filesystem::last_write_time(baked_path, error);
+  if (error)
+  {
+    return {};
+  }
+  const auto source_time = std::filesystem::last_write_time(source_path, error);
+  if (!error && source_time > baked_time)
+  {
+    return {};
+  }
+  return ReadDds(baked_path);
+}
+
+unsigned int AllocateCompressedTexture(const CompressedImage& image, const bool gamma)
+{
+  unsigned int textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(image.levels.size()),
+                 CompressedInternalFormat(image.format, gamma || image.srgb), image.width(), image.height());
+
+  // Same wrap rule as UploadTexture: textures with alpha are clamped
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, image.has_alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, image.has_alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  return textureID;
+}
+
+unsigned int UploadCompressedTexture(const CompressedImage& image, const bool gamma)
+{
+  if (!image.valid())
+  {
+    return 0;
+  }
+  const unsigned int textureID = AllocateCompressedTexture(image, gamma);
+  const GLenum internal_format = CompressedInternalFormat(image.format, gamma || image.srgb);
+  for (std::size_t i = 0; i < image.levels.size(); i++)
+  {
+    const CompressedImage::Level& level = image.levels[i];
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), 0, 0, level.width, level.height,
+                              internal_format, static_cast<GLsizei>(level.size), image.data.data() + level.offset);
+  }
+  return textureID;
+}
@@ -1,34 +1,356 @@
+#include <algorithm>
+#include <climits>
 #include <iostream>
+#include <GL/glew.h>
+#include "file_utility.h"
+#include "hash_utility.h"
 #include "texture_loader.h"
+#include "texture_uploader.h"
+#include "thread_pool.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-unsigned int TextureManager::CreateTexture(const char* path) {
-  unsigned int texture;
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
-// set the texture wrapping/filtering options (on the currently bound texture object)
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+Image::~Image()
+{
+  stbi_image_free(pixel);
+}
+
+Image::Image(Image&& other) noexcept
+    : pixel(other.pixel), width(other.width), height(other.height), comp(other.comp)
+{
+  other.pixel = nullptr;
+}
+
+Image& Image::operator=(Image&& other) noexcept
+{
+  if (this != &other)
+  {
+    stbi_image_free(pixel);
+    pixel = other.pixel;
+    width = other.width;
+    height = other.height;
+    comp = other.comp;
+    other.pixel = nullptr;
+  }
+  return *this;
+}
+
+Image DecodeImage(const std::string& path, const int desired_channels)
+{
+  Image image;
+  // Decode straight from the mapped file rather than letting stb open and buffer it again
+  const gpr5300::MappedFile file(path);
+  if (!file.is_open() || file.size() == 0 || file.size() > INT_MAX)
+  {
+    return image;
+  }
+  image.pixel = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.bytes().data()),
+                                      static_cast<int>(file.size()), &image.width, &image.height, &image.comp,
+                                      desired_channels);
+  if (image.pixel && desired_channels != 0)
+  {
+    image.comp = desired_channels;
+  }
+  return image;
+}
+
+std::vector<Image> DecodeImages(std::span<const std::string> paths, const int desired_channels,
+                                gpr5300::ThreadPool* pool)
+{
+  std::vector<Image> images(paths.size());
+  gpr5300::ThreadPool& workers = pool ? *pool : gpr5300::ThreadPool::Default();
+  workers.ParallelFor(paths.size(), [&](const std::size_t i) {
+    images[i] = DecodeImage(paths[i], desired_channels);
+  });
+  return images;
+}
+
+unsigned int ImageDataFormat(const Image& image)
+{
+  switch (image.comp)
+  {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 3: return GL_RGB;
+    default: return GL_RGBA;
+  }
+}
+
+int MipLevelCount(const int width, const int height)
+{
+  int levels = 1;
+  for (int size = std::max(width, height); size > 1; size /= 2)
+  {
+    levels++;
+  }
+  return levels;
+}
+
+unsigned int AllocateTexture(const Image& image, const bool gamma)
+{
+  const GLenum data_format = ImageDataFormat(image);
+  GLenum internal_format = GL_RGBA8;
+  if (data_format == GL_RED)
+  {
+    internal_format = GL_R8;
+  }
+  else if (data_format == GL_RG)
+  {
+    internal_format = GL_RG8;
+  }
+  else if (data_format == GL_RGB)
+  {
+    internal_format = gamma ? GL_SRGB8 : GL_RGB8;
+  }
+  else
+  {
+    internal_format = gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  }
+
+  unsigned int textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glTexStorage2D(GL_TEXTURE_2D, MipLevelCount(image.width, image.height), internal_format, image.width,
+                 image.height);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, data_format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, data_format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  return textureID;
+}
+
+TexturePixels DecodeTexturePixels(const std::string& path)
+{
+  TexturePixels pixels;
+  const std::string_view extension = kBakedTextureExtension;
+  if (path.size() > extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0)
+  {
+    pixels.compressed = ReadDds(path);
+    return pixels;
+  }
+  pixels.compressed = LoadBakedTexture(path);
+  if (!pixels.compressed.valid())
+  {
+    pixels.image = DecodeImage(path);
+  }
+  return pixels;
+}
+
+std::vector<TexturePixels> DecodeTexturePixels(std::span<const std::string> paths, gpr5300::ThreadPool* pool)
+{
+  std::vector<TexturePixels> textures(paths.size());
+  gpr5300::ThreadPool& workers = pool ? *pool : gpr5300::ThreadPool::Default();
+  workers.ParallelFor(paths.size(), [&](const std::size_t i) {
+    textures[i] = DecodeTexturePixels(paths[i]);
+  });
+  return textures;
+}
+
+unsigned int UploadTexturePixels(const TexturePixels& pixels, const bool gamma)
+{
+  if (pixels.compressed.valid())
+  {
+    return UploadCompressedTexture(pixels.compressed, gamma);
+  }
+  return UploadTexture(pixels.image, gamma);
+}
+
+unsigned int UploadTexture(const Image& image, const bool gamma)
+{
+  if (!image.valid())
+  {
+    return 0;
+  }
+
+  const unsigned int textureID = AllocateTexture(image, gamma);
+  // Rows of 1 and 3 channel images are not 4-byte aligned in general
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, ImageDataFormat(image), GL_UNSIGNED_BYTE,
+                  image.pixel);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glGenerateMipmap(GL_TEXTURE_2D);
+
+  return textureID;
+}
+
+// Définition de la fonction utilitaire pour charger une texture depuis un fichier
+unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
+{
+  std::string filename = std::string(path);
+  filename = directory + '/' + filename;
+
+  const TexturePixels pixels = DecodeTexturePixels(filename);
+  if (!pixels.valid())
+  {
+    std::cout << "Texture failed to load at path: " << path << std::endl;
+    return 0;
+  }
+  return UploadTexturePixels(pixels, gamma);
+}
+
+unsigned int AllocateCubemap(const int width, const int height)
+{
+  unsigned int textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+  glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGB8, width, height);
+
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+  return textureID;
+}
+
+unsigned int UploadCubemap(std::span<const Image> faces)
+{
+  const auto first = std::find_if(faces.begin(), faces.end(), [](const Image& face) { return face.valid(); });
+  if (first == faces.end())
+  {
+    return 0;
+  }
+  const unsigned int textureID = AllocateCubemap(first->width, first->height);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (unsigned int i = 0; i < faces.size(); i++)
+  {
+    if (faces[i].valid())
+    {
+      glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, faces[i].width, faces[i].height, GL_RGB,
+                      GL_UNSIGNED_BYTE, faces[i].pixel);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  return textureID;
+}
+
+// Génération d'un cubemap à partir d'un ensemble de chemins vers les images
+unsigned int GenerateCubemap(std::span<const std::string_view> faces_paths)
+{
+  // Les six faces sont décodées en parallèle, seul l'upload reste sur le thread GL
+  const std::vector<std::string> paths(faces_paths.begin(), faces_paths.end());
+  const std::vector<Image> faces = DecodeImages(paths, STBI_rgb);
+  for (unsigned int i = 0; i < faces.size(); i++)
+  {
+    if (!faces[i].valid())
+    {
+      std::cout << "Cubemap texture failed to load at path: " << faces_paths[i] << std::endl;
+    }
+  }
+  return UploadCubemap(faces);
+}
+
+unsigned int FallbackTexture()
+{
+  static unsigned int texture = 0;
+  if (texture == 0)
+  {
+    const unsigned char white[4] = {255, 255, 255, 255};
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  return texture;
+}
+
+void AsyncTexture::Load(std::string path, const bool gamma, gpr5300::ThreadPool* pool)
+{
+  gpr5300::ThreadPool& workers = pool ? *pool : gpr5300::ThreadPool::Default();
+  path_ = std::move(path);
+  canonical_path_ = TextureRegistry::CanonicalPath(path_);
+  gamma_ = gamma;
+  resident_ = false;
+  handle_ = TextureRegistry::Default().Find(canonical_path_, 0, gamma_);
+  if (handle_)
+  {
+    return;
+  }
+  pending_ = workers.Submit([path = path_, canonical_path = canonical_path_, gamma]() {
+    Decoded decoded;
+    decoded.content_hash = gpr5300::HashFile(path);
+    if (!TextureRegistry::Default().Contains(canonical_path, decoded.content_hash, gamma))
+    {
+      decoded.pixels = DecodeTexturePixels(path);
+    }
+    return decoded;
+  });
+}
+
+bool AsyncTexture::Update()
+{
+  if (resident_)
+  {
+    return true;
+  }
+  if (!handle_)
+  {
+    if (!pending_.valid() || pending_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+      return false;
+    }
+    Decoded decoded = pending_.get();
+    TextureRegistry& registry = TextureRegistry::Default();
+    handle_ = registry.Find(canonical_path_, decoded.content_hash, gamma_);
+    if (!handle_ && decoded.pixels.valid())
+    {
+      handle_ = registry.Insert(canonical_path_, decoded.content_hash, gamma_,
+                                TextureUploader::Default().Enqueue(std::move(decoded.pixels), gamma_));
+    }
+    else if (!handle_)
+    {
+      // Either unreadable, or released by its other users since the worker checked
+      handle_ = registry.Load(path_, gamma_);
+    }
+    if (!handle_)
+    {
+      std::cout << "Texture failed to load at path: " << path_ << std::endl;
+      return false;
+    }
+  }
+  resident_ = !TextureUploader::Default().pending(handle_.id());
+  return resident_;
+}
+
+void AsyncTexture::Delete()
+{
+  handle_ = {};
+  resident_ = false;
+}
+
+unsigned int TextureManager::CreateTexture(const char* path) {
 // load and generate the texture
-  int width, height, nrChannels;
-  unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
-  if (data)
+  const CompressedImage baked = LoadBakedTexture(path);
+  if (baked.valid())
   {
-    //TODO add check JPG:
-      //glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-      //glGenerateMipmap(GL_TEXTURE_2D);
-    //TODO PNG
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    const unsigned int texture = UploadCompressedTexture(baked);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
   }
-  else
+  const Image image = DecodeImage(path, STBI_rgb_alpha);
+  if (!image.valid())
   {
     std::cout << "Failed to load texture" << std::endl;
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    return texture;
   }
-  stbi_image_free(data);
+    //TODO add check JPG:
+      //glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+      //glGenerateMipmap(GL_TEXTURE_2D);
+    //TODO PNG
+  const unsigned int texture = UploadTexture(image);
+  glBindTexture(GL_TEXTURE_2D, texture);
+// set the texture wrapping/filtering options (on the currently bound texture object)
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   return texture;
 }
@@ -0,0 +1,188 @@
+#include "texture_registry.h"
+
+#include <filesystem>
+#include <utility>
+#include <GL/glew.h>
+
+#include "hash_utility.h"
+#include "texture_loader.h"
+#include "texture_uploader.h"
+
+namespace
+{
+// sRGB and linear views of the same file are different textures
+std::string RegistryPathKey(const std::string& canonical_path, const bool gamma)
+{
+  return gamma ? canonical_path + "|srgb" : canonical_path;
+}
+
+std::uint64_t RegistryContentKey(const std::uint64_t content_hash, const bool gamma)
+{
+  if (content_hash == 0)
+  {
+    return 0;
+  }
+  return gamma ? gpr5300::HashValue(content_hash, gamma) : content_hash;
+}
+} // namespace
+
+TextureHandle::~TextureHandle()
+{
+  if (id_ != 0)
+  {
+    TextureRegistry::Default().Release(id_);
+  }
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other) : id_(other.id_)
+{
+  if (id_ != 0)
+  {
+    TextureRegistry::Default().AddReference(id_);
+  }
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& other)
+{
+  if (this != &other)
+  {
+    TextureHandle copy(other);
+    std::swap(id_, copy.id_);
+  }
+  return *this;
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept : id_(other.id_)
+{
+  other.id_ = 0;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle&& other) noexcept
+{
+  std::swap(id_, other.id_);
+  return *this;
+}
+
+TextureRegistry& TextureRegistry::Default()
+{
+  static TextureRegistry registry;
+  return registry;
+}
+
+std::string TextureRegistry::CanonicalPath(const std::string& path)
+{
+  std::error_code error;
+  const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+  return error ? std::filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+}
+
+bool TextureRegistry::Contains(const std::string& canonical_path, const std::uint64_t content_hash,
+                               const bool gamma) const
+{
+  std::scoped_lock lock(mutex_);
+  const std::uint64_t content_key = RegistryContentKey(content_hash, gamma);
+  return by_path_.contains(RegistryPathKey(canonical_path, gamma)) ||
+         (content_key != 0 && by_content_.contains(content_key));
+}
+
+TextureHandle TextureRegistry::Find(const std::string& canonical_path, const std::uint64_t content_hash,
+                                    const bool gamma)
+{
+  std::scoped_lock lock(mutex_);
+  const std::string path_key = RegistryPathKey(canonical_path, gamma);
+  if (const auto it = by_path_.find(path_key); it != by_path_.end())
+  {
+    path_hits_++;
+    entries_[it->second].references++;
+    return TextureHandle(it->second);
+  }
+  const std::uint64_t content_key = RegistryContentKey(content_hash, gamma);
+  if (const auto it = by_content_.find(content_key); content_key != 0 && it != by_content_.end())
+  {
+    content_hits_++;
+    Entry& entry = entries_[it->second];
+    entry.references++;
+    entry.path_keys.push_back(path_key);
+    by_path_.emplace(path_key, it->second);
+    return TextureHandle(it->second);
+  }
+  return {};
+}
+
+TextureHandle TextureRegistry::Insert(const std::string& canonical_path, const std::uint64_t content_hash,
+                                      const bool gamma, const unsigned int texture)
+{
+  if (texture == 0)
+  {
+    return {};
+  }
+  std::scoped_lock lock(mutex_);
+  Entry& entry = entries_[texture];
+  entry.references++;
+  const std::string path_key = RegistryPathKey(canonical_path, gamma);
+  if (by_path_.emplace(path_key, texture).second)
+  {
+    entry.path_keys.push_back(path_key);
+  }
+  const std::uint64_t content_key = RegistryContentKey(content_hash, gamma);
+  if (content_key != 0 && by_content_.emplace(content_key, texture).second)
+  {
+    entry.content_key = content_key;
+  }
+  return TextureHandle(texture);
+}
+
+TextureHandle TextureRegistry::Load(const std::string& path, const bool gamma)
+{
+  const std::string canonical_path = CanonicalPath(path);
+  if (TextureHandle handle = Find(canonical_path, 0, gamma))
+  {
+    return handle;
+  }
+  const std::uint64_t content_hash = gpr5300::HashFile(path);
+  if (TextureHandle handle = Find(canonical_path, content_hash, gamma))
+  {
+    return handle;
+  }
+  const TexturePixels pixels = DecodeTexturePixels(path);
+  if (!pixels.valid())
+  {
+    return {};
+  }
+  return Insert(canonical_path, content_hash, gamma, UploadTexturePixels(pixels, gamma));
+}
+
+std::size_t TextureRegistry::texture_count() const
+{
+  std::scoped_lock lock(mutex_);
+  return entries_.size();
+}
+
+void TextureRegistry::AddReference(const unsigned int texture)
+{
+  std::scoped_lock lock(mutex_);
+  entries_[texture].references++;
+}
+
+void TextureRegistry::Release(const unsigned int texture)
+{
+  {
+    std::scoped_lock lock(mutex_);
+    const auto it = entries_.find(texture);
+    if (it == entries_.end() || --it->second.references > 0)
+    {
+      return;
+    }
+    for (const std::string& path_key : it->second.path_keys)
+    {
+      by_path_.erase(path_key);
+    }
+    if (it->second.content_key != 0)
+    {
+      by_content_.erase(it->second.content_key);
+    }
+    entries_.erase(it);
+  }
+  TextureUploader::Default().Cancel(texture);
+  glDeleteTextures(1, &texture);
+}
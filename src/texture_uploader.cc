@@ -0,0 +1,256 @@
+#include "texture_uploader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureUploader::TextureUploader(const std::size_t frame_budget_bytes) : frame_budget_(frame_budget_bytes)
+{
+  constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  for (Segment& segment : ring_)
+  {
+    glGenBuffers(1, &segment.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(frame_budget_bytes), nullptr, flags);
+    segment.mapped = static_cast<std::byte*>(
+        glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(frame_budget_bytes), flags));
+    if (!segment.mapped)
+    {
+      // Every upload then takes the synchronous path in Enqueue
+      std::cerr << "ERROR::TEXTURE_UPLOADER::PBO_MAPPING_FAILED\n";
+      frame_budget_ = 0;
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploader::~TextureUploader()
+{
+  for (Segment& segment : ring_)
+  {
+    if (segment.fence)
+    {
+      glDeleteSync(segment.fence);
+    }
+    if (segment.mapped)
+    {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    glDeleteBuffers(1, &segment.buffer);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploader& TextureUploader::Default()
+{
+  // Never destroyed: the GL context is gone by the time statics are torn down.
+  static auto* uploader = new TextureUploader();
+  return *uploader;
+}
+
+unsigned int TextureUploader::Enqueue(Image image, const bool gamma)
+{
+  if (!image.valid())
+  {
+    return 0;
+  }
+  const GLuint texture = AllocateTexture(image, gamma);
+
+  Request request;
+  request.texture = texture;
+  request.format = ImageDataFormat(image);
+  request.width = image.width;
+  request.height = image.height;
+  request.rows = image.height;
+  request.row_bytes = static_cast<std::size_t>(image.width) * image.comp;
+  request.mipmaps = true;
+  const auto owner = std::make_shared<const Image>(std::move(image));
+  request.pixels = static_cast<const std::byte*>(owner->pixel);
+  request.owner = owner;
+  Push(std::move(request));
+  return texture;
+}
+
+unsigned int TextureUploader::Enqueue(CompressedImage image, const bool gamma)
+{
+  if (!image.valid())
+  {
+    return 0;
+  }
+  const GLuint texture = AllocateCompressedTexture(image, gamma);
+  const GLenum internal_format = CompressedInternalFormat(image.format, gamma || image.srgb);
+  const auto owner = std::make_shared<const CompressedImage>(std::move(image));
+  for (std::size_t i = 0; i < owner->levels.size(); i++)
+  {
+    const CompressedImage::Level& level = owner->levels[i];
+    Request request;
+    request.owner = owner;
+    request.pixels = owner->data.data() + level.offset;
+    request.texture = texture;
+    request.format = internal_format;
+    request.compressed = true;
+    request.level = static_cast<int>(i);
+    request.width = level.width;
+    request.height = level.height;
+    request.row_height = 4;
+    request.rows = (level.height + 3) / 4;
+    request.row_bytes = level.size / request.rows;
+    Push(std::move(request));
+  }
+  return texture;
+}
+
+unsigned int TextureUploader::Enqueue(TexturePixels pixels, const bool gamma)
+{
+  if (pixels.compressed.valid())
+  {
+    return Enqueue(std::move(pixels.compressed), gamma);
+  }
+  return Enqueue(std::move(pixels.image), gamma);
+}
+
+unsigned int TextureUploader::EnqueueCubemap(std::vector<Image> faces)
+{
+  const auto first = std::find_if(faces.begin(), faces.end(), [](const Image& face) { return face.valid(); });
+  if (first == faces.end())
+  {
+    return 0;
+  }
+  const GLuint texture = AllocateCubemap(first->width, first->height);
+
+  for (std::size_t i = 0; i < faces.size(); i++)
+  {
+    if (!faces[i].valid())
+    {
+      continue;
+    }
+    Request request;
+    request.texture = texture;
+    request.target = static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+    request.format = GL_RGB;
+    request.width = faces[i].width;
+    request.height = faces[i].height;
+    request.rows = faces[i].height;
+    request.row_bytes = static_cast<std::size_t>(faces[i].width) * 3;
+    const auto owner = std::make_shared<const Image>(std::move(faces[i]));
+    request.pixels = static_cast<const std::byte*>(owner->pixel);
+    request.owner = owner;
+    Push(std::move(request));
+  }
+  return texture;
+}
+
+void TextureUploader::Push(Request request)
+{
+  remaining_[request.texture]++;
+  if (request.row_bytes > frame_budget_)
+  {
+    // A single row does not fit in a staging buffer: upload from client memory.
+    Submit(request, 0, request.rows, request.pixels);
+    Finish(request);
+    return;
+  }
+  queued_bytes_ += request.row_bytes * request.rows;
+  queue_.push_back(std::move(request));
+}
+
+void TextureUploader::Cancel(const unsigned int texture)
+{
+  for (auto it = queue_.begin(); it != queue_.end();)
+  {
+    if (it->texture != texture)
+    {
+      ++it;
+      continue;
+    }
+    queued_bytes_ -= it->row_bytes * (it->rows - it->next_row);
+    it = queue_.erase(it);
+  }
+  remaining_.erase(texture);
+}
+
+void TextureUploader::Flush()
+{
+  last_frame_bytes_ = 0;
+  if (queue_.empty())
+  {
+    return;
+  }
+
+  Segment& segment = ring_[current_];
+  if (segment.fence)
+  {
+    // The GL may still be reading what this buffer held kRingSize frames ago.
+    // Rather than waiting for it, upload nothing this frame.
+    if (glClientWaitSync(segment.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+      return;
+    }
+    glDeleteSync(segment.fence);
+    segment.fence = nullptr;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+  std::size_t offset = 0;
+  while (!queue_.empty())
+  {
+    Request& request = queue_.front();
+    const int rows = static_cast<int>(
+        std::min<std::size_t>(request.rows - request.next_row, (frame_budget_ - offset) / request.row_bytes));
+    if (rows == 0)
+    {
+      break;
+    }
+
+    const std::size_t bytes = request.row_bytes * rows;
+    std::memcpy(segment.mapped + offset, request.pixels + request.row_bytes * request.next_row, bytes);
+    Submit(request, request.next_row, rows, reinterpret_cast<const void*>(offset));
+    request.next_row += rows;
+    offset += bytes;
+    queued_bytes_ -= bytes;
+
+    if (request.next_row == request.rows)
+    {
+      Finish(request);
+      queue_.pop_front();
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  current_ = (current_ + 1) % kRingSize;
+  last_frame_bytes_ = offset;
+}
+
+void TextureUploader::Submit(const Request& request, const int first_row, const int row_count, const void* data)
+{
+  const int y = first_row * request.row_height;
+  const int height = std::min(row_count * request.row_height, request.height - y);
+  glBindTexture(request.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP, request.texture);
+  if (request.compressed)
+  {
+    glCompressedTexSubImage2D(request.target, request.level, 0, y, request.width, height, request.format,
+                              static_cast<GLsizei>(request.row_bytes * row_count), data);
+    return;
+  }
+  // Rows of 1 and 3 channel images are not 4-byte aligned in general
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(request.target, request.level, 0, y, request.width, height, request.format, GL_UNSIGNED_BYTE,
+                  data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void TextureUploader::Finish(const Request& request)
+{
+  if (request.mipmaps)
+  {
+    glBindTexture(GL_TEXTURE_2D, request.texture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+  const auto it = remaining_.find(request.texture);
+  if (it != remaining_.end() && --it->second <= 0)
+  {
+    remaining_.erase(it);
+  }
+}
@@ -0,0 +1,132 @@
+#include "thread_pool.h"
+
+namespace gpr5300
+{
+
+ThreadPool::ThreadPool(std::size_t worker_count)
+{
+  if (worker_count == 0)
+  {
+    const unsigned int cores = std::thread::hardware_concurrency();
+    worker_count = cores > 1 ? cores - 1 : 1;
+  }
+  workers_.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; ++i)
+  {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (auto& worker : workers_)
+  {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::Default()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+  {
+    std::scoped_lock lock(mutex_);
+    jobs_.push(std::move(job));
+  }
+  condition_.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+  std::unique_lock lock(mutex_);
+  while (true)
+  {
+    condition_.wait(lock, [this]() { return stopping_ || !jobs_.empty() || FindFork() != nullptr; });
+    // Forks first: their caller is blocked until they are done
+    if (Fork* fork = FindFork())
+    {
+      fork->helpers++;
+      lock.unlock();
+      Drain(*fork);
+      lock.lock();
+      fork->helpers--;
+      fork_finished_.notify_all();
+      continue;
+    }
+    if (jobs_.empty())
+    {
+      return; // Stopping
+    }
+    std::function<void()> job = std::move(jobs_.front());
+    jobs_.pop();
+    lock.unlock();
+    job();
+    lock.lock();
+  }
+}
+
+ThreadPool::Fork* ThreadPool::FindFork() const
+{
+  for (Fork* fork = forks_; fork != nullptr; fork = fork->next)
+  {
+    if (fork->next_index.load(std::memory_order_relaxed) < fork->count)
+    {
+      return fork;
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPool::Drain(Fork& fork)
+{
+  // Indices are handed out one at a time so that uneven jobs (a 4K texture
+  // next to a 64x64 one) still balance across workers.
+  for (std::size_t i = fork.next_index.fetch_add(1); i < fork.count; i = fork.next_index.fetch_add(1))
+  {
+    fork.invoke(fork.body, i);
+  }
+}
+
+void ThreadPool::RunFork(Fork& fork)
+{
+  if (fork.count == 0)
+  {
+    return;
+  }
+  if (fork.count == 1 || workers_.empty())
+  {
+    Drain(fork);
+    return;
+  }
+
+  {
+    std::scoped_lock lock(mutex_);
+    fork.next = forks_;
+    forks_ = &fork;
+  }
+  condition_.notify_all();
+  Drain(fork);
+
+  // The fork lives on this stack: no worker may join it or still be inside it
+  // once this returns. A ParallelFor issued from inside a worker therefore
+  // only waits on indices being run, never on queued work.
+  std::unique_lock lock(mutex_);
+  Fork** link = &forks_;
+  while (*link != &fork)
+  {
+    link = &(*link)->next;
+  }
+  *link = fork.next;
+  fork_finished_.wait(lock, [&fork]() { return fork.helpers == 0; });
+}
+
+} // namespace gpr5300
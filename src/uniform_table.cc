@@ -0,0 +1,117 @@
+#include "uniform_table.h"
+
+#include <algorithm>
+#include <bit>
+#include <GL/glew.h>
+
+#include "hash_utility.h"
+
+void UniformTable::Build(const unsigned int program)
+{
+  Clear();
+  GLint active = 0;
+  GLint max_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  if (active <= 0)
+  {
+    return;
+  }
+
+  struct Active
+  {
+    std::string name;
+    GLint size;
+  };
+  std::vector<Active> uniforms;
+  std::size_t entry_count = 0;
+  std::string name(static_cast<std::size_t>(std::max(max_length, 1)), '\0');
+  for (GLint i = 0; i < active; i++)
+  {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type,
+                       name.data());
+    uniforms.push_back({name.substr(0, static_cast<std::size_t>(length)), size});
+    // Arrays add their base name and one entry per element
+    entry_count += size > 1 || uniforms.back().name.ends_with("[0]") ? static_cast<std::size_t>(size) + 1 : 1;
+  }
+  slots_.resize(std::bit_ceil(std::max<std::size_t>(entry_count * 2, 8)));
+
+  for (const Active& uniform : uniforms)
+  {
+    const int location = glGetUniformLocation(program, uniform.name.c_str());
+    if (location < 0)
+    {
+      continue;
+    }
+    if (!uniform.name.ends_with("[0]"))
+    {
+      Insert(uniform.name, location);
+      continue;
+    }
+    // Elements of an array of basic types are not guaranteed to be contiguous
+    const std::string base = uniform.name.substr(0, uniform.name.size() - 3);
+    Insert(base, location);
+    Insert(uniform.name, location);
+    for (GLint element = 1; element < uniform.size; element++)
+    {
+      const std::string element_name = base + '[' + std::to_string(element) + ']';
+      Insert(element_name, glGetUniformLocation(program, element_name.c_str()));
+    }
+  }
+}
+
+void UniformTable::Clear()
+{
+  slots_.clear();
+  names_.clear();
+  count_ = 0;
+}
+
+int UniformTable::Find(const std::string_view name) const
+{
+  if (slots_.empty())
+  {
+    return -1;
+  }
+  const std::uint64_t hash = Hash(name);
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = hash & mask;; i = (i + 1) & mask)
+  {
+    const Slot& slot = slots_[i];
+    if (slot.hash == 0)
+    {
+      return -1;
+    }
+    if (slot.hash == hash && std::string_view(names_).substr(slot.name_offset, slot.name_length) == name)
+    {
+      return slot.location;
+    }
+  }
+}
+
+std::uint64_t UniformTable::Hash(const std::string_view name)
+{
+  const std::uint64_t hash = gpr5300::HashBytes(gpr5300::kFnvOffsetBasis, name.data(), name.size());
+  return hash == 0 ? 1 : hash;
+}
+
+void UniformTable::Insert(const std::string_view name, const int location)
+{
+  if (location < 0 || Find(name) >= 0)
+  {
+    return;
+  }
+  const std::uint64_t hash = Hash(name);
+  const std::size_t mask = slots_.size() - 1;
+  std::size_t i = hash & mask;
+  while (slots_[i].hash != 0)
+  {
+    i = (i + 1) & mask;
+  }
+  slots_[i] = {hash, location, static_cast<std::uint32_t>(names_.size()), static_cast<std::uint32_t>(name.size())};
+  names_.append(name);
+  count_++;
+}
@@ -0,0 +1,106 @@
+#include "vertex_packing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "mesh.h"
+
+namespace
+{
+// Assimp's normals and tangents are unit length; clamp anything else into the snorm range
+std::uint32_t PackDirection(const glm::vec3& direction)
+{
+  return glm::packSnorm3x10_1x2(glm::vec4(glm::clamp(direction, glm::vec3(-1.0f), glm::vec3(1.0f)), 0.0f));
+}
+
+glm::vec3 UnpackDirection(const std::uint32_t packed)
+{
+  return glm::vec3(glm::unpackSnorm3x10_1x2(packed));
+}
+
+// Angle between a direction and its packed version. Zero vectors (tangents of
+// meshes without UVs) stay zero and count as exact.
+float DirectionErrorDegrees(const glm::vec3& direction, const std::uint32_t packed)
+{
+  const float length = glm::length(direction);
+  if (length < 1e-6f)
+  {
+    return 0.0f;
+  }
+  const glm::vec3 unpacked = UnpackDirection(packed);
+  const float unpacked_length = glm::length(unpacked);
+  if (unpacked_length < 1e-6f)
+  {
+    return 180.0f;
+  }
+  const float cosine = std::clamp(glm::dot(direction, unpacked) / (length * unpacked_length), -1.0f, 1.0f);
+  return std::acos(cosine) * (180.0f / std::numbers::pi_v<float>);
+}
+} // namespace
+
+PackedVertex PackVertex(const Vertex& vertex)
+{
+  PackedVertex packed{};
+  packed.position[0] = glm::packHalf1x16(vertex.Position.x);
+  packed.position[1] = glm::packHalf1x16(vertex.Position.y);
+  packed.position[2] = glm::packHalf1x16(vertex.Position.z);
+  packed.position[3] = glm::packHalf1x16(1.0f);
+  packed.normal = PackDirection(vertex.Normal);
+  packed.tangent = PackDirection(vertex.Tangent);
+  packed.tex_coords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+  packed.tex_coords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+  return packed;
+}
+
+Vertex UnpackVertex(const PackedVertex& vertex)
+{
+  Vertex unpacked{};
+  unpacked.Position = glm::vec3(glm::unpackHalf1x16(vertex.position[0]), glm::unpackHalf1x16(vertex.position[1]),
+                                glm::unpackHalf1x16(vertex.position[2]));
+  unpacked.Normal = UnpackDirection(vertex.normal);
+  unpacked.Tangent = UnpackDirection(vertex.tangent);
+  unpacked.TexCoords =
+      glm::vec2(glm::unpackHalf1x16(vertex.tex_coords[0]), glm::unpackHalf1x16(vertex.tex_coords[1]));
+  return unpacked;
+}
+
+bool PackVertices(const std::span<const Vertex> vertices, const glm::vec3& aabb_min, const glm::vec3& aabb_max,
+                  std::vector<PackedVertex>& packed, const VertexPackingTolerance& tolerance,
+                  VertexPackingError* error)
+{
+  const glm::vec3 extent = glm::max(aabb_max - aabb_min, glm::vec3(0.0f));
+  const float scale = std::max({extent.x, extent.y, extent.z, 1e-6f});
+
+  VertexPackingError measured;
+  packed.resize(vertices.size());
+  for (std::size_t i = 0; i < vertices.size(); i++)
+  {
+    const Vertex& vertex = vertices[i];
+    packed[i] = PackVertex(vertex);
+    const Vertex unpacked = UnpackVertex(packed[i]);
+
+    const glm::vec3 position_error = glm::abs(unpacked.Position - vertex.Position);
+    measured.position = std::max({measured.position, position_error.x / scale, position_error.y / scale,
+                                  position_error.z / scale});
+    const glm::vec2 tex_coords_error = glm::abs(unpacked.TexCoords - vertex.TexCoords);
+    measured.tex_coords = std::max({measured.tex_coords, tex_coords_error.x, tex_coords_error.y});
+    measured.direction_degrees =
+        std::max({measured.direction_degrees, DirectionErrorDegrees(vertex.Normal, packed[i].normal),
+                  DirectionErrorDegrees(vertex.Tangent, packed[i].tangent)});
+  }
+
+  if (error != nullptr)
+  {
+    *error = measured;
+  }
+  // Positions beyond the half float range come back infinite and fail here too
+  if (!measured.Within(tolerance))
+  {
+    packed.clear();
+    return false;
+  }
+  return true;
+}